@@ -1,128 +1,154 @@
 #include "Cache.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <cstdint>
 #include <cstdlib>
-#include <map>
+#include <memory>
+#include <vector>
+
+#include "ReplacementPolicy.h"
+
+namespace {
+
+// Set storage from which batches are grouped by set by default: about the
+// size of a host L2 cache, beyond which going through the trace in order
+// misses in the host's caches on most accesses
+const size_t BUCKETING_MIN_BYTES = 1u << 20;
+
+// Smaller batches are simulated in order: sorting them costs more than it
+// saves
+const size_t BUCKETING_MIN_BATCH = 1024;
+
+// Accesses ahead of the current one whose sets are prefetched
+const size_t BUCKETING_PREFETCH = 8;
+
+// Size of the tag index for a set with `blocks` ways: a power of 2 with at
+// least twice as many buckets as ways, or 0 when the set is scanned linearly
+uint32_t tag_index_capacity(uint32_t blocks, uint32_t linear_ways) {
+    if (blocks <= linear_ways) {
+        return 0;
+    }
+    uint32_t capacity = 1;
+    while (capacity < 2 * blocks) {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+}  // namespace
 
 /**
- * Constructor to initialize the cache with specified parameters.
+ * Sets up the geometry and the (empty) per-set storage.
  *
- * @param sets Number of sets in the cache.
- * @param blocks Number of blocks (slots) per set.
- * @param bytes Number of bytes per block.
- * @param miss_write_type True for Write-Allocate, False for No-Write-Allocate.
- * @param hit_write_type True for Write-Back, False for Write-Through.
- * @param eviction_type True for LRU, False for FIFO.
+ * @param config Geometry and policies of the cache.
+ * @param policy_words Words of replacement state kept per set.
  */
-Cache::Cache(uint32_t sets, uint32_t blocks, uint32_t bytes,
-             bool miss_write_type, bool hit_write_type, bool eviction_type)
-    : num_sets(sets),
-      num_slots(blocks),
-      num_bytes(bytes),
+Cache::Cache(const CacheConfig& config, uint32_t policy_words)
+    : num_sets(config.sets),
+      num_slots(config.blocks),
+      num_bytes(config.bytes),
       writes_per_block(num_bytes / 4),
-      miss_write_type(miss_write_type),
-      hit_write_type(hit_write_type),
-      eviction_type(eviction_type),
-      offset_size(log2(bytes)),
+      miss_write_type(config.miss_write_type),
+      hit_write_type(config.hit_write_type),
+      eviction(config.eviction),
+      offset_size(log2(config.bytes)),
       index_size(log2(num_sets)),
-      tag_size(32 - (offset_size + index_size)) {
-    // Initialize each set with an empty map of tag-to-slot pointers
-    cache = std::vector<Set>(num_sets, Set{std::map<uint32_t, Slot*>()});
+      tag_size(64 - (offset_size + index_size)),
+      index_capacity(tag_index_capacity(config.blocks, LINEAR_LOOKUP_WAYS)),
+      index_shift(index_capacity ? 32 - log2(index_capacity) : 0),
+      policy_words(policy_words),
+      // Tags and flags, then the policy state and the tag index
+      set_stride(2 * config.blocks + policy_words + index_capacity) {
+    // Every set starts empty; all of their way state lives in one allocation
+    cache = std::vector<Set>(num_sets);
+    ways = std::vector<uint32_t>(static_cast<size_t>(num_sets) * set_stride);
+    bucketing = ways.size() * sizeof(uint32_t) >= BUCKETING_MIN_BYTES;
 }
 
-// destructor
-Cache::~Cache() {
-    // Free all dynamically allocated slots in each set
-    for (std::vector<Set>::iterator it = cache.begin(); it != cache.end();
-         ++it) {
-        Set& current_set = *it;
-
-        // Deallocate each slot in the set
-        for (auto& pair : current_set.index) {
-            delete pair.second;  // Free memory for each slot
-        }
-    }
-}
+/**
+ * Constructor to initialize the cache from a parsed configuration.
+ *
+ * @param config Geometry and policies of the cache.
+ * @param policy The replacement policy.
+ */
+template <class Policy>
+PolicyCache<Policy>::PolicyCache(const CacheConfig& config, Policy policy)
+    : Cache(config, Policy::state_words(config.blocks)), policy(policy) {}
 
 /**
  * Loads an address from the cache or memory.
  * Handles tag extraction, set lookup, hit/miss detection,
- * LRU/FIFO eviction, and updating cache state.
+ * eviction, and updating cache state.
  *
  * @param address The memory address to load.
  * @return True if the load resulted in a cache hit, otherwise false.
  */
-bool Cache::load(uint32_t address) {
-    ++total_loads;   // Count the load operation
-    ++current_time;  // Advance time for LRU/FIFO tracking
-
+template <class Policy>
+bool PolicyCache<Policy>::load(uint64_t address) {
     // Extract offset, index, and tag from the address
     uint32_t index = get_index(address);
-    uint32_t tag = get_tag(address);
+    uint64_t tag = get_tag(address);
+    return load_decomposed(address, index, tag);
+}
 
-    // Get the set corresponding to the index
-    Set& current = cache[index];
+/**
+ * Loads an address whose index and tag are already known, the cache being
+ * wide enough for the tag.
+ *
+ * @param address The memory address to load.
+ * @param index Set index of the address.
+ * @param tag Tag of the address.
+ * @return True if the load resulted in a cache hit, otherwise false.
+ */
+template <class Policy>
+bool PolicyCache<Policy>::load_decomposed(uint64_t address, uint32_t index,
+                                          uint64_t tag) {
+    ++total_loads;   // Count the load operation
+    policy.begin_access();
 
     // Check for a hit
-    if (current.index.find(tag) != current.index.end()) {
+    uint32_t way = find_way(index, tag);
+    Prefetcher::Access access = Prefetcher::MISS;
+    if (prefetcher) {
+        access = note_demand(address, index, way);
+    }
+
+    if (way != num_slots) {
         ++load_hits;  // Cache hit
 
-        // Update access time for LRU
-        current.index[tag]->access_ts = current_time;
+        // Let the policy record the hit (promotes the way for LRU)
+        policy.on_hit(policy_state(index), num_slots, way);
+        if (!fills.empty()) {
+            merge_fill(address);
+        }
 
         total_cycles += cache_cost;  // Cost of accessing the cache
+        if (prefetcher) {
+            run_prefetcher(address, access);
+        }
         return true;
     } else {
         ++load_misses;  // Cache miss
+        if (miss_profile) {
+            miss_profile->record(address, false);
+        }
 
-        // Add memory access and cache access costs
-        total_cycles += cache_cost + (memory_cost * writes_per_block);
-
-        if (current.index.size() < num_slots) {
-            // Space available — insert new slot
-            current.index[tag] = create_slot(tag);
-        } else {
-            // Set is full — need to evict
-            uint32_t evict_tag;
-
-            if (eviction_type) {
-                // Use LRU policy
-                uint32_t least_recent = UINT32_MAX;
-
-                // find the least_recent set
-                for (const auto& pair : current.index) {
-                    Slot* current_slot = pair.second;
-
-                    if (current_slot->access_ts < least_recent) {
-                        evict_tag = pair.first;
-                        least_recent = current_slot->access_ts;
-                    }
-                }
-
-                assert(least_recent != UINT32_MAX);
-
-            } else {
-                // Use FIFO policy
-                uint32_t oldest = UINT32_MAX;
-
-                // find the onldest set
-                for (const auto& pair : current.index) {
-                    Slot* current_slot = pair.second;
-
-                    if (current_slot->load_ts < oldest) {
-                        evict_tag = pair.first;
-                        oldest = current_slot->load_ts;
-                    }
-                }
-
-                assert(oldest != UINT32_MAX);
-            }
+        // Add memory access and cache access costs. With MSHRs the fill
+        // only costs the time spent waiting for a free one
+        bool dirty;
+        uint64_t fetch_cost = fetch_block(address, dirty);
+        total_cycles += cache_cost;
+        total_cycles += issue_fill(address, fetch_cost);
 
-            // Replace evicted slot
-            current.index[tag] = evict(current.index[evict_tag], tag);
-            current.index.erase(evict_tag);
+        way = allocate(index, tag);
+        if (dirty) {
+            // The level below handed over its modified copy
+            way_array(index, FLAGS)[way] |= SLOT_DIRTY;
+        }
+        if (prefetcher) {
+            run_prefetcher(address, access);
         }
         return false;
     }
@@ -135,137 +161,807 @@ bool Cache::load(uint32_t address) {
  * @param address The memory address to store.
  * @return True if store is a cache hit, otherwise false.
  */
-bool Cache::store(uint32_t address) {
-    ++total_stores;  // Count the store operation
-    ++current_time;  // Advance time for LRU/FIFO tracking
-
+template <class Policy>
+bool PolicyCache<Policy>::store(uint64_t address) {
     // Extract index and tag
     uint32_t index = get_index(address);
-    uint32_t tag = get_tag(address);
+    uint64_t tag = get_tag(address);
+    return store_decomposed(address, index, tag);
+}
 
-    Set& current = cache[index];
+/**
+ * Stores to an address whose index and tag are already known, the cache
+ * being wide enough for the tag.
+ *
+ * @param address The memory address to store.
+ * @param index Set index of the address.
+ * @param tag Tag of the address.
+ * @return True if store is a cache hit, otherwise false.
+ */
+template <class Policy>
+bool PolicyCache<Policy>::store_decomposed(uint64_t address, uint32_t index,
+                                           uint64_t tag) {
+    ++total_stores;  // Count the store operation
+    policy.begin_access();
 
     // Check for cache hit
-    if (current.index.find(tag) != current.index.end()) {
+    uint32_t way = find_way(index, tag);
+    Prefetcher::Access access = Prefetcher::MISS;
+    if (prefetcher) {
+        access = note_demand(address, index, way);
+    }
+
+    if (way != num_slots) {
         ++store_hits;  // Cache hit
 
-        current.index[tag]->access_ts = current_time;
+        policy.on_hit(policy_state(index), num_slots, way);
+        if (!fills.empty()) {
+            merge_fill(address);
+        }
 
         if (hit_write_type) {
             // Write-back: write to cache, mark dirty
             total_cycles += cache_cost;
-            current.index[tag]->dirty = true;
+            way_array(index, FLAGS)[way] |= SLOT_DIRTY;
         } else {
             // Write-through: write to cache and memory
-            total_cycles += (cache_cost + memory_cost);
+            total_cycles += cache_cost + write_through(address);
         }
 
+        if (prefetcher) {
+            run_prefetcher(address, access);
+        }
         return true;
     } else {
         ++store_misses;  // Cache miss
+        if (miss_profile) {
+            miss_profile->record(address, true);
+        }
 
         if (!miss_write_type) {
             // No-Write-Allocate: only write to memory
-            total_cycles += memory_cost;
+            total_cycles += write_through(address);
 
         } else {
-            if (current.index.size() < num_slots) {
-                // Space available — create slot
-                current.index[tag] = create_slot(tag);
-            } else {
-                // Set full — evict based on policy
-                uint32_t evict_tag;
-
-                if (eviction_type) {
-                    // LRU policy
-                    uint32_t least_recent = UINT32_MAX;
-
-                    for (const auto& pair : current.index) {
-                        Slot* current_slot = pair.second;
-                        if (current_slot->access_ts < least_recent) {
-                            evict_tag = pair.first;
-                            least_recent = current_slot->access_ts;
-                        }
-                    }
-
-                    assert(least_recent != UINT32_MAX);
-                } else {
-                    // FIFO policy
-                    uint32_t oldest = UINT32_MAX;
-
-                    for (const auto& pair : current.index) {
-                        Slot* current_slot = pair.second;
-                        if (current_slot->load_ts < oldest) {
-                            evict_tag = pair.first;
-                            oldest = current_slot->load_ts;
-                        }
-                    }
-
-                    assert(oldest != UINT32_MAX);
-                }
-
-                current.index[tag] = evict(current.index[evict_tag], tag);
-                current.index.erase(evict_tag);
-            }
+            bool dirty;
+            uint64_t fetch_cost = fetch_block(address, dirty);
+            total_cycles += cache_cost;
+            total_cycles += issue_fill(address, fetch_cost);
+            way = allocate(index, tag);
 
             // Apply write-back or write-through after allocation
             if (hit_write_type) {
                 // Write-back + Write-Allocate
-                total_cycles += (writes_per_block * memory_cost) + cache_cost;
-                current.index[tag]->dirty = true;
+                way_array(index, FLAGS)[way] |= SLOT_DIRTY;
             } else {
-                // Write-through + Write-Allocate
-                total_cycles +=
-                    (writes_per_block * memory_cost) + cache_cost + memory_cost;
+                // Write-through + Write-Allocate. The block only stays dirty
+                // if the level below handed over a modified copy
+                total_cycles += write_through(address);
 
-                current.index[tag]->dirty = false;
+                if (dirty) {
+                    way_array(index, FLAGS)[way] |= SLOT_DIRTY;
+                } else {
+                    way_array(index, FLAGS)[way] &= ~SLOT_DIRTY;
+                }
             }
         }
+        if (prefetcher) {
+            run_prefetcher(address, access);
+        }
         return false;
     }
 }
 
 /**
- * Evicts the given slot and replaces its metadata with a new tag.
+ * Runs a batch of trace records through the cache. Calls to load and store
+ * are resolved statically here, so the whole batch runs without a virtual
+ * call unless an access reaches another level.
+ *
+ * @param records The records.
+ * @param count Number of records.
+ */
+template <class Policy>
+void PolicyCache<Policy>::simulate(const TraceRecord* records, size_t count) {
+    if (count >= BUCKETING_MIN_BATCH && sets_independent()) {
+        simulate_bucketed(records, count);
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (records[i].op == 's') {
+            PolicyCache::store(records[i].address);
+        } else {
+            PolicyCache::load(records[i].address);  // Loads and fetches
+        }
+    }
+}
+
+/**
+ * Simulates a batch set by set. Sets only share counters that are summed
+ * regardless of order (the flat memory cost of a miss does not depend on
+ * what came before), so visiting the accesses of each set in trace order
+ * gives the results of the trace order, while each set's state is brought
+ * into the host's caches once per batch rather than once per access.
+ *
+ * @param records The records.
+ * @param count Number of records.
+ */
+template <class Policy>
+void PolicyCache<Policy>::simulate_bucketed(const TraceRecord* records,
+                                            size_t count) {
+    bucket_by_set(records, count, offset_size, index_size, set_buckets);
+    if (set_buckets.tag_bits > UINT32_MAX && !wide) {
+        widen();
+    }
+
+    const SetAccess* accesses = set_buckets.accesses.data();
+    for (size_t i = 0; i < count; ++i) {
+        if (i + BUCKETING_PREFETCH < count) {
+            // The sets coming up are known, so start bringing them in
+            uint32_t ahead = accesses[i + BUCKETING_PREFETCH].index;
+            __builtin_prefetch(way_array(ahead, TAGS));
+            __builtin_prefetch(policy_state(ahead));
+        }
+        const SetAccess& access = accesses[i];
+        if (access.store) {
+            store_decomposed(access.address, access.index, access.tag);
+        } else {
+            load_decomposed(access.address, access.index, access.tag);
+        }
+    }
+}
+
+/**
+ * Shows a demand access to the prefetcher and fills the blocks it asks for.
+ *
+ * @param address Address accessed.
+ * @param access What the access found.
+ */
+template <class Policy>
+void PolicyCache<Policy>::run_prefetcher(uint64_t address,
+                                         Prefetcher::Access access) {
+    prefetch_queue.clear();
+    prefetcher->observe(address, access, prefetch_queue);
+    for (uint64_t block : prefetch_queue) {
+        prefetch_block(block);
+    }
+}
+
+/**
+ * Fills the block containing an address ahead of a demand access, unless it
+ * is already cached. The fill goes through the normal allocation and
+ * eviction path, but it does not stall the access stream: the block is
+ * marked prefetched and only becomes usable once the fetch would have
+ * completed.
+ *
+ * @param address Any address in the block.
+ */
+template <class Policy>
+void PolicyCache<Policy>::prefetch_block(uint64_t address) {
+    uint32_t index = get_index(address);
+    uint64_t tag = get_tag(address);
+    if (find_way(index, tag) != num_slots) {
+        return;
+    }
+
+    ++prefetch_stats.issued;
+    prefetch_victims.erase(block_address(index, tag));
+    bool dirty;
+    uint64_t ready = total_cycles + fetch_block(address, dirty);
+
+    uint32_t way = allocate(index, tag, true);
+    way_array(index, FLAGS)[way] |=
+        SLOT_PREFETCHED | (dirty ? uint32_t{SLOT_DIRTY} : 0u);
+    prefetch_ready[block_address(index, tag)] = ready;
+}
+
+/**
+ * Looks up a tag in a set. Small sets compare it against every filled way
+ * (their tags are contiguous, so this is a straight linear scan); highly
+ * associative sets probe their tag index instead.
+ *
+ * @param index The set to search.
+ * @param tag The tag to look for.
+ * @return The way holding the tag, or num_slots if it is not cached.
+ */
+uint32_t Cache::find_way(uint32_t index, uint64_t tag) {
+    const uint32_t* tags = way_array(index, TAGS);
+    const uint32_t low = static_cast<uint32_t>(tag);
+
+    if (index_capacity == 0) {
+        const uint32_t used = cache[index].used;
+
+        if (!wide) {
+            for (uint32_t way = 0; way < used; ++way) {
+                if (tags[way] == low) {
+                    return way;
+                }
+            }
+            return num_slots;
+        }
+
+        const uint32_t* tags_hi = way_array(index, TAGS_HI);
+        const uint32_t high = static_cast<uint32_t>(tag >> 32);
+        for (uint32_t way = 0; way < used; ++way) {
+            if (tags[way] == low && tags_hi[way] == high) {
+                return way;
+            }
+        }
+        return num_slots;
+    }
+
+    // Linear probing: buckets hold way + 1, and an empty bucket ends the probe
+    const uint32_t* buckets = tag_index(index);
+    const uint32_t mask = index_capacity - 1;
+
+    for (uint32_t b = tag_bucket(tag);; b = (b + 1) & mask) {
+        if (buckets[b] == 0) {
+            return num_slots;
+        }
+        if (tags[buckets[b] - 1] == low && way_tag(index, buckets[b] - 1) == tag) {
+            return buckets[b] - 1;
+        }
+    }
+}
+
+/**
+ * Records that a way of a set holds a tag in the set's tag index.
+ * No-op for sets that are searched linearly.
+ *
+ * @param index The set containing the way.
+ * @param tag The tag now held by the way.
+ * @param way The way holding the tag.
+ */
+void Cache::index_insert(uint32_t index, uint64_t tag, uint32_t way) {
+    if (index_capacity == 0) {
+        return;
+    }
+
+    uint32_t* buckets = tag_index(index);
+    const uint32_t mask = index_capacity - 1;
+
+    uint32_t b = tag_bucket(tag);
+    while (buckets[b] != 0) {
+        b = (b + 1) & mask;
+    }
+    buckets[b] = way + 1;
+}
+
+/**
+ * Removes a tag from a set's tag index, shifting later entries of its probe
+ * run back so no tombstones are needed. No-op for linearly searched sets.
+ *
+ * @param index The set containing the tag.
+ * @param tag The tag to remove; it must be in the set.
+ */
+void Cache::index_erase(uint32_t index, uint64_t tag) {
+    if (index_capacity == 0) {
+        return;
+    }
+
+    uint32_t* buckets = tag_index(index);
+    const uint32_t mask = index_capacity - 1;
+
+    uint32_t hole = tag_bucket(tag);
+    while (way_tag(index, buckets[hole] - 1) != tag) {
+        hole = (hole + 1) & mask;
+    }
+
+    for (uint32_t b = (hole + 1) & mask; buckets[b] != 0; b = (b + 1) & mask) {
+        // An entry may fill the hole if the hole lies between its home bucket
+        // and where it currently sits
+        uint32_t home = tag_bucket(way_tag(index, buckets[b] - 1));
+        if (((b - home) & mask) >= ((b - hole) & mask)) {
+            buckets[hole] = buckets[b];
+            hole = b;
+        }
+    }
+    buckets[hole] = 0;
+}
+
+/**
+ * Places a tag in a set, evicting the block the replacement policy picks if
+ * the set is already full.
+ *
+ * @param index The set to place the tag in.
+ * @param tag The tag to place.
+ * @param prefetch True if the prefetcher asked for the block.
+ * @return The way the tag now occupies.
+ */
+template <class Policy>
+uint32_t PolicyCache<Policy>::allocate(uint32_t index, uint64_t tag,
+                                       bool prefetch) {
+    if (cache[index].used < num_slots) {
+        // Space available — fill the next free way
+        return create_slot(index, tag);
+    }
+
+    // Set is full — evict the policy's victim and tell it what replaced it
+    uint32_t victim = policy.victim(policy_state(index), num_slots);
+    evict(index, victim, tag, prefetch);
+    policy.on_replace(policy_state(index), num_slots, victim);
+    return victim;
+}
+
+/**
+ * Evicts the block in the given way and replaces its metadata with a new tag.
+ * The old block goes to the next level, which must write it back if it is
+ * dirty. In an inclusive hierarchy it is also dropped from the levels above,
+ * and any modified copy there is folded into the write-back.
+ * The policy state is left alone; callers update it. The other levels may
+ * widen this cache while they handle the victim (see get_tag), so no
+ * pointer into the set is held across those calls.
  *
- * @param s The cache slot to evict.
- * @param new_tag The tag to assign to the slot after eviction.
+ * @param index The set containing the way.
+ * @param way The way to evict.
+ * @param new_tag The tag to assign to the way after eviction.
+ * @param prefetch True if the new block was asked for by the prefetcher.
  */
-Cache::Slot* Cache::evict(Slot* s, uint32_t new_tag) {
-    if (s->dirty and hit_write_type) {
+template <class Policy>
+void PolicyCache<Policy>::evict(uint32_t index, uint32_t way,
+                                uint64_t new_tag, bool prefetch) {
+    uint32_t flags = way_array(index, FLAGS)[way];
+    uint64_t tag = way_tag(index, way);
+
+    bool dirty = (flags & SLOT_DIRTY) != 0;
+
+    uint64_t victim = block_address(index, tag);
+    if (prefetcher) {
+        drop_prefetched(victim, flags, prefetch);
+    }
+    if (inclusion == Inclusion::INCLUSIVE) {
+        for (Cache* upper : upper_levels) {
+            dirty |= upper->invalidate_block(victim, num_bytes);
+        }
+    }
+
+    if (next_level != nullptr) {
+        total_cycles += next_level->evict_block(victim, num_bytes, dirty);
+        writebacks += dirty;
+    } else if (dirty) {
         // If write-back and dirty, write back to memory on eviction
         total_cycles +=
             (memory_cost * writes_per_block);  // Cost to write back to memory
+        ++writebacks;
     }
-    s->tag = new_tag;
-    s->valid = false;
-    s->dirty = false;
-    s->load_ts = current_time;
-    s->access_ts = current_time;
 
-    return s;
+    index_erase(index, tag);
+    set_way_tag(index, way, new_tag);
+    way_array(index, FLAGS)[way] = SLOT_VALID;
+    index_insert(index, new_tag, way);
 }
 
 /**
- * Creates a new slot for the given tag.
- * Only called when a set has available space.
+ * Fills the next free way of a set with the given tag and hands it to the
+ * replacement policy. Only called when a set has available space.
  *
+ * @param index The set to fill.
  * @param tag The tag associated with the new slot.
- * @return A pointer to the newly created slot.
+ * @return The way that was filled.
  */
-Cache::Slot* Cache::create_slot(uint32_t tag) {
-    Cache::Slot* new_slot =
-        new Cache::Slot(tag, false, false, current_time, current_time);
-    return new_slot;
+template <class Policy>
+uint32_t PolicyCache<Policy>::create_slot(uint32_t index, uint64_t tag) {
+    uint32_t way = cache[index].used++;
+
+    set_way_tag(index, way, tag);
+    way_array(index, FLAGS)[way] = SLOT_VALID;
+    index_insert(index, tag, way);
+    policy.on_insert(policy_state(index), num_slots, cache[index].used, way);
+    return way;
+}
+
+/**
+ * Empties a way. Ways [0, used) must stay filled, so the set's last filled
+ * way moves into the hole, taking its tag index entry and its replacement
+ * state with it.
+ *
+ * @param index The set containing the way.
+ * @param way The way to empty.
+ */
+template <class Policy>
+void PolicyCache<Policy>::remove_way(uint32_t index, uint32_t way) {
+    uint32_t* flags = way_array(index, FLAGS);
+    uint64_t tag = way_tag(index, way);
+
+    index_erase(index, tag);
+    if (prefetcher) {
+        drop_prefetched(block_address(index, tag), flags[way], false);
+    }
+
+    uint32_t last = --cache[index].used;
+    policy.on_remove(policy_state(index), num_slots, way, last);
+    if (way == last) {
+        return;
+    }
+
+    // Move the last way into the hole
+    uint64_t moved = way_tag(index, last);
+    index_erase(index, moved);
+    set_way_tag(index, way, moved);
+    flags[way] = flags[last];
+    index_insert(index, moved, way);
+}
+
+/**
+ * Reads the block containing an address from the level below (main memory
+ * unless a next level was set).
+ *
+ * @param address Any address in the block.
+ * @param dirty Set to true if the level below handed over a modified copy.
+ * @return Cycles taken.
+ */
+uint64_t Cache::fetch_block(uint64_t address, bool& dirty) {
+    if (next_level == nullptr) {
+        dirty = false;
+        return memory_cost * writes_per_block;
+    }
+    uint64_t block = address & ~uint64_t{num_bytes - 1};
+    return next_level->read_block(block, num_bytes, dirty);
+}
+
+/**
+ * Writes one word through to the level below.
+ *
+ * @param address Address written.
+ * @return Cycles taken.
+ */
+uint64_t Cache::write_through(uint64_t address) {
+    if (next_level == nullptr) {
+        return memory_cost;
+    }
+    return next_level->write_word(address);
+}
+
+/**
+ * Passes a block this level does not keep on to the level below.
+ *
+ * @param address Address of the first byte of the block.
+ * @param bytes Length of the block.
+ * @param dirty True if the block was modified.
+ * @return Cycles taken.
+ */
+uint64_t Cache::forward_block(uint64_t address, uint32_t bytes, bool dirty) {
+    if (next_level == nullptr) {
+        return dirty ? memory_cost * (bytes / 4) : 0;
+    }
+    return next_level->evict_block(address, bytes, dirty);
+}
+
+/**
+ * Starts the fill of a missed block. A blocking cache waits for the whole
+ * fill. Otherwise the fill takes an MSHR until it completes and the access
+ * stream carries on, waiting only if every MSHR is busy, until the first
+ * of them frees up.
+ *
+ * @param address Address missed.
+ * @param latency Cycles the fill takes.
+ * @return Cycles the access stream waits.
+ */
+uint64_t Cache::issue_fill(uint64_t address, uint64_t latency) {
+    if (mshr_count == 0) {
+        return latency;
+    }
+
+    // Free the MSHRs of completed fills
+    for (size_t i = 0; i < fills.size();) {
+        if (fills[i].ready <= total_cycles) {
+            fills[i] = fills.back();
+            fills.pop_back();
+        } else {
+            ++i;
+        }
+    }
+
+    uint64_t stall = 0;
+    if (fills.size() == mshr_count) {
+        auto first = std::min_element(
+            fills.begin(), fills.end(),
+            [](const Fill& a, const Fill& b) { return a.ready < b.ready; });
+        stall = first->ready - total_cycles;
+        *first = fills.back();
+        fills.pop_back();
+
+        ++mshr_stats.full_stalls;
+        fill_stalls += stall;
+    }
+
+    uint64_t ready = total_cycles + stall + latency;
+    fills.push_back({address & ~uint64_t{num_bytes - 1}, ready});
+    fills_done = std::max(fills_done, ready);
+    ++mshr_stats.fills;
+    fill_latency += latency;
+    return stall;
+}
+
+/**
+ * Counts a hit on a block whose fill is still in flight as merged into its
+ * MSHR. The access does not wait for the data.
+ *
+ * @param address Address accessed.
+ */
+void Cache::merge_fill(uint64_t address) {
+    uint64_t block = address & ~uint64_t{num_bytes - 1};
+    for (const Fill& fill : fills) {
+        if (fill.block == block && fill.ready > total_cycles) {
+            ++mshr_stats.merged;
+            return;
+        }
+    }
+}
+
+/**
+ * Reports the MSHR counters. The overlapped cycles are the fill latency
+ * the access stream did not wait for: all of it, less the stalls for a free
+ * MSHR and for the fills still in flight at the end.
+ *
+ * @return The counters.
+ */
+MshrStats Cache::get_mshr_stats() {
+    MshrStats stats = mshr_stats;
+    uint64_t drain = get_cycles() - total_cycles;
+    stats.overlapped = fill_latency - fill_stalls - drain;
+    return stats;
+}
+
+/**
+ * Classifies a demand access for the prefetcher. The first use of a
+ * prefetched block counts it as useful, and as late if the fetch has not
+ * completed yet, in which case the access waits for it. A miss on a block
+ * that a prefetch evicted counts as pollution.
+ *
+ * @param address Address accessed.
+ * @param index The set accessed.
+ * @param way The way holding the block, or num_slots on a miss.
+ * @return What the access found.
+ */
+Prefetcher::Access Cache::note_demand(uint64_t address, uint32_t index,
+                                      uint32_t way) {
+    uint64_t block = address & ~uint64_t{num_bytes - 1};
+
+    if (way == num_slots) {
+        if (prefetch_victims.erase(block) != 0) {
+            ++prefetch_stats.pollution;
+        }
+        return Prefetcher::MISS;
+    }
+
+    uint32_t& flags = way_array(index, FLAGS)[way];
+    if ((flags & SLOT_PREFETCHED) == 0) {
+        return Prefetcher::HIT;
+    }
+
+    flags &= ~SLOT_PREFETCHED;
+    ++prefetch_stats.useful;
+
+    auto ready = prefetch_ready.find(block);
+    if (ready->second > total_cycles) {
+        ++prefetch_stats.late;
+        total_cycles = ready->second;  // Wait for the fill to arrive
+    }
+    prefetch_ready.erase(ready);
+    return Prefetcher::PREFETCH_HIT;
+}
+
+/**
+ * Forgets the prefetch bookkeeping of a block leaving the cache. A
+ * prefetched block that was never used counts as unused, and a block
+ * evicted for a prefetch is remembered so a later miss on it counts as
+ * pollution.
+ *
+ * @param address Address of the first byte of the block.
+ * @param flags The block's flags.
+ * @param by_prefetch True if the block makes room for a prefetched block.
+ */
+void Cache::drop_prefetched(uint64_t address, uint32_t flags,
+                            bool by_prefetch) {
+    if (flags & SLOT_PREFETCHED) {
+        ++prefetch_stats.unused;
+        prefetch_ready.erase(address);
+    }
+    if (by_prefetch) {
+        prefetch_victims.insert(address);
+    }
+}
+
+/**
+ * Rebuilds the address of the first byte of a cached block.
+ *
+ * @param index The block's set.
+ * @param tag The block's tag.
+ * @return The block address.
+ */
+uint64_t Cache::block_address(uint32_t index, uint64_t tag) {
+    return (tag << (offset_size + index_size)) |
+           (static_cast<uint64_t>(index) << offset_size);
+}
+
+/**
+ * Drops every block overlapping [address, address + bytes) from this level
+ * and, recursively, from the levels above it.
+ *
+ * @param address Start of the range.
+ * @param bytes Length of the range.
+ * @return True if any dropped block was dirty.
+ */
+template <class Policy>
+bool PolicyCache<Policy>::invalidate_block(uint64_t address, uint32_t bytes) {
+    bool dirty = false;
+
+    // Count the blocks from the last byte so a range ending at the top of
+    // the address space does not wrap
+    uint64_t first = address & ~uint64_t{num_bytes - 1};
+    uint64_t blocks = (address + (bytes - 1) - first) / num_bytes + 1;
+    for (uint64_t i = 0; i < blocks; ++i) {
+        uint64_t block_addr = first + i * num_bytes;
+
+        // The levels above may hold the block even if this one does not
+        for (Cache* upper : upper_levels) {
+            dirty |= upper->invalidate_block(block_addr, num_bytes);
+        }
+
+        uint32_t index = get_index(block_addr);
+        uint32_t way = find_way(index, get_tag(block_addr));
+        if (way != num_slots) {
+            dirty |= (way_array(index, FLAGS)[way] & SLOT_DIRTY) != 0;
+            remove_way(index, way);
+        }
+    }
+    return dirty;
+}
+
+/**
+ * Marks the block holding an address clean.
+ *
+ * @param address Any address in the block.
+ * @return True if the block was cached and dirty.
+ */
+bool Cache::clean_block(uint64_t address) {
+    uint32_t index = get_index(address);
+    uint32_t way = find_way(index, get_tag(address));
+    if (way == num_slots) {
+        return false;
+    }
+
+    uint32_t& flags = way_array(index, FLAGS)[way];
+    bool dirty = (flags & SLOT_DIRTY) != 0;
+    flags &= ~SLOT_DIRTY;
+    return dirty;
+}
+
+/**
+ * Zeroes the counters of a cache with no fills in flight.
+ */
+void Cache::reset_stats() {
+    total_loads = 0;
+    total_stores = 0;
+    load_hits = 0;
+    load_misses = 0;
+    store_hits = 0;
+    store_misses = 0;
+    total_cycles = 0;
+    writebacks = 0;
+    fills_done = 0;
+    prefetch_stats = PrefetchStats();
+    mshr_stats = MshrStats();
+}
+
+/**
+ * Serves a block read for a miss in the level above. A non-exclusive level
+ * treats it as an ordinary load (allocating on a miss); an exclusive level
+ * hands its copy up and drops it, and on a miss passes the block through
+ * from below without keeping it.
+ *
+ * @param address Address of the first byte of the block.
+ * @param bytes Block size of the requesting level (at most this level's).
+ * @param dirty Set to true if a modified copy is handed up.
+ * @return Cycles taken.
+ */
+template <class Policy>
+uint64_t PolicyCache<Policy>::read_block(uint64_t address,
+                                         uint32_t /* bytes */, bool& dirty) {
+    uint64_t before = total_cycles;
+
+    if (inclusion != Inclusion::EXCLUSIVE) {
+        PolicyCache::load(address);
+        dirty = false;
+        return total_cycles - before;
+    }
+
+    ++total_loads;
+    uint32_t index = get_index(address);
+    uint32_t way = find_way(index, get_tag(address));
+
+    total_cycles += cache_cost;
+    if (way != num_slots) {
+        ++load_hits;
+        dirty = (way_array(index, FLAGS)[way] & SLOT_DIRTY) != 0;
+        remove_way(index, way);
+    } else {
+        ++load_misses;
+        total_cycles += fetch_block(address, dirty);
+    }
+    return total_cycles - before;
+}
+
+/**
+ * Serves a word written through from the level above as a store. An
+ * exclusive level only updates a copy it already holds; any other write
+ * is passed down untouched, without counting as an access of this level.
+ *
+ * @param address Address written.
+ * @return Cycles taken.
+ */
+template <class Policy>
+uint64_t PolicyCache<Policy>::write_word(uint64_t address) {
+    if (inclusion == Inclusion::EXCLUSIVE &&
+        find_way(get_index(address), get_tag(address)) == num_slots) {
+        return write_through(address);
+    }
+
+    uint64_t before = total_cycles;
+    PolicyCache::store(address);
+    return total_cycles - before;
+}
+
+/**
+ * Receives a block evicted from the level above. Clean blocks are dropped
+ * unless this level is exclusive, in which case every victim of the level
+ * above is allocated here. Dirty blocks are merged into this level's copy
+ * (allocating one under write-allocate, fetching the rest of the block if
+ * the evicted block is smaller) or passed further down.
+ *
+ * @param address Address of the first byte of the block.
+ * @param bytes Block size of the evicting level.
+ * @param dirty True if the block was modified.
+ * @return Cycles taken.
+ */
+template <class Policy>
+uint64_t PolicyCache<Policy>::evict_block(uint64_t address, uint32_t bytes,
+                                          bool dirty) {
+    const bool exclusive = (inclusion == Inclusion::EXCLUSIVE);
+    if (!dirty && !exclusive) {
+        return 0;
+    }
+
+    uint64_t before = total_cycles;
+    uint32_t index = get_index(address);
+    uint64_t tag = get_tag(address);
+    uint32_t way = find_way(index, tag);
+
+    if (way == num_slots && !exclusive && !miss_write_type) {
+        // No-Write-Allocate: the block goes straight to the level below
+        total_cycles += forward_block(address, bytes, dirty);
+        return total_cycles - before;
+    }
+
+    total_cycles += cache_cost;
+    if (way == num_slots) {
+        if (bytes < num_bytes) {
+            // Only part of this level's block arrived from above
+            bool below_dirty;
+            total_cycles += fetch_block(address, below_dirty);
+            dirty |= below_dirty;
+        }
+        way = allocate(index, tag);
+    }
+
+    if (dirty) {
+        if (hit_write_type) {
+            way_array(index, FLAGS)[way] |= SLOT_DIRTY;
+        } else {
+            // Write-through: pass the modified block on as well
+            total_cycles += forward_block(address, bytes, true);
+        }
+    }
+    return total_cycles - before;
 }
 
 /**
  * Extracts the offset part of the address.
  *
- * @param address The full 32-bit memory address.
+ * @param address The full 64-bit memory address.
  * @return The offset portion.
  */
-uint32_t Cache::get_offset(uint32_t address) {
+uint32_t Cache::get_offset(uint64_t address) {
     uint32_t offset = address & ((1 << offset_size) - 1);
     return offset;
 }
@@ -273,21 +969,112 @@ uint32_t Cache::get_offset(uint32_t address) {
 /**
  * Extracts the index part of the address.
  *
- * @param address The full 32-bit memory address.
+ * @param address The full 64-bit memory address.
  * @return The index portion.
  */
-uint32_t Cache::get_index(uint32_t address) {
+uint32_t Cache::get_index(uint64_t address) {
     uint32_t index = (address >> offset_size) & ((1 << index_size) - 1);
     return index;
 }
 
 /**
- * Extracts the tag part of the address.
+ * Extracts the tag part of the address. The cache starts with one word per
+ * tag and is widened the first time a tag needs more, so every caller must
+ * get the tag before taking pointers into the set storage.
  *
- * @param address The full 32-bit memory address.
+ * @param address The full 64-bit memory address.
  * @return The tag portion.
  */
-uint32_t Cache::get_tag(uint32_t address) {
-    uint32_t tag = (address >> (offset_size + index_size));
+uint64_t Cache::get_tag(uint64_t address) {
+    uint64_t tag = (address >> (offset_size + index_size));
+    if (tag > UINT32_MAX && !wide) {
+        widen();
+    }
     return tag;
 }
+
+/**
+ * Gives every set a tags_hi array, moving the policy state and tag index
+ * up to make room. Existing tags fit in one word, so their upper halves
+ * start at zero, and the tag index hashes them to the same buckets.
+ */
+void Cache::widen() {
+    const size_t narrow_stride = set_stride;
+    const size_t tags_and_flags = 2 * static_cast<size_t>(num_slots);
+
+    set_stride += num_slots;
+    std::vector<uint32_t> wider(static_cast<size_t>(num_sets) * set_stride);
+    for (size_t set = 0; set < num_sets; ++set) {
+        const uint32_t* from = &ways[set * narrow_stride];
+        uint32_t* to = &wider[set * set_stride];
+
+        std::copy(from, from + tags_and_flags, to);
+        std::copy(from + tags_and_flags, from + narrow_stride,
+                  to + tags_and_flags + num_slots);
+    }
+
+    ways.swap(wider);
+    way_arrays = 3;
+    wide = true;
+}
+
+// Every policy make_cache() can pick
+template class PolicyCache<LruPolicy>;
+template class PolicyCache<FifoPolicy>;
+template class PolicyCache<PlruPolicy>;
+template class PolicyCache<SrripPolicy>;
+template class PolicyCache<BrripPolicy>;
+template class PolicyCache<LfuPolicy>;
+template class PolicyCache<RandomPolicy>;
+template class PolicyCache<OptPolicy>;
+
+/**
+ * Creates a cache with the replacement policy named in its configuration.
+ *
+ * @param config Geometry and policies of the cache.
+ * @param next_use Next-use index of the trace, required by OPT.
+ * @return The cache.
+ */
+std::unique_ptr<Cache> make_cache(const CacheConfig& config,
+                                  const std::vector<uint32_t>* next_use) {
+    switch (config.eviction) {
+        case Eviction::LRU:
+            return std::make_unique<PolicyCache<LruPolicy>>(config);
+        case Eviction::FIFO:
+            return std::make_unique<PolicyCache<FifoPolicy>>(config);
+        case Eviction::PLRU:
+            return std::make_unique<PolicyCache<PlruPolicy>>(config);
+        case Eviction::SRRIP:
+            return std::make_unique<PolicyCache<SrripPolicy>>(config);
+        case Eviction::BRRIP:
+            return std::make_unique<PolicyCache<BrripPolicy>>(config);
+        case Eviction::LFU:
+            return std::make_unique<PolicyCache<LfuPolicy>>(config);
+        case Eviction::RANDOM:
+            return std::make_unique<PolicyCache<RandomPolicy>>(config);
+        case Eviction::OPT:
+            assert(next_use != nullptr);
+            return std::make_unique<PolicyCache<OptPolicy>>(
+                config, OptPolicy(next_use));
+    }
+    return nullptr;
+}
+
+/**
+ * Creates a victim cache.
+ *
+ * @param config Number of blocks and hit latency.
+ * @param block_size Block size of the cache above.
+ * @return The victim cache.
+ */
+std::unique_ptr<Cache> make_victim_cache(const VictimConfig& config,
+                                         uint32_t block_size) {
+    // One fully associative write-back set; as an exclusive level it takes
+    // in every victim and gives up the blocks it hands back
+    CacheConfig buffer = {1, config.blocks, block_size, true, true,
+                          Eviction::LRU};
+    std::unique_ptr<Cache> victim = make_cache(buffer);
+    victim->set_inclusion(Inclusion::EXCLUSIVE);
+    victim->set_hit_latency(config.latency);
+    return victim;
+}
@@ -3,39 +3,92 @@
 
 #include <sys/types.h>
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
-#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
+#include "CacheConfig.h"
+#include "MemoryLevel.h"
+#include "MissProfile.h"
+#include "Prefetcher.h"
+#include "SetBuckets.h"
+#include "TraceReader.h"
+
 /**
- * Class representing a configurable cache memory simulation.
+ * Counters reported at the end of a simulation.
  */
-class Cache {
-public:
-    /**
-     * Constructor to initialize the cache with specified parameters.
-     *
-     * @param sets Number of sets in the cache.
-     * @param blocks Number of blocks (slots) per set.
-     * @param bytes Number of bytes per block.
-     * @param miss_write_type True for Write-Allocate, False for
-     * No-Write-Allocate.
-     * @param hit_write_type True for Write-Back, False for Write-Through.
-     * @param eviction_type True for LRU, False for FIFO.
-     */
-    Cache(uint32_t sets, uint32_t blocks, uint32_t bytes, bool miss_write_type,
-          bool hit_write_type, bool eviction_type);
+struct CacheStats {
+    uint64_t loads = 0;
+    uint64_t stores = 0;
+    uint64_t load_hits = 0;
+    uint64_t load_misses = 0;
+    uint64_t store_hits = 0;
+    uint64_t store_misses = 0;
+    uint64_t cycles = 0;
+    uint64_t writebacks = 0;  // Dirty blocks written to the level below
+
+    // Accumulates the counters of another (disjoint) simulation
+    CacheStats &operator+=(const CacheStats &other) {
+        loads += other.loads;
+        stores += other.stores;
+        load_hits += other.load_hits;
+        load_misses += other.load_misses;
+        store_hits += other.store_hits;
+        store_misses += other.store_misses;
+        cycles += other.cycles;
+        writebacks += other.writebacks;
+        return *this;
+    }
+};
+
+/**
+ * Counters of a cache's miss-status holding registers (see set_mshrs).
+ */
+struct MshrStats {
+    uint64_t fills = 0;        // Demand misses that took an MSHR
+    uint64_t merged = 0;       // Accesses to a block whose fill was pending
+    uint64_t full_stalls = 0;  // Misses that waited for a free MSHR
+    uint64_t overlapped = 0;   // Fill cycles hidden under other accesses
+};
 
-    // destructor
-    ~Cache();
+/**
+ * How a lower cache level relates to the contents of the levels above it.
+ */
+enum class Inclusion {
+    NINE,       // Non-inclusive non-exclusive: fills go to every level
+    INCLUSIVE,  // Evictions also invalidate the block in the levels above
+    EXCLUSIVE   // A block lives in one level: hits move it up, and victims
+                // of the level above move down into this one
+};
 
+/**
+ * Class representing a configurable cache memory simulation.
+ *
+ * On its own a Cache models a single level in front of main memory with a
+ * fixed `memory_cost`. Caches can also be chained into a hierarchy: a miss,
+ * write-through or eviction then goes to the next level (any MemoryLevel)
+ * instead of to memory. A DramModel (see Dram.h) as the last level's next
+ * level replaces the fixed cost with a model of DRAM banks and row buffers.
+ *
+ * Cache holds the geometry, the per-set storage and the counters shared by
+ * every cache; the access logic lives in PolicyCache, which is specialized
+ * for one replacement policy at compile time. Create caches with
+ * make_cache().
+ */
+class Cache : public MemoryLevel {
+public:
     /**
      * Loads an address from the cache or memory. Handles eviction and loading.
      *
      * @param address Address to be loaded.
      * @return True if the load resulted in a cache hit, otherwise false.
      */
-    bool load(uint32_t address);
+    virtual bool load(uint64_t address) = 0;
 
     /**
      * Stores to an address in the cache or memory. Handles eviction and
@@ -44,7 +97,22 @@ public:
      * @param address Address to be stored.
      * @return True if the store resulted in a cache hit, otherwise false.
      */
-    bool store(uint32_t address);
+    virtual bool store(uint64_t address) = 0;
+
+    /**
+     * Runs a batch of trace records through the cache: stores as stores,
+     * loads and instruction fetches as loads. Prefer this to per-record
+     * load/store calls, which go through a virtual call each.
+     *
+     * When nothing ties the sets of the cache together (see
+     * set_bucketing), the batch is decomposed into indexes and tags up
+     * front and simulated set by set, each set seeing its own accesses in
+     * trace order, which gives the same results as simulating in order.
+     *
+     * @param records The records.
+     * @param count Number of records.
+     */
+    virtual void simulate(const TraceRecord *records, size_t count) = 0;
 
     // ---------------------- (Getters for private variables)
     // ------------------------------
@@ -52,89 +120,374 @@ public:
     /**
      * @return  Total cache loads
      */
-    uint32_t get_loads() { return total_loads; }
+    uint64_t get_loads() { return total_loads; }
 
     /**
      * @return Total cache store
      */
-    uint32_t get_stores() { return total_stores; }
+    uint64_t get_stores() { return total_stores; }
 
     /**
      * @retrun Total cache load hits
      */
-    uint32_t get_load_hits() { return load_hits; }
+    uint64_t get_load_hits() { return load_hits; }
 
     /**
      * @return Total cache load misses
      */
-    uint32_t get_load_misses() { return load_misses; }
+    uint64_t get_load_misses() { return load_misses; }
 
     /**
      * @return Total cache store hits
      */
-    uint32_t get_store_hits() { return store_hits; }
+    uint64_t get_store_hits() { return store_hits; }
 
     /**
      * @return Total cache store misses
      */
-    uint32_t get_store_misses() { return store_misses; }
+    uint64_t get_store_misses() { return store_misses; }
 
     /**
-     * @return Total cycles in cache simulation
+     * @return Total cycles in cache simulation, including fills still
+     * outstanding at the end
      */
-    uint32_t get_cycles() { return total_cycles; }
+    uint64_t get_cycles() { return std::max(total_cycles, fills_done); }
 
-private:
-    // Simulated clock time, updated on each load/store operation
-    int current_time = 0;
-
-    /**
-     * Structure representing a cache block (slot).
-     */
-    struct Slot {
-        uint32_t tag;
-        bool valid;
-        bool dirty;
-        uint32_t load_ts;    // Time when block was loaded (for FIFO)
-        uint32_t access_ts;  // Last access time (for LRU)
-
-        // slot constructor
-        Slot(uint32_t tag, bool valid, bool dirty, uint32_t load_ts,
-             uint32_t access_ts)
-            : tag(tag),
-              valid(valid),
-              dirty(dirty),
-              load_ts(load_ts),
-              access_ts(access_ts) {}
+    /**
+     * @return Dirty blocks written back to the level below
+     */
+    uint64_t get_writebacks() { return writebacks; }
+
+    /**
+     * @return All of the counters above
+     */
+    CacheStats get_stats() {
+        CacheStats stats;
+        stats.loads = total_loads;
+        stats.stores = total_stores;
+        stats.load_hits = load_hits;
+        stats.load_misses = load_misses;
+        stats.store_hits = store_hits;
+        stats.store_misses = store_misses;
+        stats.cycles = get_cycles();
+        stats.writebacks = writebacks;
+        return stats;
+    }
+
+    /**
+     * @return Counters of the prefetcher (all zero without one)
+     */
+    PrefetchStats get_prefetch_stats() { return prefetch_stats; }
+
+    /**
+     * @return Counters of the MSHRs (all zero for a blocking cache)
+     */
+    MshrStats get_mshr_stats();
+
+    // ---------------------- (Prefetching)
+    // ------------------------------
+
+    /**
+     * Puts a prefetcher in front of this cache. It observes every load and
+     * store, and the blocks it asks for are filled through the normal
+     * allocation and eviction path.
+     *
+     * @param prefetcher The prefetcher, or null for none.
+     */
+    void set_prefetcher(std::unique_ptr<Prefetcher> prefetcher) {
+        this->prefetcher = std::move(prefetcher);
+    }
+
+    // ---------------------- (Non-blocking misses)
+    // ------------------------------
+
+    /**
+     * Makes the cache non-blocking with a bounded number of miss-status
+     * holding registers. A demand miss then takes an MSHR for as long as
+     * its fill is in flight instead of stalling the access stream; later
+     * accesses to the block merge into it, and the stream only waits when
+     * every MSHR is busy. Fills still in flight at the end are included in
+     * the cycle count.
+     *
+     * @param count Number of MSHRs, or 0 for a blocking cache.
+     */
+    void set_mshrs(uint32_t count) { mshr_count = count; }
+
+    /**
+     * Lets batches be simulated grouped by set (see simulate). It only
+     * takes effect while the sets are independent: without a prefetcher,
+     * MSHRs, levels above or below, or the OPT policy, all of which see
+     * the accesses of every set in trace order. By default it is on for
+     * caches whose set storage outgrows the host's L2 cache, where it
+     * saves more cache misses than it costs.
+     *
+     * @param enabled True to allow grouping by set.
+     */
+    void set_bucketing(bool enabled) { bucketing = enabled; }
+
+    // ---------------------- (Profiling)
+    // ------------------------------
+
+    /**
+     * Records every demand miss of this cache in a profile.
+     *
+     * @param profile The profile, or null to stop profiling.
+     */
+    void set_miss_profile(MissProfile *profile) { miss_profile = profile; }
+
+    // ---------------------- (Multi-level hierarchies)
+    // ------------------------------
+
+    /**
+     * Puts another level behind this cache in place of main memory.
+     *
+     * @param next The level misses, write-throughs and evictions go to.
+     */
+    void set_next_level(MemoryLevel *next) { next_level = next; }
+
+    /**
+     * Registers a cache that uses this one as its next level, so inclusive
+     * evictions can invalidate it.
+     *
+     * @param upper The level above.
+     */
+    void add_upper_level(Cache *upper) { upper_levels.push_back(upper); }
+
+    /**
+     * Puts a level in between this cache and one of its upper levels.
+     *
+     * @param upper The current upper level.
+     * @param between The level now directly above this one.
+     */
+    void replace_upper_level(Cache *upper, Cache *between) {
+        std::replace(upper_levels.begin(), upper_levels.end(), upper,
+                     between);
+    }
+
+    /**
+     * @param policy How this level treats the blocks of the levels above.
+     */
+    void set_inclusion(Inclusion policy) { inclusion = policy; }
+
+    /**
+     * @param cycles Cost of an access that hits in this level.
+     */
+    void set_hit_latency(uint32_t cycles) { cache_cost = cycles; }
+
+    /**
+     * @return Number of bytes per block
+     */
+    uint32_t get_block_size() { return num_bytes; }
+
+    /**
+     * Drops every block overlapping [address, address + bytes) from this
+     * level and the levels above it.
+     *
+     * @param address Start of the range.
+     * @param bytes Length of the range.
+     * @return True if any dropped block was dirty.
+     */
+    virtual bool invalidate_block(uint64_t address, uint32_t bytes) = 0;
+
+    /**
+     * Marks the block holding an address clean, once its modified data has
+     * been written to the level below by someone else (e.g. a coherence
+     * protocol downgrading it).
+     *
+     * @param address Any address in the block.
+     * @return True if the block was cached and dirty.
+     */
+    bool clean_block(uint64_t address);
+
+    // ---------------------- (Checkpoints)
+    // ------------------------------
+
+    /**
+     * Writes the blocks, replacement state and counters of this cache to a
+     * checkpoint file (see Checkpoint.h). Attached levels, the prefetcher's
+     * training and fills still in flight are not part of it. Problems are
+     * reported on standard error.
+     *
+     * @param path Path of the checkpoint.
+     * @return 0 on success, otherwise the csim exit code for the problem.
+     */
+    int save_checkpoint(const std::string &path);
+
+    /**
+     * Replaces the blocks, replacement state and counters of this cache
+     * with those of a checkpoint taken of a cache with the same geometry
+     * and policies. Problems are reported on standard error.
+     *
+     * @param path Path of the checkpoint.
+     * @return 0 on success, otherwise the csim exit code for the problem.
+     */
+    int restore_checkpoint(const std::string &path);
+
+    /**
+     * Zeroes the counters of a cache with no fills in flight, keeping its
+     * blocks (e.g. after restoring a warmed-up checkpoint).
+     */
+    void reset_stats();
+
+protected:
+    /**
+     * Sets up the geometry and the (empty) per-set storage.
+     *
+     * @param config Geometry and policies of the cache.
+     * @param policy_words Words of replacement state kept per set.
+     */
+    Cache(const CacheConfig &config, uint32_t policy_words);
+
+    /**
+     * Flag bits kept for every way of a set.
+     */
+    enum SlotFlags : uint32_t {
+        SLOT_VALID = 1u << 0,
+        SLOT_DIRTY = 1u << 1,
+        SLOT_PREFETCHED = 1u << 2,  // Prefetched and not yet used
     };
 
     /**
-     * Structure representing a cache set, containing multiple slots.
-     * Uses a map for the underlaying data structure becasue we could
-     * efficiently look up a tag in the set
+     * Structure representing a cache set.
+     *
+     * The ways of a set are not stored in the Set itself: every set owns one
+     * contiguous block of `set_stride` words in `ways`, laid out as a
+     * structure of arrays so a tag lookup only walks the tag array:
+     *
+     *   [tags: num_slots][flags: num_slots]([tags_hi: num_slots])
+     *   [policy state: policy_words][tag index: index_capacity]
+     *
+     * Tags start out as single words, which covers every 32-bit address.
+     * The first tag that needs more bits widens the cache in place: every
+     * set gains a tags_hi array with the upper 32 bits of its tags, so
+     * traces of small addresses never pay for 64-bit tags.
+     *
+     * Ways are filled front to back, so ways [0, used) are always valid.
+     * The replacement policy keeps whatever it needs to pick victims (a
+     * recency list, counters, tree bits...) in its state words.
+     *
+     * Highly associative sets also keep a tag index (an open-addressed hash
+     * of tag -> way + 1) so lookups stay O(1) instead of scanning every way.
      */
     struct Set {
-        std::map<uint32_t, Slot *> index;
+        uint32_t used = 0;  // Number of ways currently holding a block
     };
 
+    // Offsets (in num_slots words) of each per-way array inside a set block
+    enum BlockArray : uint32_t { TAGS = 0, FLAGS = 1, TAGS_HI = 2 };
+
+    // Sets with more ways than this use a tag index instead of a linear scan
+    static const uint32_t LINEAR_LOOKUP_WAYS = 32;
+
     // Cache data: collection of sets
     std::vector<Set> cache;
 
-    // Evicts a slot from the cache and loads a new tag
-    Slot *evict(Slot *s, uint32_t new_tag);
+    // Per-way state of every set, one block of `set_stride` words per set
+    std::vector<uint32_t> ways;
 
-    //  Used for populating the cache until max size is reached in a set
-    //  Attempts to add a slot to a set if capacity allows
-    Slot *create_slot(uint32_t tag);
+    // Returns the start of the per-way array `array` of set `index`
+    uint32_t *way_array(uint32_t index, BlockArray array) {
+        return &ways[static_cast<size_t>(index) * set_stride +
+                     static_cast<size_t>(array) * num_slots];
+    }
+
+    // Returns the replacement policy state of set `index`
+    uint32_t *policy_state(uint32_t index) {
+        return &ways[static_cast<size_t>(index) * set_stride +
+                     static_cast<size_t>(way_arrays) * num_slots];
+    }
+
+    // Returns the buckets of the tag index of set `index`
+    uint32_t *tag_index(uint32_t index) {
+        return policy_state(index) + policy_words;
+    }
+
+    // Returns the home bucket of a tag in a tag index. Folding the upper
+    // half in leaves the bucket of a 32-bit tag unchanged by widening
+    uint32_t tag_bucket(uint64_t tag) {
+        uint32_t folded = static_cast<uint32_t>(tag ^ (tag >> 32));
+        return (folded * 2654435761u) >> index_shift;
+    }
+
+    // Returns the tag held by `way` of set `index`
+    uint64_t way_tag(uint32_t index, uint32_t way) {
+        uint64_t tag = way_array(index, TAGS)[way];
+        if (wide) {
+            tag |= uint64_t{way_array(index, TAGS_HI)[way]} << 32;
+        }
+        return tag;
+    }
+
+    // Makes `way` of set `index` hold `tag`
+    void set_way_tag(uint32_t index, uint32_t way, uint64_t tag) {
+        way_array(index, TAGS)[way] = static_cast<uint32_t>(tag);
+        if (wide) {
+            way_array(index, TAGS_HI)[way] = static_cast<uint32_t>(tag >> 32);
+        }
+    }
+
+    // Gives every set a tags_hi array so tags of any width fit
+    void widen();
+
+    // Returns the way holding `tag` in set `index`, or num_slots on a miss
+    uint32_t find_way(uint32_t index, uint64_t tag);
+
+    // Adds / removes the way holding `tag` to / from the tag index of a set
+    void index_insert(uint32_t index, uint64_t tag, uint32_t way);
+    void index_erase(uint32_t index, uint64_t tag);
+
+    // True if the replacement state of set `index` is usable by the policy
+    virtual bool valid_policy_state(uint32_t index) = 0;
+
+    // Checks the sets just read from a checkpoint and rebuilds their tag
+    // indexes; false if any set is damaged
+    bool restored_sets_valid();
+
+    // Reads the block containing `address` from the level below
+    uint64_t fetch_block(uint64_t address, bool &dirty);
+
+    // Writes one word through to the level below
+    uint64_t write_through(uint64_t address);
+
+    // Passes a block this level does not keep on to the level below
+    uint64_t forward_block(uint64_t address, uint32_t bytes, bool dirty);
+
+    // Starts the fill of a missed block taking `latency` cycles and returns
+    // the cycles the access stream waits for it
+    uint64_t issue_fill(uint64_t address, uint64_t latency);
+
+    // Counts a hit on a block whose fill is still in flight
+    void merge_fill(uint64_t address);
+
+    // Tells what a demand access to `way` (num_slots on a miss) of set
+    // `index` found, updating the prefetch counters and stalling for a
+    // prefetch still in flight
+    Prefetcher::Access note_demand(uint64_t address, uint32_t index,
+                                   uint32_t way);
+
+    // Forgets the prefetch bookkeeping of a block leaving the cache;
+    // `by_prefetch` is true if it makes room for a prefetched block
+    void drop_prefetched(uint64_t address, uint32_t flags, bool by_prefetch);
+
+    // Rebuilds the address of the first byte of a cached block
+    uint64_t block_address(uint32_t index, uint64_t tag);
 
     // Extracts offset bits from an address
-    uint32_t get_offset(uint32_t address);
+    uint32_t get_offset(uint64_t address);
 
     // Extracts index bits from an address
-    uint32_t get_index(uint32_t address);
+    uint32_t get_index(uint64_t address);
 
-    // Extracts tag bits from an address
-    uint32_t get_tag(uint32_t address);
+    // Extracts tag bits from an address, widening the cache first if they
+    // do not fit in one word
+    uint64_t get_tag(uint64_t address);
+
+    // True if batches may be simulated grouped by set right now
+    bool sets_independent() const {
+        return bucketing && eviction != Eviction::OPT && !prefetcher &&
+               mshr_count == 0 && next_level == nullptr &&
+               upper_levels.empty();
+    }
 
     // Configuration parameters
     const uint32_t num_sets;          // Number of sets in the cache
@@ -147,25 +500,165 @@ private:
     const bool
         miss_write_type;  // True: Write-Allocate, False: No-Write-Allocate
     const bool hit_write_type;  // True: Write-Back, False: Write-Through
-    const bool eviction_type;   // True: LRU, False: FIFO
+    const Eviction eviction;    // Replacement policy
 
     // We get these using log2 of the Configuration parameters
     const uint32_t offset_size;  // Number of bits for offset
     const uint32_t index_size;   // Number of bits for index
     const uint32_t tag_size;     // Number of bits for tag
 
+    // Tag index geometry (index_capacity is 0 for linearly searched sets)
+    const uint32_t index_capacity;  // Buckets per set, a power of 2
+    const uint32_t index_shift;     // Shift turning a hash into a bucket
+
+    // Words of replacement state, and of all per-way state, kept per set
+    const uint32_t policy_words;
+    uint32_t set_stride;
+
+    // Per-way arrays of each set: 2, or 3 once tags_hi is added
+    uint32_t way_arrays = 2;
+    bool wide = false;  // Tags have two words
+
     // Cache statistics
-    uint32_t total_loads = 0;
-    uint32_t total_stores = 0;
-    uint32_t load_hits = 0;
-    uint32_t load_misses = 0;
-    uint32_t store_hits = 0;
-    uint32_t store_misses = 0;
-    uint32_t total_cycles = 0;
+    uint64_t total_loads = 0;
+    uint64_t total_stores = 0;
+    uint64_t load_hits = 0;
+    uint64_t load_misses = 0;
+    uint64_t store_hits = 0;
+    uint64_t store_misses = 0;
+    uint64_t total_cycles = 0;
+    uint64_t writebacks = 0;
 
     // Timing costs (in cycles)
-    const uint32_t cache_cost = 1;     // Cache access cost
-    const uint32_t memory_cost = 100;  // Memory access cost
+    uint32_t cache_cost = 1;           // Cache access cost
+    const uint32_t memory_cost = 100;  // Flat memory cost per word
+
+    // Prefetching
+    std::unique_ptr<Prefetcher> prefetcher;  // nullptr: no prefetching
+    PrefetchStats prefetch_stats;
+    std::vector<uint64_t> prefetch_queue;  // Blocks the prefetcher asked for
+    std::unordered_map<uint64_t, uint64_t>
+        prefetch_ready;  // Unused prefetched block -> cycle it arrives
+    std::unordered_set<uint64_t>
+        prefetch_victims;  // Blocks evicted to make room for a prefetch
+
+    /**
+     * A miss-status holding register: a block being filled.
+     */
+    struct Fill {
+        uint64_t block;  // Address of the block
+        uint64_t ready;  // Cycle the fill completes
+    };
+
+    // Non-blocking misses
+    uint32_t mshr_count = 0;   // 0: every miss stalls for its fill
+    std::vector<Fill> fills;   // Fills in flight, at most mshr_count
+    MshrStats mshr_stats;
+    uint64_t fill_latency = 0;  // Latency of every fill issued
+    uint64_t fill_stalls = 0;   // Cycles spent waiting for a free MSHR
+    uint64_t fills_done = 0;    // Cycle the last fill completes
+
+    // Batches grouped by set
+    bool bucketing;
+    SetBuckets set_buckets;
+
+    // Profiling
+    MissProfile *miss_profile = nullptr;  // nullptr: no profiling
+
+    // Hierarchy links
+    MemoryLevel *next_level = nullptr;  // nullptr: main memory is next
+    std::vector<Cache *> upper_levels;  // Caches whose next level is this
+    Inclusion inclusion = Inclusion::NINE;
+};
+
+/**
+ * A cache specialized for one replacement policy (see ReplacementPolicy.h).
+ * Every policy hook is resolved at compile time, so a load or store makes
+ * no virtual calls unless it has to reach another level.
+ */
+template <class Policy>
+class PolicyCache final : public Cache {
+public:
+    /**
+     * Constructor to initialize the cache from a parsed configuration.
+     *
+     * @param config Geometry and policies of the cache.
+     * @param policy The replacement policy.
+     */
+    explicit PolicyCache(const CacheConfig &config, Policy policy = Policy());
+
+    bool load(uint64_t address) override;
+    bool store(uint64_t address) override;
+    void simulate(const TraceRecord *records, size_t count) override;
+    bool invalidate_block(uint64_t address, uint32_t bytes) override;
+
+    // MemoryLevel interface, used when this cache is a lower level
+    uint64_t read_block(uint64_t address, uint32_t bytes,
+                        bool &dirty) override;
+    uint64_t write_word(uint64_t address) override;
+    uint64_t evict_block(uint64_t address, uint32_t bytes,
+                         bool dirty) override;
+
+private:
+    // Bodies of load and store, for an address already split into index
+    // and tag
+    bool load_decomposed(uint64_t address, uint32_t index, uint64_t tag);
+    bool store_decomposed(uint64_t address, uint32_t index, uint64_t tag);
+
+    // Simulates a batch set by set (see set_bucketing)
+    void simulate_bucketed(const TraceRecord *records, size_t count);
+
+    // Makes room for `tag` in set `index` and returns the way it was put in;
+    // `prefetch` is true for fills requested by the prefetcher
+    uint32_t allocate(uint32_t index, uint64_t tag, bool prefetch = false);
+
+    // Evicts the block in `way` of set `index` and loads a new tag
+    void evict(uint32_t index, uint32_t way, uint64_t new_tag, bool prefetch);
+
+    // Shows a demand access to the prefetcher and fills what it asks for
+    void run_prefetcher(uint64_t address, Prefetcher::Access access);
+
+    // Fills the block containing `address` ahead of a demand access
+    void prefetch_block(uint64_t address);
+
+    //  Used for populating the cache until max size is reached in a set
+    //  Fills the next free way of the set and returns it
+    uint32_t create_slot(uint32_t index, uint64_t tag);
+
+    // Empties a way, moving the set's last filled way into its place
+    void remove_way(uint32_t index, uint32_t way);
+
+    bool valid_policy_state(uint32_t index) override {
+        return Policy::valid_state(policy_state(index), num_slots,
+                                   cache[index].used);
+    }
+
+    Policy policy;
 };
 
+/**
+ * Creates a cache with the replacement policy named in its configuration.
+ *
+ * @param config Geometry and policies of the cache.
+ * @param next_use Next-use index of the trace (see build_next_use), only
+ * needed, and then required, by the OPT policy.
+ * @return The cache.
+ */
+std::unique_ptr<Cache> make_cache(
+    const CacheConfig &config,
+    const std::vector<uint32_t> *next_use = nullptr);
+
+/**
+ * Creates a victim cache: a small fully associative LRU buffer placed
+ * between a cache and its next level. It is an exclusive level, so it
+ * keeps every block the cache above evicts, is probed on the cache's
+ * misses and hands a block it holds back up (dropping its own copy).
+ *
+ * @param config Number of blocks and hit latency.
+ * @param block_size Block size of the cache above.
+ * @return The victim cache.
+ */
+std::unique_ptr<Cache> make_victim_cache(const VictimConfig &config,
+                                         uint32_t block_size);
+
 #endif  // CACHE_H
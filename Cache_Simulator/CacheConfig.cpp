@@ -0,0 +1,221 @@
+#include "CacheConfig.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "ErrorCodes.h"
+
+// Splits a string on a separator character, keeping empty fields
+std::vector<std::string> split(const std::string& s, char separator) {
+    std::vector<std::string> parts;
+    std::string part;
+    std::istringstream stream(s);
+    while (std::getline(stream, part, separator)) {
+        parts.push_back(part);
+    }
+    if (!s.empty() && s.back() == separator) {
+        parts.push_back("");
+    }
+    return parts;
+}
+
+// Helper function to convert a string to lowercase
+std::string to_lower(const std::string& s) {
+    std::string result = s;
+    std::transform(result.begin(), result.end(), result.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    return result;
+}
+
+// Helper function to check if a number is a power of 2
+bool is_power_of_2(uint32_t n) { return (n & (n - 1)) == 0; }
+
+namespace {
+
+// Every replacement policy, indexed by its Eviction value
+const char* const EVICTION_NAMES[] = {"lru",   "fifo", "plru",   "srrip",
+                                      "brrip", "lfu",  "random", "opt"};
+
+}  // namespace
+
+/**
+ * @param eviction A replacement policy.
+ * @return Its command-line name.
+ */
+const char* eviction_name(Eviction eviction) {
+    return EVICTION_NAMES[static_cast<int>(eviction)];
+}
+
+/**
+ * Parses and validates the six cache parameters in command-line order.
+ *
+ * @param fields The six parameters.
+ * @param config Filled with the parsed configuration on success.
+ * @return 0 on success, otherwise the csim exit code for the problem.
+ */
+int parse_cache_config(const std::vector<std::string>& fields,
+                       CacheConfig& config) {
+    if (fields.size() != 6) {
+        std::cerr << "Error: A cache needs exactly 6 parameters." << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+
+    int set_num, block_num, block_size;
+    std::string miss_type, hit_type, eviction;
+
+    try {
+        // Parse integer arguments
+        set_num = std::stoi(fields[0]);
+        block_num = std::stoi(fields[1]);
+        block_size = std::stoi(fields[2]);
+
+        // Normalize string arguments to lowercase
+        miss_type = to_lower(fields[3]);
+        hit_type = to_lower(fields[4]);
+        eviction = to_lower(fields[5]);
+    } catch (const std::exception& e) {
+        std::cerr
+            << "Error: First three arguments must be integers (powers of 2)."
+            << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+
+    // Validate that integers are positive
+    if (set_num <= 0 || block_num <= 0 || block_size <= 0) {
+        std::cerr << "Error: All numeric arguments must be positive integers."
+                  << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+
+    // Convert to unsigned for power-of-2 check
+    uint32_t u_set_num = static_cast<uint32_t>(set_num);
+    uint32_t u_block_num = static_cast<uint32_t>(block_num);
+    uint32_t u_block_size = static_cast<uint32_t>(block_size);
+
+    // Check if number of sets is a power of 2
+    if (!is_power_of_2(u_set_num)) {
+        std::cerr << "Error: Number of sets (" << set_num
+                  << ") must be a power of 2." << std::endl;
+        return INVALID_SET_NUM;
+    }
+
+    // Check if block size is at least 4 and a power of 2
+    if (block_size < 4 || !is_power_of_2(u_block_size)) {
+        std::cerr << "Error: Block size (" << block_size
+                  << ") must be at least 4 and a power of 2." << std::endl;
+        return INVALID_BLOCK_SIZE;
+    }
+
+    // Validate hit type
+    if (hit_type != "write-through" && hit_type != "write-back") {
+        std::cerr << "Error: Hit type must be 'write-through' or 'write-back'."
+                  << std::endl;
+        return INVALID_HIT_TYPE;
+    }
+
+    // Validate miss type
+    if (miss_type != "write-allocate" && miss_type != "no-write-allocate") {
+        std::cerr << "Error: Miss type must be 'write-allocate' or "
+                     "'no-write-allocate'."
+                  << std::endl;
+        return INVALID_MISS_TYPE;
+    }
+
+    if (hit_type == "write-back" && miss_type == "no-write-allocate") {
+        std::cerr
+            << "Error: Can't have write-back and no-write-allocate together."
+            << std::endl;
+        return INVALID_MISS_TYPE;
+    }
+
+    // Validate eviction policy
+    const size_t policies = sizeof(EVICTION_NAMES) / sizeof(EVICTION_NAMES[0]);
+    size_t policy = 0;
+    while (policy < policies && eviction != EVICTION_NAMES[policy]) {
+        ++policy;
+    }
+    if (policy == policies) {
+        std::cerr << "Error: Eviction policy must be one of 'lru', 'fifo', "
+                     "'plru', 'srrip', 'brrip', 'lfu', 'random' or 'opt'."
+                  << std::endl;
+        return INVALID_EVICTION;
+    }
+
+    // Tree PLRU and random replacement index the ways with whole bits
+    Eviction parsed = static_cast<Eviction>(policy);
+    if ((parsed == Eviction::PLRU || parsed == Eviction::RANDOM) &&
+        !is_power_of_2(u_block_num)) {
+        std::cerr << "Error: Number of blocks (" << block_num
+                  << ") must be a power of 2 for " << eviction << "."
+                  << std::endl;
+        return INVALID_BLOCK_NUM;
+    }
+
+    // Translate string options to boolean flags
+    config.sets = u_set_num;
+    config.blocks = u_block_num;
+    config.bytes = u_block_size;
+    config.miss_write_type = (miss_type == "write-allocate") ? true : false;
+    config.hit_write_type = (hit_type == "write-back") ? true : false;
+    config.eviction = parsed;
+
+    return 0;
+}
+
+/**
+ * Parses a victim cache specification, `<blocks>[:<latency>]`.
+ *
+ * @param spec The specification.
+ * @param config Filled with the parsed configuration on success.
+ * @return 0 on success, otherwise the csim exit code for the problem.
+ */
+int parse_victim_config(const std::string& spec, VictimConfig& config) {
+    std::vector<std::string> fields = split(spec, ':');
+    if (fields.empty() || fields.size() > 2) {
+        std::cerr << "Error: Victim cache must be '<blocks>[:<latency>]'."
+                  << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+
+    int values[2] = {0, 1};
+    for (size_t i = 0; i < fields.size(); ++i) {
+        try {
+            values[i] = std::stoi(fields[i]);
+        } catch (const std::exception& e) {
+            values[i] = 0;
+        }
+        if (values[i] <= 0) {
+            std::cerr << "Error: Victim cache blocks and latency must be "
+                         "positive integers."
+                      << std::endl;
+            return INVALID_COMMAND_LINE;
+        }
+    }
+
+    config.blocks = static_cast<uint32_t>(values[0]);
+    config.latency = static_cast<uint32_t>(values[1]);
+    return 0;
+}
+
+/**
+ * Formats a configuration as its six command-line parameters.
+ *
+ * @param config The configuration to describe.
+ * @param separator Text placed between the parameters.
+ * @return The formatted parameters.
+ */
+std::string describe_config(const CacheConfig& config,
+                            const std::string& separator) {
+    return std::to_string(config.sets) + separator +
+           std::to_string(config.blocks) + separator +
+           std::to_string(config.bytes) + separator +
+           (config.miss_write_type ? "write-allocate" : "no-write-allocate") +
+           separator + (config.hit_write_type ? "write-back" : "write-through") +
+           separator + eviction_name(config.eviction);
+}
@@ -0,0 +1,89 @@
+#ifndef CACHE_CONFIG_H
+#define CACHE_CONFIG_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Replacement policies a cache can use (see ReplacementPolicy.h).
+ */
+enum class Eviction {
+    LRU,     // Least recently used
+    FIFO,    // First in, first out
+    PLRU,    // Tree pseudo-LRU
+    SRRIP,   // Static re-reference interval prediction
+    BRRIP,   // Bimodal re-reference interval prediction
+    LFU,     // Least frequently used
+    RANDOM,  // Uniformly random victim
+    OPT      // Belady's optimal policy; needs the whole trace up front
+};
+
+/**
+ * Geometry and policies of one simulated cache.
+ */
+struct CacheConfig {
+    uint32_t sets;         // Number of sets in the cache
+    uint32_t blocks;       // Number of blocks (slots) per set
+    uint32_t bytes;        // Number of bytes per block
+    bool miss_write_type;  // True: Write-Allocate, False: No-Write-Allocate
+    bool hit_write_type;   // True: Write-Back, False: Write-Through
+    Eviction eviction;     // Replacement policy
+};
+
+/**
+ * Size and speed of a victim cache (see make_victim_cache).
+ */
+struct VictimConfig {
+    uint32_t blocks;   // Number of blocks it holds
+    uint32_t latency;  // Cycles taken by a probe
+};
+
+/**
+ * Parses and validates the six cache parameters in command-line order:
+ * <num_sets> <num_blocks> <block_size> <miss_type> <hit_type> <eviction>.
+ * Problems are reported on standard error.
+ *
+ * @param fields The six parameters.
+ * @param config Filled with the parsed configuration on success.
+ * @return 0 on success, otherwise the csim exit code for the problem.
+ */
+int parse_cache_config(const std::vector<std::string> &fields,
+                       CacheConfig &config);
+
+/**
+ * Parses a victim cache specification, `<blocks>[:<latency>]` (the latency
+ * defaults to 1 cycle). Problems are reported on standard error.
+ *
+ * @param spec The specification.
+ * @param config Filled with the parsed configuration on success.
+ * @return 0 on success, otherwise the csim exit code for the problem.
+ */
+int parse_victim_config(const std::string &spec, VictimConfig &config);
+
+/**
+ * Formats a configuration as its six command-line parameters.
+ *
+ * @param config The configuration to describe.
+ * @param separator Text placed between the parameters.
+ * @return The formatted parameters.
+ */
+std::string describe_config(const CacheConfig &config,
+                            const std::string &separator);
+
+/**
+ * @param eviction A replacement policy.
+ * @return Its command-line name.
+ */
+const char *eviction_name(Eviction eviction);
+
+// Splits a string on a separator character, keeping empty fields
+std::vector<std::string> split(const std::string &s, char separator);
+
+// Helper function to convert a string to lowercase
+std::string to_lower(const std::string &s);
+
+// Helper function to check if a number is a power of 2
+bool is_power_of_2(uint32_t n);
+
+#endif  // CACHE_CONFIG_H
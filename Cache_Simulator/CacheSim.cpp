@@ -0,0 +1,261 @@
+#include "CacheSim.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Cache.h"
+#include "CacheConfig.h"
+#include "Dram.h"
+#include "ErrorCodes.h"
+#include "Prefetcher.h"
+#include "TraceReader.h"
+
+namespace cachesim {
+
+namespace {
+
+// Accesses converted to trace records at a time
+const size_t ACCESS_BATCH = 4096;
+
+// Policies convert to Eviction values by number
+static_assert(static_cast<int>(Policy::RANDOM) ==
+                  static_cast<int>(Eviction::RANDOM),
+              "Policy and Eviction must list the policies in the same order");
+
+// Subtracts every counter of `base` from `stats`
+void subtract(Stats& stats, const Stats& base) {
+    uint64_t Stats::*const counters[] = {
+        &Stats::loads,
+        &Stats::stores,
+        &Stats::load_hits,
+        &Stats::load_misses,
+        &Stats::store_hits,
+        &Stats::store_misses,
+        &Stats::writebacks,
+        &Stats::cycles,
+        &Stats::prefetches,
+        &Stats::useful_prefetches,
+        &Stats::late_prefetches,
+        &Stats::unused_prefetches,
+        &Stats::pollution_misses,
+        &Stats::merged_misses,
+        &Stats::mshr_full_stalls,
+        &Stats::overlapped_cycles,
+        &Stats::victim_hits,
+        &Stats::victim_misses,
+        &Stats::dram_reads,
+        &Stats::dram_writes,
+        &Stats::row_hits,
+        &Stats::row_misses,
+        &Stats::row_conflicts,
+        &Stats::dram_cycles};
+    for (uint64_t Stats::*counter : counters) {
+        stats.*counter -= base.*counter;
+    }
+}
+
+}  // namespace
+
+/**
+ * The simulator's cache and attachments, and the counters at the last
+ * reset_stats().
+ */
+struct Simulator::State {
+    std::unique_ptr<Cache> cache;
+    std::unique_ptr<Cache> victim;
+    std::unique_ptr<DramModel> dram;
+    std::vector<TraceRecord> batch;
+    Stats base;
+};
+
+/**
+ * Creates a simulator with a cold cache.
+ *
+ * @param config The cache and its attachments.
+ * @param simulator Set to the new simulator on success.
+ * @return 0 on success, otherwise the csim exit code for the problem.
+ */
+int Simulator::create(const Config& config,
+                      std::unique_ptr<Simulator>& simulator) {
+    // Validate the geometry exactly as the command line does
+    CacheConfig cache_config;
+    cache_config.sets = config.sets;
+    cache_config.blocks = config.ways;
+    cache_config.bytes = config.block_bytes;
+    cache_config.miss_write_type = config.write_allocate;
+    cache_config.hit_write_type = config.write_back;
+    cache_config.eviction = static_cast<Eviction>(config.policy);
+    int error = parse_cache_config(
+        split(describe_config(cache_config, ":"), ':'), cache_config);
+    if (error != 0) {
+        return error;
+    }
+    if (config.hit_latency == 0) {
+        std::cerr << "Error: Hit latency must be a positive integer."
+                  << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+
+    PrefetcherConfig prefetch;
+    if (!config.prefetcher.empty()) {
+        error = parse_prefetcher_config(config.prefetcher, prefetch);
+        if (error != 0) {
+            return error;
+        }
+    }
+    DramConfig dram_config;
+    if (!config.dram.empty()) {
+        error = parse_dram_config(config.dram, dram_config);
+        if (error != 0) {
+            return error;
+        }
+    }
+
+    std::unique_ptr<State> state(new State());
+    state->cache = make_cache(cache_config);
+    state->cache->set_hit_latency(config.hit_latency);
+    if (!config.prefetcher.empty()) {
+        state->cache->set_prefetcher(
+            make_prefetcher(prefetch, config.block_bytes));
+    }
+    state->cache->set_mshrs(config.mshrs);
+    if (config.victim_blocks != 0) {
+        VictimConfig victim = {config.victim_blocks,
+                               std::max(config.victim_latency, 1u)};
+        state->victim = make_victim_cache(victim, config.block_bytes);
+        state->cache->set_next_level(state->victim.get());
+    }
+    if (!config.dram.empty()) {
+        state->dram = std::make_unique<DramModel>(dram_config);
+    }
+    (state->victim ? state->victim : state->cache)
+        ->set_next_level(state->dram.get());
+    state->batch.reserve(ACCESS_BATCH);
+
+    simulator.reset(new Simulator(std::move(state)));
+    return 0;
+}
+
+// constructor
+Simulator::Simulator(std::unique_ptr<State> state) : state(std::move(state)) {}
+
+// destructor
+Simulator::~Simulator() = default;
+
+/**
+ * Simulates a batch of accesses in order.
+ *
+ * @param accesses The accesses.
+ */
+void Simulator::access(Span<const Access> accesses) {
+    std::vector<TraceRecord>& batch = state->batch;
+    const Access* next = accesses.begin();
+    while (next != accesses.end()) {
+        size_t count = std::min(ACCESS_BATCH,
+                                static_cast<size_t>(accesses.end() - next));
+        batch.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            batch[i].address = next[i].address;
+            batch[i].op = static_cast<char>(next[i].op);
+        }
+        state->cache->simulate(batch.data(), count);
+        next += count;
+    }
+}
+
+/**
+ * Simulates a single access.
+ *
+ * @param access The access.
+ * @return True if it hit in the cache.
+ */
+bool Simulator::access(const Access& access) {
+    return access.op == Op::STORE ? state->cache->store(access.address)
+                                  : state->cache->load(access.address);
+}
+
+/**
+ * @return Counters since creation or the last reset_stats()
+ */
+Stats Simulator::get_stats() const {
+    Stats stats;
+    CacheStats cache = state->cache->get_stats();
+    stats.loads = cache.loads;
+    stats.stores = cache.stores;
+    stats.load_hits = cache.load_hits;
+    stats.load_misses = cache.load_misses;
+    stats.store_hits = cache.store_hits;
+    stats.store_misses = cache.store_misses;
+    stats.writebacks = cache.writebacks;
+    stats.cycles = cache.cycles;
+
+    PrefetchStats prefetch = state->cache->get_prefetch_stats();
+    stats.prefetches = prefetch.issued;
+    stats.useful_prefetches = prefetch.useful;
+    stats.late_prefetches = prefetch.late;
+    stats.unused_prefetches = prefetch.unused;
+    stats.pollution_misses = prefetch.pollution;
+
+    MshrStats mshr = state->cache->get_mshr_stats();
+    stats.merged_misses = mshr.merged;
+    stats.mshr_full_stalls = mshr.full_stalls;
+    stats.overlapped_cycles = mshr.overlapped;
+
+    if (state->victim) {
+        // The victim cache's loads are the probes of the cache's misses
+        stats.victim_hits = state->victim->get_load_hits();
+        stats.victim_misses = state->victim->get_load_misses();
+    }
+    if (state->dram) {
+        const DramStats& dram = state->dram->get_stats();
+        stats.dram_reads = dram.reads;
+        stats.dram_writes = dram.writes;
+        stats.row_hits = dram.row_hits;
+        stats.row_misses = dram.row_misses;
+        stats.row_conflicts = dram.row_conflicts;
+        stats.dram_cycles = dram.cycles;
+    }
+
+    subtract(stats, state->base);
+    return stats;
+}
+
+/**
+ * Starts the counters over from zero. The cache's own counters keep
+ * running underneath, so fills in flight stay timed correctly.
+ */
+void Simulator::reset_stats() {
+    state->base = Stats();
+    state->base = get_stats();
+}
+
+/**
+ * Saves the cache's contents and counters.
+ *
+ * @param path Path of the checkpoint.
+ * @return 0 on success, otherwise the csim exit code for the problem.
+ */
+int Simulator::save_checkpoint(const std::string& path) {
+    return state->cache->save_checkpoint(path);
+}
+
+/**
+ * Restores a checkpoint into a simulator that has not simulated anything
+ * yet. The cache's counters then continue from the checkpoint's.
+ *
+ * @param path Path of the checkpoint.
+ * @return 0 on success, otherwise the csim exit code for the problem.
+ */
+int Simulator::restore_checkpoint(const std::string& path) {
+    int error = state->cache->restore_checkpoint(path);
+    if (error == 0) {
+        state->base = Stats();
+    }
+    return error;
+}
+
+}  // namespace cachesim
@@ -0,0 +1,231 @@
+#ifndef CACHE_SIM_H
+#define CACHE_SIM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+/**
+ * Embeddable interface of the simulator, built into libcachesim.a and
+ * libcachesim.so (`make lib`). It lets a program simulate a cache on
+ * addresses it already has in memory, without writing a trace and parsing
+ * csim's text output.
+ *
+ * This header is the whole public interface: it does not expose Cache.h or
+ * any other part of the simulator.
+ */
+namespace cachesim {
+
+/**
+ * Replacement policies (see ReplacementPolicy.h). Belady's OPT is not
+ * offered: it needs the whole trace before the first access.
+ */
+enum class Policy { LRU, FIFO, PLRU, SRRIP, BRRIP, LFU, RANDOM };
+
+/**
+ * Kinds of memory access. Fetches are simulated as loads.
+ */
+enum class Op : char { LOAD = 'l', STORE = 's', FETCH = 'i' };
+
+/**
+ * One memory access.
+ */
+struct Access {
+    uint64_t address;
+    Op op;
+};
+
+/**
+ * A cache and what is attached to it. The geometry follows the same rules
+ * as csim's command line: power-of-2 sets and block size (at least 4
+ * bytes), and no write-back without write-allocate.
+ */
+struct Config {
+    uint32_t sets = 256;
+    uint32_t ways = 4;          // Blocks per set
+    uint32_t block_bytes = 64;
+    bool write_allocate = true;
+    bool write_back = true;
+    Policy policy = Policy::LRU;
+    uint32_t hit_latency = 1;   // Cycles taken by a hit
+
+    uint32_t mshrs = 0;          // 0: blocking cache (as csim -m)
+    uint32_t victim_blocks = 0;  // 0: no victim cache (as csim -v)
+    uint32_t victim_latency = 1;
+    std::string prefetcher;      // Empty: none, else as csim -f
+    std::string dram;            // Empty: flat memory cost, else as csim -d
+};
+
+/**
+ * Counters of a simulator. Those of an attachment that is not configured
+ * stay zero.
+ */
+struct Stats {
+    uint64_t loads = 0;  // Fetches included
+    uint64_t stores = 0;
+    uint64_t load_hits = 0;
+    uint64_t load_misses = 0;
+    uint64_t store_hits = 0;
+    uint64_t store_misses = 0;
+    uint64_t writebacks = 0;
+    uint64_t cycles = 0;
+
+    uint64_t prefetches = 0;  // Prefetcher
+    uint64_t useful_prefetches = 0;
+    uint64_t late_prefetches = 0;
+    uint64_t unused_prefetches = 0;
+    uint64_t pollution_misses = 0;
+
+    uint64_t merged_misses = 0;  // MSHRs
+    uint64_t mshr_full_stalls = 0;
+    uint64_t overlapped_cycles = 0;
+
+    uint64_t victim_hits = 0;  // Victim cache
+    uint64_t victim_misses = 0;
+
+    uint64_t dram_reads = 0;  // DRAM
+    uint64_t dram_writes = 0;
+    uint64_t row_hits = 0;
+    uint64_t row_misses = 0;
+    uint64_t row_conflicts = 0;
+    uint64_t dram_cycles = 0;
+
+    /**
+     * @return Share of accesses that hit (0 if none)
+     */
+    double hit_rate() const {
+        uint64_t accesses = loads + stores;
+        return accesses ? static_cast<double>(load_hits + store_hits) / accesses
+                        : 0;
+    }
+
+    /**
+     * @return Share of DRAM row accesses that found their row open (0 if
+     * none)
+     */
+    double row_hit_rate() const {
+        uint64_t rows = row_hits + row_misses + row_conflicts;
+        return rows ? static_cast<double>(row_hits) / rows : 0;
+    }
+
+    /**
+     * @return Average latency of a DRAM request in cycles (0 if none)
+     */
+    double average_memory_latency() const {
+        uint64_t requests = dram_reads + dram_writes;
+        return requests ? static_cast<double>(dram_cycles) / requests : 0;
+    }
+};
+
+/**
+ * A view of contiguous elements, standing in for C++20's std::span. It
+ * converts implicitly from containers with data() and size() (such as
+ * std::vector and std::array) and from arrays.
+ */
+template <typename T>
+class Span {
+public:
+    Span(T *data, size_t size) : first(data), count(size) {}
+
+    template <size_t N>
+    Span(T (&array)[N]) : first(array), count(N) {}
+
+    template <typename Container,
+              typename = decltype(static_cast<T *>(
+                  std::declval<Container &>().data()))>
+    Span(Container &container)
+        : first(container.data()), count(container.size()) {}
+
+    T *data() const { return first; }
+    size_t size() const { return count; }
+    T *begin() const { return first; }
+    T *end() const { return first + count; }
+
+private:
+    T *first;
+    size_t count;
+};
+
+/**
+ * A simulated cache, with its optional prefetcher, MSHRs, victim cache and
+ * DRAM model.
+ */
+class Simulator {
+public:
+    /**
+     * Creates a simulator with a cold cache. Problems with the configuration
+     * are reported on standard error, as by csim.
+     *
+     * @param config The cache and its attachments.
+     * @param simulator Set to the new simulator on success.
+     * @return 0 on success, otherwise the csim exit code for the problem
+     * (see ErrorCodes.h).
+     */
+    static int create(const Config &config,
+                      std::unique_ptr<Simulator> &simulator);
+
+    // destructor
+    ~Simulator();
+
+    Simulator(const Simulator &) = delete;
+    Simulator &operator=(const Simulator &) = delete;
+
+    /**
+     * Simulates a batch of accesses in order. Batches go through the
+     * cache's inlined access path, so this is much cheaper per access than
+     * access(const Access &).
+     *
+     * @param accesses The accesses.
+     */
+    void access(Span<const Access> accesses);
+
+    /**
+     * Simulates a single access.
+     *
+     * @param access The access.
+     * @return True if it hit in the cache.
+     */
+    bool access(const Access &access);
+
+    /**
+     * @return Counters since creation or the last reset_stats()
+     */
+    Stats get_stats() const;
+
+    /**
+     * Starts every counter over from zero, keeping the cache's contents
+     * (e.g. after a warm-up phase).
+     */
+    void reset_stats();
+
+    /**
+     * Saves the cache's contents and counters (see csim --save).
+     *
+     * @param path Path of the checkpoint.
+     * @return 0 on success, otherwise the csim exit code for the problem.
+     */
+    int save_checkpoint(const std::string &path);
+
+    /**
+     * Restores a checkpoint of a cache with the same geometry and policies
+     * (see csim --restore), before the first access. The counters then
+     * continue from the checkpoint's.
+     *
+     * @param path Path of the checkpoint.
+     * @return 0 on success, otherwise the csim exit code for the problem.
+     */
+    int restore_checkpoint(const std::string &path);
+
+private:
+    struct State;
+
+    explicit Simulator(std::unique_ptr<State> state);
+
+    std::unique_ptr<State> state;
+};
+
+}  // namespace cachesim
+
+#endif  // CACHE_SIM_H
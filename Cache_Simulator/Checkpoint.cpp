@@ -0,0 +1,218 @@
+#include "Checkpoint.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Cache.h"
+#include "ErrorCodes.h"
+
+/**
+ * Writes the blocks, replacement state and counters of this cache to a
+ * checkpoint file.
+ *
+ * @param path Path of the checkpoint.
+ * @return 0 on success, otherwise the csim exit code for the problem.
+ */
+int Cache::save_checkpoint(const std::string& path) {
+    if (eviction == Eviction::OPT) {
+        // Its state is made of positions in one particular trace
+        std::cerr << "Error: opt caches cannot be checkpointed." << std::endl;
+        return INVALID_EVICTION;
+    }
+
+    checkpoint_format::Header header = {};
+    header.version = checkpoint_format::VERSION;
+    header.sets = num_sets;
+    header.blocks = num_slots;
+    header.bytes = num_bytes;
+    header.write_allocate = miss_write_type;
+    header.write_back = hit_write_type;
+    header.eviction = static_cast<uint32_t>(eviction);
+    header.wide = wide;
+    header.set_stride = set_stride;
+    header.loads = total_loads;
+    header.stores = total_stores;
+    header.load_hits = load_hits;
+    header.load_misses = load_misses;
+    header.store_hits = store_hits;
+    header.store_misses = store_misses;
+    header.cycles = get_cycles();
+    header.writebacks = writebacks;
+
+    std::vector<uint32_t> used(num_sets);
+    for (uint32_t index = 0; index < num_sets; ++index) {
+        used[index] = cache[index].used;
+    }
+
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(checkpoint_format::MAGIC),
+              sizeof(checkpoint_format::MAGIC));
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(used.data()),
+              used.size() * sizeof(uint32_t));
+    out.write(reinterpret_cast<const char*>(ways.data()),
+              ways.size() * sizeof(uint32_t));
+    out.close();
+    if (!out) {
+        std::cerr << "Error: Unable to write checkpoint '" << path << "'."
+                  << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+    return 0;
+}
+
+/**
+ * Replaces the state of this cache with that of a checkpoint. The file is
+ * mapped rather than read, so the sets are copied straight out of the page
+ * cache.
+ *
+ * @param path Path of the checkpoint.
+ * @return 0 on success, otherwise the csim exit code for the problem.
+ */
+int Cache::restore_checkpoint(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        std::cerr << "Error: Unable to open checkpoint '" << path << "'."
+                  << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+
+    size_t size = static_cast<size_t>(info.st_size);
+    void* map = size < checkpoint_format::HEADER_SIZE
+                    ? MAP_FAILED
+                    : mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    const unsigned char* data = static_cast<const unsigned char*>(map);
+    if (map == MAP_FAILED ||
+        memcmp(data, checkpoint_format::MAGIC,
+               sizeof(checkpoint_format::MAGIC)) != 0) {
+        if (map != MAP_FAILED) {
+            munmap(map, size);
+        }
+        std::cerr << "Error: '" << path << "' is not a checkpoint."
+                  << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+
+    checkpoint_format::Header header;
+    memcpy(&header, data + sizeof(checkpoint_format::MAGIC), sizeof(header));
+    const char* problem = nullptr;
+    if (header.version != checkpoint_format::VERSION) {
+        problem = "has an unknown version";
+    } else if (header.sets != num_sets || header.blocks != num_slots ||
+               header.bytes != num_bytes ||
+               header.write_allocate != miss_write_type ||
+               header.write_back != hit_write_type ||
+               header.eviction != static_cast<uint32_t>(eviction)) {
+        problem = "was taken of a different cache";
+    } else {
+        // Take on the tag width of the checkpoint
+        if (header.wide && !wide) {
+            widen();
+        }
+        size_t words = static_cast<size_t>(num_sets) * (1 + set_stride);
+        if (header.set_stride != set_stride ||
+            size != checkpoint_format::HEADER_SIZE + words * sizeof(uint32_t)) {
+            problem = "is damaged";
+        }
+    }
+    if (problem) {
+        munmap(map, size);
+        std::cerr << "Error: Checkpoint '" << path << "' " << problem << "."
+                  << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+
+    // The sets go into fresh storage, so a damaged checkpoint leaves the
+    // cache as it was
+    std::vector<Set> restored_sets(num_sets);
+    std::vector<uint32_t> restored_ways(ways.size());
+    const unsigned char* sets = data + checkpoint_format::HEADER_SIZE;
+    for (uint32_t index = 0; index < num_sets; ++index) {
+        memcpy(&restored_sets[index].used, sets + index * sizeof(uint32_t),
+               sizeof(uint32_t));
+    }
+    memcpy(restored_ways.data(), sets + num_sets * sizeof(uint32_t),
+           restored_ways.size() * sizeof(uint32_t));
+    munmap(map, size);
+
+    cache.swap(restored_sets);
+    ways.swap(restored_ways);
+    if (!restored_sets_valid()) {
+        cache.swap(restored_sets);
+        ways.swap(restored_ways);
+        std::cerr << "Error: Checkpoint '" << path << "' is damaged."
+                  << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+
+    // Nothing restored is a pending prefetch: the bookkeeping of those is
+    // not saved, so they become ordinary blocks
+    for (uint32_t index = 0; index < num_sets; ++index) {
+        uint32_t* flags = way_array(index, FLAGS);
+        for (uint32_t way = 0; way < cache[index].used; ++way) {
+            flags[way] &= ~SLOT_PREFETCHED;
+        }
+    }
+    prefetch_ready.clear();
+    prefetch_victims.clear();
+    fills.clear();
+
+    total_loads = header.loads;
+    total_stores = header.stores;
+    load_hits = header.load_hits;
+    load_misses = header.load_misses;
+    store_hits = header.store_hits;
+    store_misses = header.store_misses;
+    total_cycles = header.cycles;
+    fills_done = 0;
+    writebacks = header.writebacks;
+    return 0;
+}
+
+/**
+ * Checks the sets of a checkpoint just swapped into this cache: no set may
+ * hold more blocks than it has ways or the same tag twice, and the
+ * replacement state must be one the policy can work on. The tag indexes
+ * are not trusted at all but rebuilt from the tags.
+ *
+ * @return True if every set is usable.
+ */
+bool Cache::restored_sets_valid() {
+    for (uint32_t index = 0; index < num_sets; ++index) {
+        const uint32_t used = cache[index].used;
+        if (used > num_slots || !valid_policy_state(index)) {
+            return false;
+        }
+
+        // Add the ways back one at a time, so a linear lookup only sees
+        // the ways added before
+        if (index_capacity != 0) {
+            std::fill(tag_index(index), tag_index(index) + index_capacity, 0);
+        }
+        cache[index].used = 0;
+        for (uint32_t way = 0; way < used; ++way) {
+            uint64_t tag = way_tag(index, way);
+            if (find_way(index, tag) != num_slots) {
+                return false;
+            }
+            index_insert(index, tag, way);
+            cache[index].used = way + 1;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,58 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Binary cache checkpoint format (see Cache::save_checkpoint).
+ *
+ * A checkpoint is the cache's own storage written out as is, so restoring
+ * it is a single copy out of the mapped file:
+ *
+ *   bytes 0-7    magic "\x89CSIMCK\n"
+ *   bytes 8-..   Header (below), in the host's byte order
+ *   then         the `used` count of every set, one 32-bit word each
+ *   then         the per-way words of every set, `set_stride` each (see
+ *                Cache::Set for their layout)
+ *
+ * The version is read in host order too, so a checkpoint written on a host
+ * of the other byte order is rejected as an unknown version.
+ */
+namespace checkpoint_format {
+
+// Magic number identifying a checkpoint
+const unsigned char MAGIC[8] = {0x89, 'C', 'S', 'I', 'M', 'C', 'K', '\n'};
+
+const uint32_t VERSION = 1;
+
+/**
+ * Everything but the sets: what the checkpoint was taken of, and the
+ * counters at that point.
+ */
+struct Header {
+    uint32_t version;
+    uint32_t sets;            // Geometry and policies of the cache
+    uint32_t blocks;
+    uint32_t bytes;
+    uint32_t write_allocate;  // 1 or 0
+    uint32_t write_back;      // 1 or 0
+    uint32_t eviction;        // An Eviction value
+    uint32_t wide;            // 1 if the sets hold 64-bit tags
+    uint32_t set_stride;      // Words per set
+    uint32_t reserved;        // Zero
+    uint64_t loads;
+    uint64_t stores;
+    uint64_t load_hits;
+    uint64_t load_misses;
+    uint64_t store_hits;
+    uint64_t store_misses;
+    uint64_t cycles;
+    uint64_t writebacks;
+};
+
+const size_t HEADER_SIZE = sizeof(MAGIC) + sizeof(Header);
+
+}  // namespace checkpoint_format
+
+#endif  // CHECKPOINT_H
@@ -0,0 +1,26 @@
+#include "ChunkPipeline.h"
+
+#include <vector>
+
+#include "TraceReader.h"
+
+/**
+ * Reads up to CHUNK_RECORDS records of the trace into a chunk.
+ *
+ * @param reader The trace.
+ * @param chunk Replaced with the records read.
+ * @return RECORD if the chunk was filled and more records may follow, END at
+ * the end of the trace, otherwise the read error.
+ */
+TraceReader::Status read_chunk(TraceReader& reader,
+                               std::vector<TraceRecord>& chunk) {
+    chunk.clear();
+
+    TraceRecord record;
+    TraceReader::Status status = TraceReader::RECORD;
+    while (chunk.size() < CHUNK_RECORDS &&
+           (status = reader.next(record)) == TraceReader::RECORD) {
+        chunk.push_back(record);
+    }
+    return status;
+}
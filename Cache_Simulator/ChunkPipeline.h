@@ -0,0 +1,136 @@
+#ifndef CHUNK_PIPELINE_H
+#define CHUNK_PIPELINE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "TraceReader.h"
+
+// Number of trace records decoded into each chunk. Consumers run over a
+// whole chunk at a time so their state stays cache-resident
+const size_t CHUNK_RECORDS = 1 << 16;
+
+// Number of chunks buffered between the trace reader and the workers
+const size_t RING_CHUNKS = 4;
+
+/**
+ * Reads up to CHUNK_RECORDS records of the trace into a chunk.
+ *
+ * @param reader The trace.
+ * @param chunk Replaced with the records read.
+ * @return RECORD if the chunk was filled and more records may follow, END at
+ * the end of the trace, otherwise the read error.
+ */
+TraceReader::Status read_chunk(TraceReader &reader,
+                               std::vector<TraceRecord> &chunk);
+
+// Spins (then yields) until `ready` returns true
+template <typename Predicate>
+void wait_for(Predicate ready) {
+    for (unsigned spins = 0; !ready(); ++spins) {
+        if (spins >= 64) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+/**
+ * One decoded chunk of the trace shared read-only by all workers.
+ * The reader publishes chunk n by storing n in `sequence`; every worker
+ * decrements `readers` once it is done with the chunk, and the slot is
+ * refilled only after `readers` drops back to 0.
+ */
+struct ChunkSlot {
+    std::vector<TraceRecord> records;
+    bool last = false;  // No chunks follow this one
+    std::atomic<uint64_t> sequence{UINT64_MAX};
+    std::atomic<unsigned> readers{0};
+};
+
+/**
+ * Decodes a trace once and hands every chunk of it, in order, to each of
+ * `workers` threads. The calling thread decodes into a ring of shared
+ * chunks; workers and the reader only synchronize once per chunk, through
+ * atomics, so nothing is locked while a worker processes its chunk.
+ * With a single worker everything runs on the calling thread.
+ *
+ * @param reader The trace.
+ * @param workers Number of worker threads (at least 1).
+ * @param setup Called as setup(w) on worker w's thread before its first
+ * chunk.
+ * @param process Called as process(w, chunk) on worker w's thread for
+ * every chunk of the trace.
+ * @param run Incremented by the number of records read.
+ * @return END once the trace is exhausted, otherwise the read error.
+ */
+template <typename Setup, typename Process>
+TraceReader::Status run_chunk_pipeline(TraceReader &reader, unsigned workers,
+                                       Setup setup, Process process,
+                                       uint64_t &run) {
+    TraceReader::Status status;
+
+    if (workers <= 1) {
+        std::vector<TraceRecord> chunk;
+        chunk.reserve(CHUNK_RECORDS);
+
+        setup(0u);
+        do {
+            status = read_chunk(reader, chunk);
+            process(0u, static_cast<const std::vector<TraceRecord> &>(chunk));
+            run += chunk.size();
+        } while (status == TraceReader::RECORD);
+        return status;
+    }
+
+    std::vector<ChunkSlot> ring(RING_CHUNKS);
+    std::vector<std::thread> threads;
+
+    for (unsigned w = 0; w < workers; ++w) {
+        threads.emplace_back([&, w] {
+            setup(w);
+
+            for (uint64_t n = 0;; ++n) {
+                ChunkSlot &slot = ring[n % RING_CHUNKS];
+                wait_for([&] {
+                    return slot.sequence.load(std::memory_order_acquire) == n;
+                });
+
+                process(w, static_cast<const std::vector<TraceRecord> &>(
+                               slot.records));
+
+                bool last = slot.last;
+                slot.readers.fetch_sub(1, std::memory_order_release);
+                if (last) {
+                    break;
+                }
+            }
+        });
+    }
+
+    for (uint64_t n = 0;; ++n) {
+        ChunkSlot &slot = ring[n % RING_CHUNKS];
+        wait_for([&] {
+            return slot.readers.load(std::memory_order_acquire) == 0;
+        });
+
+        status = read_chunk(reader, slot.records);
+        slot.last = (status != TraceReader::RECORD);
+        run += slot.records.size();
+
+        slot.readers.store(workers, std::memory_order_relaxed);
+        slot.sequence.store(n, std::memory_order_release);
+        if (slot.last) {
+            break;
+        }
+    }
+
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    return status;
+}
+
+#endif  // CHUNK_PIPELINE_H
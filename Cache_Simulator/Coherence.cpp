@@ -0,0 +1,459 @@
+#include "Coherence.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Cache.h"
+#include "CacheConfig.h"
+#include "ErrorCodes.h"
+#include "Hierarchy.h"
+#include "TraceReader.h"
+
+namespace {
+
+// Bit of a core in a directory mask
+inline uint64_t core_bit(uint32_t core) { return uint64_t{1} << core; }
+
+// Lowest core in a non-empty directory mask
+inline uint32_t first_core(uint64_t cores) {
+    return static_cast<uint32_t>(__builtin_ctzll(cores));
+}
+
+}  // namespace
+
+/**
+ * @param core_level Configuration of every private cache.
+ * @param shared_level Configuration of the shared last-level cache.
+ * @param protocol The coherence protocol.
+ * @param bus_latency Cycles taken by a coherence transaction.
+ */
+CoherentSystem::CoherentSystem(const LevelConfig &core_level,
+                               const LevelConfig &shared_level,
+                               Protocol protocol, uint32_t bus_latency)
+    : core_level(core_level),
+      protocol(protocol),
+      bus_latency(bus_latency),
+      block_mask(~uint64_t{core_level.cache.bytes - 1}),
+      shared(make_cache(shared_level.cache)) {
+    shared->set_hit_latency(shared_level.latency);
+}
+
+/**
+ * Creates cores up to and including the given one.
+ *
+ * @param core Highest core number needed.
+ */
+void CoherentSystem::add_cores(uint32_t core) {
+    while (cores.size() <= core) {
+        auto added = std::make_unique<Core>();
+        added->cache = make_cache(core_level.cache);
+        added->cache->set_hit_latency(core_level.latency);
+        added->port = std::make_unique<CorePort>(
+            *this, static_cast<uint32_t>(cores.size()));
+        added->cache->set_next_level(added->port.get());
+        cores.push_back(std::move(added));
+    }
+}
+
+/**
+ * Simulates one access: the directory first brings the block into the
+ * state the access needs, then the core's private cache performs it.
+ *
+ * @param record The access; its core must be below MAX_CORES.
+ */
+void CoherentSystem::access(const TraceRecord &record) {
+    const uint32_t id = record.core;
+    if (id >= cores.size()) {
+        add_cores(id);
+    }
+    Core &core = *cores[id];
+
+    const uint64_t block = record.address & block_mask;
+    const uint32_t word = static_cast<uint32_t>(
+        ((record.address & ~block_mask) >> 2) % 64);
+    const bool store = (record.op == 's');
+
+    Line &line = directory[block];
+    const bool holding = (line.holders & core_bit(id)) != 0;
+
+    if (!holding) {
+        note_coherence_miss(id, block, word, line);
+        if (store) {
+            // Read for ownership
+            core.stats.bus_cycles += invalidate_others(id, block, word, line);
+        } else {
+            core.stats.bus_cycles += read_miss(id, block, line);
+        }
+    } else if (store && (line.owner != static_cast<int>(id) ||
+                         line.state == OWNED)) {
+        // Writing a Shared or Owned copy: upgrade it to Modified
+        ++core.stats.upgrades;
+        ++block_stats[block].upgrades;
+        core.stats.bus_cycles +=
+            bus_latency + invalidate_others(id, block, word, line);
+    }
+
+    bool hit;
+    if (store) {
+        line.state = MODIFIED;  // Exclusive copies upgrade silently
+
+        // Remember the word for cores that lost the block
+        for (uint64_t lost = line.lost; lost != 0; lost &= lost - 1) {
+            cores[first_core(lost)]->written[block] |= uint64_t{1} << word;
+        }
+        hit = core.cache->store(record.address);
+    } else {
+        hit = core.cache->load(record.address);
+    }
+    peer_supplies = false;
+
+    // The directory mirrors the private caches exactly
+    assert(hit == holding);
+    (void)hit;
+}
+
+/**
+ * Brings a block a core misses on with a read into its cache's reach. If
+ * other cores hold the block, one of them supplies it: an Exclusive owner
+ * drops to Shared, and a Modified one either writes the block back and
+ * drops to Shared (MESI) or keeps it dirty as Owned (MOESI). Otherwise the
+ * shared cache supplies it and the reader becomes its Exclusive owner.
+ *
+ * @param core The reading core.
+ * @param block Address of the block.
+ * @param line The block's directory entry.
+ * @return Bus cycles spent beyond the transfer itself.
+ */
+uint64_t CoherentSystem::read_miss(uint32_t core, uint64_t block,
+                                   Line &line) {
+    uint64_t cycles = 0;
+
+    if (line.holders == 0) {
+        line.owner = static_cast<int>(core);
+        line.state = EXCLUSIVE;
+    } else {
+        peer_supplies = true;
+        ++cores[core]->stats.transfers;
+
+        if (line.owner >= 0 && line.state == MODIFIED &&
+            protocol == Protocol::MESI) {
+            // The owner writes the block back before sharing it
+            cores[line.owner]->cache->clean_block(block);
+            cycles += shared->evict_block(block, core_level.cache.bytes, true);
+            line.owner = -1;
+        } else if (line.owner >= 0 && line.state == MODIFIED) {
+            line.state = OWNED;
+        } else if (line.owner >= 0 && line.state == EXCLUSIVE) {
+            line.owner = -1;
+        }
+    }
+
+    line.holders |= core_bit(core);
+    return cycles;
+}
+
+/**
+ * Invalidates every copy of a block except the writer's and makes the
+ * writer its Modified owner. A writer without a copy gets the block from
+ * one of the invalidated holders; their dirty data moves with it.
+ *
+ * @param core The writing core.
+ * @param block Address of the block.
+ * @param word Word of the block being written.
+ * @param line The block's directory entry.
+ * @return Bus cycles spent beyond the transfer itself.
+ */
+uint64_t CoherentSystem::invalidate_others(uint32_t core, uint64_t block,
+                                           uint32_t word, Line &line) {
+    const uint64_t others = line.holders & ~core_bit(core);
+    if (others != 0 && (line.holders & core_bit(core)) == 0) {
+        peer_supplies = true;
+        ++cores[core]->stats.transfers;
+    }
+
+    for (uint64_t left = others; left != 0; left &= left - 1) {
+        uint32_t other = first_core(left);
+        cores[other]->cache->invalidate_block(block, core_level.cache.bytes);
+        ++cores[other]->stats.invalidations;
+        ++block_stats[block].invalidations;
+
+        // The store about to happen is the first write it misses
+        line.lost |= core_bit(other);
+        cores[other]->written[block] = 0;
+    }
+    (void)word;
+
+    line.holders = core_bit(core);
+    line.owner = static_cast<int>(core);
+    line.state = MODIFIED;
+    return 0;
+}
+
+/**
+ * Counts a miss as a coherence miss if the core lost its copy of the block
+ * to an invalidation, and as false sharing if no other core has written the
+ * word it accesses since.
+ *
+ * @param core The missing core.
+ * @param block Address of the block.
+ * @param word Word of the block accessed.
+ * @param line The block's directory entry.
+ */
+void CoherentSystem::note_coherence_miss(uint32_t core, uint64_t block,
+                                         uint32_t word, Line &line) {
+    if ((line.lost & core_bit(core)) == 0) {
+        return;
+    }
+    line.lost &= ~core_bit(core);
+
+    Core &missing = *cores[core];
+    auto written = missing.written.find(block);
+    uint64_t words = written->second;
+    missing.written.erase(written);
+
+    BlockStats &stats = block_stats[block];
+    ++missing.stats.coherence_misses;
+    ++stats.coherence_misses;
+    if ((words & (uint64_t{1} << word)) == 0) {
+        ++missing.stats.false_sharing;
+        ++stats.false_sharing;
+    }
+}
+
+/**
+ * Removes a core's copy of a block from the directory when its cache
+ * evicts it. An evicted owner's dirty data goes to the shared cache with
+ * the eviction, so the remaining holders stay Shared.
+ *
+ * @param core The evicting core.
+ * @param block Address of the block.
+ */
+void CoherentSystem::drop(uint32_t core, uint64_t block) {
+    auto entry = directory.find(block);
+    if (entry == directory.end()) {
+        return;
+    }
+
+    Line &line = entry->second;
+    line.holders &= ~core_bit(core);
+    if (line.owner == static_cast<int>(core)) {
+        line.owner = -1;
+    }
+    if (line.holders == 0 && line.lost == 0) {
+        directory.erase(entry);
+    }
+}
+
+/**
+ * Reads a block for a miss in the private cache, from the core that
+ * supplies it or from the shared cache.
+ *
+ * @param address Address of the first byte of the block.
+ * @param bytes Block size of the private cache.
+ * @param dirty Set to true if the block is handed up modified.
+ * @return Cycles taken.
+ */
+uint64_t CoherentSystem::CorePort::read_block(uint64_t address, uint32_t bytes,
+                                              bool &dirty) {
+    if (system.peer_supplies) {
+        dirty = false;
+        return system.bus_latency;
+    }
+    return system.shared->read_block(address, bytes, dirty);
+}
+
+/**
+ * Writes a word through to the shared cache.
+ *
+ * @param address Address written.
+ * @return Cycles taken.
+ */
+uint64_t CoherentSystem::CorePort::write_word(uint64_t address) {
+    return system.shared->write_word(address);
+}
+
+/**
+ * Passes a block the private cache evicts to the shared cache and removes
+ * the core's copy from the directory.
+ *
+ * @param address Address of the first byte of the block.
+ * @param bytes Block size of the private cache.
+ * @param dirty True if the block was modified.
+ * @return Cycles taken.
+ */
+uint64_t CoherentSystem::CorePort::evict_block(uint64_t address,
+                                               uint32_t bytes, bool dirty) {
+    system.drop(core, address);
+    return system.shared->evict_block(address, bytes, dirty);
+}
+
+/**
+ * Simulates coherent private caches over a shared cache.
+ *
+ * @param argc Argument count, starting at the subcommand name.
+ * @param argv Arguments, starting at the subcommand name.
+ * @return csim exit code.
+ */
+int run_coherence(int argc, char **argv) {
+    std::string trace_file = "-";
+    Protocol protocol = Protocol::MESI;
+    int bus_latency = 10;
+    int top_blocks = 10;
+    std::vector<LevelConfig> levels;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+
+        if ((arg == "-t" || arg == "-p" || arg == "-b" || arg == "-n") &&
+            i + 1 == argc) {
+            std::cerr << "Error: " << arg << " needs a value." << std::endl;
+            return INVALID_COMMAND_LINE;
+        }
+
+        if (arg == "-t") {
+            trace_file = argv[++i];
+        } else if (arg == "-p") {
+            std::string name = to_lower(argv[++i]);
+            if (name == "mesi") {
+                protocol = Protocol::MESI;
+            } else if (name == "moesi") {
+                protocol = Protocol::MOESI;
+            } else {
+                std::cerr << "Error: Protocol must be 'mesi' or 'moesi'."
+                          << std::endl;
+                return INVALID_COMMAND_LINE;
+            }
+        } else if (arg == "-b" || arg == "-n") {
+            int value;
+            try {
+                value = std::stoi(argv[++i]);
+            } catch (const std::exception &e) {
+                value = -1;
+            }
+            if (value < (arg == "-b" ? 1 : 0)) {
+                std::cerr << "Error: " << arg << " must be a "
+                          << (arg == "-b" ? "positive" : "non-negative")
+                          << " integer." << std::endl;
+                return INVALID_COMMAND_LINE;
+            }
+            (arg == "-b" ? bus_latency : top_blocks) = value;
+        } else {
+            LevelConfig level;
+            int error = parse_level_config(arg, level);
+            if (error != 0) {
+                return error;
+            }
+            levels.push_back(level);
+        }
+    }
+
+    if (levels.size() != 2) {
+        std::cerr << "Command Line Argument Format: csim coherence "
+                  << "[-p mesi|moesi] [-b bus_latency] [-n top_blocks] "
+                  << "[-t trace_file] <core_level> <shared_level>\n"
+                  << "  <level> = <sets>:<blocks>:<block_size>:<miss_type>:"
+                  << "<hit_type>:<eviction>:<latency>" << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+
+    // The protocol tracks ownership of dirty blocks, so writes must stay
+    // in the private caches
+    if (!levels[0].cache.hit_write_type) {
+        std::cerr << "Error: Private caches must be write-back." << std::endl;
+        return INVALID_HIT_TYPE;
+    }
+    if (levels[1].cache.bytes < levels[0].cache.bytes) {
+        std::cerr << "Error: Shared cache block size must be at least the "
+                  << "private block size." << std::endl;
+        return INVALID_BLOCK_SIZE;
+    }
+
+    int trace_fd = open_trace(trace_file);
+    if (trace_fd < 0) {
+        return INVALID_COMMAND_LINE;
+    }
+    TraceReader reader(trace_fd);
+
+    CoherentSystem system(levels[0], levels[1], protocol,
+                          static_cast<uint32_t>(bus_latency));
+
+    TraceReader::Status status;
+    TraceRecord record;
+    uint64_t run = 0;
+    while ((status = reader.next(record)) == TraceReader::RECORD) {
+        if (record.core >= CoherentSystem::MAX_CORES) {
+            std::cerr << "Error: Core " << record.core << " is out of range "
+                      << "(at most " << CoherentSystem::MAX_CORES
+                      << " cores). Simulation run " << run << std::endl;
+            return INVALID_COMMAND_LINE;
+        }
+        system.access(record);
+        ++run;
+    }
+
+    if (status != TraceReader::END) {
+        return report_trace_error(status, run);
+    }
+
+    // Per-core rows; a core's cycles include its coherence traffic
+    std::cout << "core,loads,stores,load_hits,load_misses,store_hits,"
+              << "store_misses,writebacks,invalidations,upgrades,transfers,"
+              << "coherence_misses,false_sharing,cycles\n";
+    for (size_t core = 0; core < system.get_core_count(); ++core) {
+        CacheStats stats = system.get_cache(core).get_stats();
+        const CoreStats &coherence = system.get_core_stats(core);
+        std::cout << core << "," << stats.loads << "," << stats.stores << ","
+                  << stats.load_hits << "," << stats.load_misses << ","
+                  << stats.store_hits << "," << stats.store_misses << ","
+                  << stats.writebacks << "," << coherence.invalidations << ","
+                  << coherence.upgrades << "," << coherence.transfers << ","
+                  << coherence.coherence_misses << ","
+                  << coherence.false_sharing << ","
+                  << stats.cycles + coherence.bus_cycles << "\n";
+    }
+
+    std::cout << "\n" << LEVEL_HEADER;
+    print_level("LLC", system.get_shared_cache().get_stats());
+
+    // The blocks with the most coherence traffic, busiest first
+    std::vector<std::pair<uint64_t, BlockStats>> blocks(
+        system.get_block_stats().begin(), system.get_block_stats().end());
+    auto traffic = [](const BlockStats &stats) {
+        return stats.invalidations + stats.coherence_misses;
+    };
+    std::sort(blocks.begin(), blocks.end(),
+              [&](const std::pair<uint64_t, BlockStats> &a,
+                  const std::pair<uint64_t, BlockStats> &b) {
+                  if (traffic(a.second) != traffic(b.second)) {
+                      return traffic(a.second) > traffic(b.second);
+                  }
+                  if (a.second.upgrades != b.second.upgrades) {
+                      return a.second.upgrades > b.second.upgrades;
+                  }
+                  return a.first < b.first;
+              });
+    if (blocks.size() > static_cast<size_t>(top_blocks)) {
+        blocks.resize(static_cast<size_t>(top_blocks));
+    }
+
+    std::cout << "\nblock,invalidations,upgrades,coherence_misses,"
+              << "false_sharing\n";
+    for (const auto &entry : blocks) {
+        std::cout << "0x" << std::hex << entry.first << std::dec << ","
+                  << entry.second.invalidations << ","
+                  << entry.second.upgrades << ","
+                  << entry.second.coherence_misses << ","
+                  << entry.second.false_sharing << "\n";
+    }
+    std::cout.flush();
+
+    return EXIT_SUCCESS;
+}
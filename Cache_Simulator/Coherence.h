@@ -0,0 +1,212 @@
+#ifndef COHERENCE_H
+#define COHERENCE_H
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "Cache.h"
+#include "Hierarchy.h"
+#include "MemoryLevel.h"
+#include "TraceReader.h"
+
+/**
+ * Invalidation protocols keeping the private caches coherent.
+ */
+enum class Protocol {
+    MESI,   // A modified block read by another core is written back first
+    MOESI   // ... or kept dirty by its owner, which supplies the readers
+};
+
+/**
+ * Coherence counters of one core.
+ */
+struct CoreStats {
+    uint64_t invalidations = 0;     // Copies invalidated by other cores
+    uint64_t upgrades = 0;          // Writes to shared copies
+    uint64_t transfers = 0;         // Blocks received from another core
+    uint64_t coherence_misses = 0;  // Misses on copies lost to invalidation
+    uint64_t false_sharing = 0;     // ... where the word accessed was not
+                                    // written by another core meanwhile
+    uint64_t bus_cycles = 0;        // Cycles spent on coherence traffic
+};
+
+/**
+ * Coherence counters of one block, summed over the cores.
+ */
+struct BlockStats {
+    uint64_t invalidations = 0;
+    uint64_t upgrades = 0;
+    uint64_t coherence_misses = 0;
+    uint64_t false_sharing = 0;
+};
+
+/**
+ * Private per-core caches kept coherent by a directory-based MESI or MOESI
+ * protocol over a shared last-level cache.
+ *
+ * The directory tracks which cores hold every cached block and which one
+ * of them, if any, owns it (Exclusive, Modified or, for MOESI, Owned);
+ * every other holder is Shared. Before an access reaches its core's
+ * private cache the directory resolves it: a read miss is served by
+ * another holder (a cache-to-cache transfer) or the shared cache, and a
+ * write to a block other cores hold invalidates their copies. A core
+ * whose copy was invalidated and that misses on the block again takes a
+ * coherence miss; it counts as false sharing when no other core wrote the
+ * word it accesses in between.
+ *
+ * Private caches must be write-back. Cores are created on first use.
+ */
+class CoherentSystem {
+public:
+    // Largest number of cores (the directory keeps a bit per core)
+    static const uint32_t MAX_CORES = 64;
+
+    /**
+     * @param core_level Configuration of every private cache.
+     * @param shared_level Configuration of the shared last-level cache.
+     * @param protocol The coherence protocol.
+     * @param bus_latency Cycles taken by a coherence transaction (an
+     * invalidation round or a cache-to-cache transfer).
+     */
+    CoherentSystem(const LevelConfig &core_level,
+                   const LevelConfig &shared_level, Protocol protocol,
+                   uint32_t bus_latency);
+
+    /**
+     * Simulates one access.
+     *
+     * @param record The access; its core must be below MAX_CORES.
+     */
+    void access(const TraceRecord &record);
+
+    /**
+     * @return Number of cores seen so far
+     */
+    size_t get_core_count() { return cores.size(); }
+
+    /**
+     * @param core Core number.
+     * @return The core's private cache
+     */
+    Cache &get_cache(size_t core) { return *cores[core]->cache; }
+
+    /**
+     * @param core Core number.
+     * @return The core's coherence counters
+     */
+    const CoreStats &get_core_stats(size_t core) {
+        return cores[core]->stats;
+    }
+
+    /**
+     * @return The shared last-level cache
+     */
+    Cache &get_shared_cache() { return *shared; }
+
+    /**
+     * @return Coherence counters of every block that had a coherence event
+     */
+    const std::unordered_map<uint64_t, BlockStats> &get_block_stats() {
+        return block_stats;
+    }
+
+private:
+    /**
+     * States of a block's owner. Holders other than the owner are Shared,
+     * and a block with no owner is Shared by all of its holders.
+     */
+    enum OwnerState { EXCLUSIVE, MODIFIED, OWNED };
+
+    /**
+     * Directory entry of a block.
+     */
+    struct Line {
+        uint64_t holders = 0;  // Cores with a copy, one bit per core
+        int owner = -1;        // Core holding it E, M or O; -1 for none
+        OwnerState state = EXCLUSIVE;
+        uint64_t lost = 0;     // Cores whose copy was invalidated since
+                               // they last held it
+    };
+
+    /**
+     * Connects a private cache to the shared cache. Its reads are served
+     * by another core instead when the directory arranged a transfer, and
+     * its evictions remove the core from the directory.
+     */
+    class CorePort : public MemoryLevel {
+    public:
+        CorePort(CoherentSystem &system, uint32_t core)
+            : system(system), core(core) {}
+
+        uint64_t read_block(uint64_t address, uint32_t bytes,
+                            bool &dirty) override;
+        uint64_t write_word(uint64_t address) override;
+        uint64_t evict_block(uint64_t address, uint32_t bytes,
+                             bool dirty) override;
+
+    private:
+        CoherentSystem &system;
+        const uint32_t core;
+    };
+
+    /**
+     * A core: its private cache and coherence state.
+     */
+    struct Core {
+        std::unique_ptr<Cache> cache;
+        std::unique_ptr<CorePort> port;
+        CoreStats stats;
+
+        // Lost blocks -> words other cores wrote since (bit i: word i % 64)
+        std::unordered_map<uint64_t, uint64_t> written;
+    };
+
+    // Creates cores up to and including `core`
+    void add_cores(uint32_t core);
+
+    // Brings a block a core misses on into the right state, returning the
+    // core's bus cycles
+    uint64_t read_miss(uint32_t core, uint64_t block, Line &line);
+
+    // Invalidates every copy but the writer's and makes it the owner
+    uint64_t invalidate_others(uint32_t core, uint64_t block, uint32_t word,
+                               Line &line);
+
+    // Counts a miss on a block the core lost to an invalidation
+    void note_coherence_miss(uint32_t core, uint64_t block, uint32_t word,
+                             Line &line);
+
+    // Forgets a core's copy when its cache evicts it
+    void drop(uint32_t core, uint64_t block);
+
+    const LevelConfig core_level;
+    const Protocol protocol;
+    const uint32_t bus_latency;
+    const uint64_t block_mask;  // Clears the offset of a private block
+
+    std::vector<std::unique_ptr<Core>> cores;
+    std::unique_ptr<Cache> shared;
+
+    std::unordered_map<uint64_t, Line> directory;
+    std::unordered_map<uint64_t, BlockStats> block_stats;
+
+    // Set while a private cache fetches a block another core supplies
+    bool peer_supplies = false;
+};
+
+/**
+ * `csim coherence [-p mesi|moesi] [-b bus_latency] [-n top_blocks]
+ * [-t trace_file] <core_level> <shared_level>`: simulates one private cache
+ * per core id in the trace, kept coherent over a shared last-level cache,
+ * and prints per-core and shared-cache CSV rows plus the blocks with the
+ * most coherence traffic. Levels use the `csim hierarchy` syntax.
+ *
+ * @param argc Argument count, starting at the subcommand name.
+ * @param argv Arguments, starting at the subcommand name.
+ * @return csim exit code.
+ */
+int run_coherence(int argc, char **argv);
+
+#endif  // COHERENCE_H
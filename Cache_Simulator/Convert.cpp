@@ -0,0 +1,70 @@
+#include "Convert.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "ErrorCodes.h"
+#include "TraceReader.h"
+#include "TraceWriter.h"
+
+/**
+ * Converts a trace between the text and binary formats.
+ *
+ * @param argc Argument count, starting at the subcommand name.
+ * @param argv Arguments, starting at the subcommand name.
+ * @return csim exit code.
+ */
+int run_convert(int argc, char** argv) {
+    if (argc != 3) {
+        std::cerr << "Command Line Argument Format: csim convert "
+                  << "<input_trace|-> <output_trace|->" << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+
+    std::string input = argv[1];
+    std::string output = argv[2];
+
+    int in_fd = open_trace(input);
+    if (in_fd < 0) {
+        return INVALID_COMMAND_LINE;
+    }
+
+    int out_fd = STDOUT_FILENO;
+    if (output != "-") {
+        out_fd = open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (out_fd < 0) {
+            std::cerr << "Error: Unable to create trace file '" << output
+                      << "'." << std::endl;
+            return INVALID_COMMAND_LINE;
+        }
+    }
+
+    TraceReader reader(in_fd);
+    TraceWriter writer(out_fd, !reader.is_binary());
+
+    TraceRecord record;
+    TraceReader::Status status;
+
+    uint64_t run = 0;
+    while ((status = reader.next(record)) == TraceReader::RECORD) {
+        writer.write(record);
+        ++run;
+    }
+
+    if (status != TraceReader::END) {
+        return report_trace_error(status, run);
+    }
+
+    if (!writer.flush()) {
+        std::cerr << "Error: Unable to write trace file '" << output << "'."
+                  << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,15 @@
+#ifndef CONVERT_H
+#define CONVERT_H
+
+/**
+ * `csim convert <input> <output>`: converts a text trace to the binary trace
+ * format or a binary trace back to text. The direction is picked from the
+ * input's format, and `-` names standard input / output.
+ *
+ * @param argc Argument count, starting at the subcommand name.
+ * @param argv Arguments, starting at the subcommand name.
+ * @return csim exit code.
+ */
+int run_convert(int argc, char **argv);
+
+#endif  // CONVERT_H
@@ -0,0 +1,391 @@
+#include "Decompressor.h"
+
+#include <unistd.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#ifdef CSIM_HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef CSIM_HAVE_LZ4
+#include <lz4frame.h>
+#endif
+
+#include "ChunkPipeline.h"
+
+/**
+ * Streaming decoder of one compression format.
+ */
+class Decompressor::Decoder {
+public:
+    virtual ~Decoder() = default;
+
+    /**
+     * Decodes as much of [in, in_end) into [out, out_end) as fits, advancing
+     * both.
+     *
+     * @return False if the input is damaged.
+     */
+    virtual bool decode(const unsigned char *&in, const unsigned char *in_end,
+                        char *&out, char *out_end) = 0;
+
+    /**
+     * @return True if everything decoded so far forms whole streams (or
+     * frames), so the input may end here.
+     */
+    virtual bool at_boundary() const = 0;
+};
+
+namespace {
+
+// Most input handed to zlib at once (its counts are 32-bit)
+const size_t ZLIB_STEP = 1u << 30;
+
+/**
+ * gzip through zlib. Concatenated members, as written by `cat a.gz b.gz`
+ * or by parallel compressors, are decoded one after another.
+ */
+class GzipDecoder : public Decompressor::Decoder {
+public:
+    GzipDecoder() {
+        // 15 + 32: full window, with gzip or zlib headers detected
+        ok = inflateInit2(&stream, 15 + 32) == Z_OK;
+    }
+
+    ~GzipDecoder() override { inflateEnd(&stream); }
+
+    bool decode(const unsigned char *&in, const unsigned char *in_end,
+                char *&out, char *out_end) override {
+        if (!ok) {
+            return false;
+        }
+        if (member_done) {
+            inflateReset(&stream);
+            member_done = false;
+        }
+
+        stream.next_in = const_cast<Bytef *>(in);
+        stream.avail_in = static_cast<uInt>(
+            std::min(static_cast<size_t>(in_end - in), ZLIB_STEP));
+        stream.next_out = reinterpret_cast<Bytef *>(out);
+        stream.avail_out = static_cast<uInt>(
+            std::min(static_cast<size_t>(out_end - out), ZLIB_STEP));
+
+        int result = inflate(&stream, Z_NO_FLUSH);
+        in = stream.next_in;
+        out = reinterpret_cast<char *>(stream.next_out);
+
+        if (result == Z_STREAM_END) {
+            member_done = true;
+            return true;
+        }
+        return result == Z_OK || result == Z_BUF_ERROR;
+    }
+
+    bool at_boundary() const override { return member_done; }
+
+private:
+    z_stream stream = {};
+    bool ok;
+    bool member_done = false;
+};
+
+#ifdef CSIM_HAVE_ZSTD
+/**
+ * zstd; concatenated frames are decoded one after another.
+ */
+class ZstdDecoder : public Decompressor::Decoder {
+public:
+    ZstdDecoder() : stream(ZSTD_createDStream()) {
+        ok = stream != nullptr && !ZSTD_isError(ZSTD_initDStream(stream));
+    }
+
+    ~ZstdDecoder() override { ZSTD_freeDStream(stream); }
+
+    bool decode(const unsigned char *&in, const unsigned char *in_end,
+                char *&out, char *out_end) override {
+        if (!ok) {
+            return false;
+        }
+        ZSTD_inBuffer input = {in, static_cast<size_t>(in_end - in), 0};
+        ZSTD_outBuffer output = {out, static_cast<size_t>(out_end - out), 0};
+        size_t result = ZSTD_decompressStream(stream, &output, &input);
+        in += input.pos;
+        out += output.pos;
+        if (ZSTD_isError(result)) {
+            return false;
+        }
+        // 0 once a frame is complete and fully flushed
+        pending = result;
+        return true;
+    }
+
+    bool at_boundary() const override { return pending == 0; }
+
+private:
+    ZSTD_DStream *stream;
+    bool ok;
+    size_t pending = 0;
+};
+#endif
+
+#ifdef CSIM_HAVE_LZ4
+/**
+ * lz4 frames; the context starts over by itself after each frame.
+ */
+class Lz4Decoder : public Decompressor::Decoder {
+public:
+    Lz4Decoder() {
+        ok = !LZ4F_isError(
+            LZ4F_createDecompressionContext(&context, LZ4F_VERSION));
+    }
+
+    ~Lz4Decoder() override { LZ4F_freeDecompressionContext(context); }
+
+    bool decode(const unsigned char *&in, const unsigned char *in_end,
+                char *&out, char *out_end) override {
+        if (!ok) {
+            return false;
+        }
+        size_t in_size = static_cast<size_t>(in_end - in);
+        size_t out_size = static_cast<size_t>(out_end - out);
+        size_t result =
+            LZ4F_decompress(context, out, &out_size, in, &in_size, nullptr);
+        in += in_size;
+        out += out_size;
+        if (LZ4F_isError(result)) {
+            return false;
+        }
+        // 0 once a frame is complete and fully flushed
+        pending = result;
+        return true;
+    }
+
+    bool at_boundary() const override { return pending == 0; }
+
+private:
+    LZ4F_dctx *context = nullptr;
+    bool ok;
+    size_t pending = 0;
+};
+#endif
+
+}  // namespace
+
+/**
+ * Recognises a compressed input from its first bytes.
+ *
+ * @param data Start of the input.
+ * @param size Bytes available at data.
+ * @return The input's compression, NONE if it is not compressed.
+ */
+Compression detect_compression(const char *data, size_t size) {
+    static const unsigned char GZIP_MAGIC[] = {0x1f, 0x8b};
+    static const unsigned char ZSTD_MAGIC[] = {0x28, 0xb5, 0x2f, 0xfd};
+    static const unsigned char LZ4_MAGIC[] = {0x04, 0x22, 0x4d, 0x18};
+
+    if (size >= sizeof(GZIP_MAGIC) &&
+        memcmp(data, GZIP_MAGIC, sizeof(GZIP_MAGIC)) == 0) {
+        return Compression::GZIP;
+    }
+    if (size >= sizeof(ZSTD_MAGIC) &&
+        memcmp(data, ZSTD_MAGIC, sizeof(ZSTD_MAGIC)) == 0) {
+        return Compression::ZSTD;
+    }
+    if (size >= sizeof(LZ4_MAGIC) &&
+        memcmp(data, LZ4_MAGIC, sizeof(LZ4_MAGIC)) == 0) {
+        return Compression::LZ4;
+    }
+    return Compression::NONE;
+}
+
+/**
+ * Starts decompressing. Reports on standard error and returns nullptr if
+ * this build cannot decode the format.
+ *
+ * @param format Compression of the input (not NONE).
+ * @param head Start of the compressed input. Without a descriptor it must
+ * stay valid until the decompressor is destroyed.
+ * @param head_size Bytes at head.
+ * @param fd Descriptor the rest of the input is read from, or -1.
+ * @return The running decompressor, or nullptr.
+ */
+std::unique_ptr<Decompressor> Decompressor::start(Compression format,
+                                                  const char *head,
+                                                  size_t head_size, int fd) {
+    std::unique_ptr<Decoder> decoder;
+    const char *name = nullptr;
+    switch (format) {
+        case Compression::GZIP:
+            decoder.reset(new GzipDecoder());
+            name = "gzip";
+            break;
+        case Compression::ZSTD:
+#ifdef CSIM_HAVE_ZSTD
+            decoder.reset(new ZstdDecoder());
+#endif
+            name = "zstd";
+            break;
+        case Compression::LZ4:
+#ifdef CSIM_HAVE_LZ4
+            decoder.reset(new Lz4Decoder());
+#endif
+            name = "lz4";
+            break;
+        case Compression::NONE:
+            return nullptr;
+    }
+
+    if (!decoder) {
+        std::cerr << "Error: This csim was built without " << name
+                  << " support; install its headers and rebuild, or "
+                     "decompress the trace first."
+                  << std::endl;
+        return nullptr;
+    }
+    return std::unique_ptr<Decompressor>(
+        new Decompressor(std::move(decoder), name, head, head_size, fd));
+}
+
+// constructor, starts the decompression thread
+Decompressor::Decompressor(std::unique_ptr<Decoder> decoder, const char *name,
+                           const char *head, size_t head_size, int fd)
+    : decoder(std::move(decoder)), name(name), fd(fd) {
+    if (fd < 0) {
+        in = reinterpret_cast<const unsigned char *>(head);
+    } else {
+        input.assign(head, head + head_size);
+        input.resize(std::max(input.size(), INPUT_SIZE));
+        in = input.data();
+    }
+    in_end = in + head_size;
+
+    for (Chunk &chunk : chunks) {
+        chunk.data.resize(CHUNK_SIZE);
+    }
+    worker = std::thread([this] { decompress(); });
+}
+
+// destructor
+Decompressor::~Decompressor() {
+    stopping.store(true, std::memory_order_relaxed);
+    worker.join();
+}
+
+/**
+ * Copies decompressed data out, waiting for the decompression thread if no
+ * chunk is ready yet. Stops at the end of a chunk rather than waiting for
+ * the next one once anything has been copied.
+ *
+ * @param out Destination.
+ * @param size Most bytes to copy.
+ * @return Bytes copied (0 at the end of the data or after an error).
+ */
+size_t Decompressor::read(char *out, size_t size) {
+    size_t copied = 0;
+    while (copied < size && !finished) {
+        Chunk &chunk = chunks[current % 2];
+        if (!chunk.full.load(std::memory_order_acquire)) {
+            if (copied > 0) {
+                break;
+            }
+            wait_for([&] {
+                return chunk.full.load(std::memory_order_acquire);
+            });
+        }
+
+        size_t n = std::min(size - copied, chunk.size - offset);
+        memcpy(out + copied, chunk.data.data() + offset, n);
+        copied += n;
+        offset += n;
+
+        if (offset == chunk.size) {
+            if (chunk.last) {
+                finished = true;
+                error = chunk.failed;
+                if (error) {
+                    std::cerr << "Error: The " << name
+                              << " trace is damaged, truncated or unreadable."
+                              << std::endl;
+                }
+            } else {
+                // Hand the chunk back to be refilled
+                chunk.full.store(false, std::memory_order_release);
+                ++current;
+                offset = 0;
+            }
+        }
+    }
+    return copied;
+}
+
+/**
+ * Body of the decompression thread: fills the chunks in turn until the
+ * input ends or turns out to be damaged.
+ */
+void Decompressor::decompress() {
+    for (uint64_t n = 0;; ++n) {
+        Chunk &chunk = chunks[n % 2];
+        wait_for([&] {
+            return !chunk.full.load(std::memory_order_acquire) ||
+                   stopping.load(std::memory_order_relaxed);
+        });
+        if (stopping.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        char *out = chunk.data.data();
+        char *out_end = out + chunk.data.size();
+        bool ended = false;
+        bool damaged = false;
+        while (out < out_end) {
+            if (in == in_end && !next_input()) {
+                // The input may only end between whole streams
+                ended = true;
+                damaged = input_failed || !decoder->at_boundary();
+                break;
+            }
+            if (!decoder->decode(in, in_end, out, out_end)) {
+                ended = damaged = true;
+                break;
+            }
+        }
+
+        chunk.size = static_cast<size_t>(out - chunk.data.data());
+        chunk.last = ended;
+        chunk.failed = damaged;
+        chunk.full.store(true, std::memory_order_release);
+        if (ended) {
+            return;
+        }
+    }
+}
+
+/**
+ * Reads the next block of compressed input from the descriptor.
+ *
+ * @return False at the end of the input or on error (see input_failed).
+ */
+bool Decompressor::next_input() {
+    if (fd < 0) {
+        return false;
+    }
+
+    ssize_t got;
+    do {
+        got = ::read(fd, input.data(), input.size());
+    } while (got < 0 && errno == EINTR);
+
+    if (got <= 0) {
+        input_failed = (got < 0);
+        fd = -1;
+        return false;
+    }
+    in = input.data();
+    in_end = in + got;
+    return true;
+}
@@ -0,0 +1,137 @@
+#ifndef DECOMPRESSOR_H
+#define DECOMPRESSOR_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+/**
+ * Compression formats a trace may be stored in.
+ */
+enum class Compression {
+    NONE,
+    GZIP,  // gzip (or zlib) streams, possibly several concatenated
+    ZSTD,  // zstd frames
+    LZ4    // lz4 frames (the `lz4` command line format)
+};
+
+// Bytes of input needed to recognise any of the formats
+const size_t COMPRESSION_MAGIC_SIZE = 4;
+
+/**
+ * Recognises a compressed input from its first bytes.
+ *
+ * @param data Start of the input.
+ * @param size Bytes available at data.
+ * @return The input's compression, NONE if it is not compressed.
+ */
+Compression detect_compression(const char *data, size_t size);
+
+/**
+ * Decompresses an input on a background thread.
+ *
+ * The decompression thread fills two output chunks in turn; the reading
+ * thread copies data out of one while the other is being filled, so
+ * decompression overlaps whatever the reader does with the data. The two
+ * sides only synchronize once per chunk, through atomics.
+ *
+ * The compressed input is `head` followed by everything that can still be
+ * read from `fd`. A mapped file is passed whole as the head with fd -1 and
+ * is decompressed in place; a stream passes the bytes already read from it,
+ * which are copied, and its descriptor.
+ */
+class Decompressor {
+public:
+    /**
+     * Starts decompressing. Reports on standard error and returns nullptr if
+     * this build cannot decode the format.
+     *
+     * @param format Compression of the input (not NONE).
+     * @param head Start of the compressed input. Without a descriptor it
+     * must stay valid until the decompressor is destroyed.
+     * @param head_size Bytes at head.
+     * @param fd Descriptor the rest of the input is read from, or -1.
+     * @return The running decompressor, or nullptr.
+     */
+    static std::unique_ptr<Decompressor> start(Compression format,
+                                               const char *head,
+                                               size_t head_size, int fd);
+
+    // destructor, stops and joins the decompression thread
+    ~Decompressor();
+
+    Decompressor(const Decompressor &) = delete;
+    Decompressor &operator=(const Decompressor &) = delete;
+
+    /**
+     * Copies decompressed data out, waiting for the decompression thread if
+     * no chunk is ready yet.
+     *
+     * @param out Destination.
+     * @param size Most bytes to copy.
+     * @return Bytes copied (0 at the end of the data or after an error).
+     */
+    size_t read(char *out, size_t size);
+
+    /**
+     * @return True if the input turned out to be damaged or unreadable
+     * (reported on standard error when read() reached the damage).
+     */
+    bool failed() const { return error; }
+
+    // Interface of the format-specific decoders
+    class Decoder;
+
+private:
+    // Size of each decompressed chunk and of each read(2) of input
+    static const size_t CHUNK_SIZE = 1 << 22;
+    static constexpr size_t INPUT_SIZE = 1 << 20;
+
+    /**
+     * One decompressed chunk. The decompression thread owns it while `full`
+     * is false and hands it over by setting `full`.
+     */
+    struct Chunk {
+        std::vector<char> data;
+        size_t size = 0;
+        bool last = false;    // No chunks follow this one
+        bool failed = false;  // The input ended in damage
+        std::atomic<bool> full{false};
+    };
+
+    Decompressor(std::unique_ptr<Decoder> decoder, const char *name,
+                 const char *head, size_t head_size, int fd);
+
+    // Body of the decompression thread
+    void decompress();
+
+    // Makes more compressed input available (decompression thread only).
+    // Returns false at the end of the input or on error
+    bool next_input();
+
+    std::unique_ptr<Decoder> decoder;
+    const char *name;  // Of the format, for error messages
+
+    // Compressed input window (decompression thread only)
+    const unsigned char *in = nullptr;
+    const unsigned char *in_end = nullptr;
+    int fd;
+    bool input_failed = false;
+    std::vector<unsigned char> input;
+
+    Chunk chunks[2];
+    std::atomic<bool> stopping{false};  // Set by the destructor
+
+    // Reading side: chunk being copied out and position in it
+    uint64_t current = 0;
+    size_t offset = 0;
+    bool finished = false;
+    bool error = false;
+
+    std::thread worker;
+};
+
+#endif  // DECOMPRESSOR_H
@@ -0,0 +1,183 @@
+#include "Dram.h"
+
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "CacheConfig.h"
+#include "ErrorCodes.h"
+
+/**
+ * Creates a DRAM with every bank closed.
+ *
+ * @param config Organisation and timings.
+ */
+DramModel::DramModel(const DramConfig& config)
+    : config(config),
+      row_shift(static_cast<uint32_t>(log2(config.row_bytes))),
+      burst_shift(static_cast<uint32_t>(log2(config.burst_bytes))),
+      open_rows(config.banks, NO_ROW) {}
+
+/**
+ * Reads a block from memory. Memory never holds dirty copies of its own.
+ *
+ * @param address Address of the first byte of the block.
+ * @param bytes Block size of the requesting level.
+ * @param dirty Set to false.
+ * @return Cycles taken.
+ */
+uint64_t DramModel::read_block(uint64_t address, uint32_t bytes,
+                               bool& dirty) {
+    dirty = false;
+    ++stats.reads;
+    return access(address, bytes);
+}
+
+/**
+ * Writes a single word through, as one (masked) burst.
+ *
+ * @param address Address written.
+ * @return Cycles taken.
+ */
+uint64_t DramModel::write_word(uint64_t address) {
+    ++stats.writes;
+    return access(address, 4);
+}
+
+/**
+ * Writes back a dirty block; clean blocks are dropped for free.
+ *
+ * @param address Address of the first byte of the block.
+ * @param bytes Block size of the evicting level.
+ * @param dirty True if the block was modified.
+ * @return Cycles taken.
+ */
+uint64_t DramModel::evict_block(uint64_t address, uint32_t bytes,
+                                bool dirty) {
+    if (!dirty) {
+        return 0;
+    }
+    ++stats.writes;
+    return access(address, bytes);
+}
+
+/**
+ * Serves one request. A request larger than a row is split at row
+ * boundaries, each part opening its own row.
+ *
+ * @param address First byte of the request.
+ * @param bytes Length of the request.
+ * @return Cycles taken.
+ */
+uint64_t DramModel::access(uint64_t address, uint32_t bytes) {
+    uint64_t latency = 0;
+    uint64_t end = address + bytes;
+    while (address < end) {
+        uint64_t row_number = address >> row_shift;
+        uint64_t row_end = (row_number + 1) << row_shift;
+        uint64_t part_end = row_end < end ? row_end : end;
+
+        latency += open_row(static_cast<uint32_t>(row_number % config.banks),
+                            row_number / config.banks);
+
+        // Whole bursts covering the part
+        uint64_t first = address >> burst_shift;
+        uint64_t last = (part_end - 1) >> burst_shift;
+        stats.bursts += last - first + 1;
+        latency += (last - first + 1) * config.burst_cycles;
+
+        address = part_end;
+    }
+    stats.cycles += latency;
+    return latency;
+}
+
+/**
+ * Makes a row ready for a column access under the page policy.
+ *
+ * @param bank The row's bank.
+ * @param row The row within the bank.
+ * @return Cycles until the data starts to move.
+ */
+uint64_t DramModel::open_row(uint32_t bank, uint64_t row) {
+    if (!config.open_page) {
+        // Closed page: the bank was precharged after its last access
+        ++stats.row_misses;
+        return config.rcd + config.cas;
+    }
+
+    uint64_t& open = open_rows[bank];
+    if (open == row) {
+        ++stats.row_hits;
+        return config.cas;
+    }
+
+    uint64_t latency = config.rcd + config.cas;
+    if (open == NO_ROW) {
+        ++stats.row_misses;
+    } else {
+        ++stats.row_conflicts;
+        latency += config.rp;
+    }
+    open = row;
+    return latency;
+}
+
+/**
+ * Parses a DRAM specification.
+ *
+ * @param spec The specification.
+ * @param config Filled with the parsed configuration on success.
+ * @return 0 on success, otherwise the csim exit code for the problem.
+ */
+int parse_dram_config(const std::string& spec, DramConfig& config) {
+    std::vector<std::string> fields = split(spec, ':');
+    std::string policy = fields.empty() ? "" : to_lower(fields[0]);
+
+    config = DramConfig();
+    if (policy == "open" || policy == "closed") {
+        config.open_page = (policy == "open");
+    } else {
+        std::cerr << "Error: DRAM must be '<open|closed>[:<banks>"
+                     "[:<row_bytes>[:<burst_bytes>[:<cas>[:<rcd>[:<rp>"
+                     "[:<burst_cycles>]]]]]]]'."
+                  << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+
+    // Parameters in order after the page policy
+    std::vector<uint32_t*> values = {
+        &config.banks, &config.row_bytes, &config.burst_bytes, &config.cas,
+        &config.rcd,   &config.rp,        &config.burst_cycles};
+    if (fields.size() > values.size() + 1) {
+        std::cerr << "Error: Too many parameters in DRAM '" << spec << "'."
+                  << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+    for (size_t i = 1; i < fields.size(); ++i) {
+        int value;
+        try {
+            value = std::stoi(fields[i]);
+        } catch (const std::exception& e) {
+            value = 0;
+        }
+        if (value <= 0) {
+            std::cerr << "Error: DRAM parameters must be positive integers."
+                      << std::endl;
+            return INVALID_COMMAND_LINE;
+        }
+        *values[i - 1] = static_cast<uint32_t>(value);
+    }
+
+    if (!is_power_of_2(config.row_bytes) ||
+        !is_power_of_2(config.burst_bytes) ||
+        config.burst_bytes > config.row_bytes) {
+        std::cerr << "Error: DRAM row and burst sizes must be powers of 2, "
+                     "with bursts no larger than rows."
+                  << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+    return 0;
+}
@@ -0,0 +1,124 @@
+#ifndef DRAM_H
+#define DRAM_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MemoryLevel.h"
+
+/**
+ * A parsed DRAM specification (see parse_dram_config). Timings are in the
+ * simulator's cycles.
+ */
+struct DramConfig {
+    bool open_page = true;       // Leave rows open after an access
+    uint32_t banks = 8;          // Independent banks, each with a row buffer
+    uint32_t row_bytes = 8192;   // Bytes per row (a power of 2)
+    uint32_t burst_bytes = 64;   // Bytes moved per burst (a power of 2)
+    uint32_t cas = 40;           // Column access: row buffer to data out
+    uint32_t rcd = 40;           // Activate: row into the row buffer
+    uint32_t rp = 40;            // Precharge: close the open row
+    uint32_t burst_cycles = 8;   // Cycles to transfer one burst
+};
+
+/**
+ * Counters of a DRAM model. Every request is classified once per row it
+ * touches: a row hit finds the row already open, a row miss finds the bank
+ * closed, and a row conflict has to close another row first.
+ */
+struct DramStats {
+    uint64_t reads = 0;   // Block reads
+    uint64_t writes = 0;  // Write-backs and written-through words
+    uint64_t row_hits = 0;
+    uint64_t row_misses = 0;
+    uint64_t row_conflicts = 0;
+    uint64_t bursts = 0;
+    uint64_t cycles = 0;  // Latency of all requests together
+
+    /**
+     * @return Share of row accesses that hit an open row (0 if none)
+     */
+    double row_hit_rate() const {
+        uint64_t rows = row_hits + row_misses + row_conflicts;
+        return rows ? static_cast<double>(row_hits) / rows : 0;
+    }
+
+    /**
+     * @return Average latency of a request in cycles (0 if none)
+     */
+    double average_latency() const {
+        uint64_t requests = reads + writes;
+        return requests ? static_cast<double>(cycles) / requests : 0;
+    }
+};
+
+/**
+ * Main memory as banks of DRAM, used in place of the flat per-word memory
+ * cost when set as the next level of the last cache.
+ *
+ * Addresses are interleaved across banks a row at a time (column bits
+ * lowest, then bank, then row), so a sequential stream sweeps a whole row
+ * of one bank before moving on to the next bank. Each bank has a row
+ * buffer: with the open page policy the row stays open after an access,
+ * and a later access to it only pays the column access, while one to
+ * another row first pays a precharge; with the closed page policy every
+ * access activates its row and the bank is closed again in the
+ * background. Data then moves in bursts of `burst_bytes`.
+ *
+ * Requests are served one at a time in the order they arrive, and their
+ * latencies are charged to the cache that made them.
+ */
+class DramModel : public MemoryLevel {
+public:
+    /**
+     * Creates a DRAM with every bank closed.
+     *
+     * @param config Organisation and timings.
+     */
+    explicit DramModel(const DramConfig &config);
+
+    uint64_t read_block(uint64_t address, uint32_t bytes,
+                        bool &dirty) override;
+    uint64_t write_word(uint64_t address) override;
+    uint64_t evict_block(uint64_t address, uint32_t bytes,
+                         bool dirty) override;
+
+    /**
+     * @return Counters so far
+     */
+    const DramStats &get_stats() const { return stats; }
+
+private:
+    // Serves a read or write of [address, address + bytes) and returns its
+    // latency
+    uint64_t access(uint64_t address, uint32_t bytes);
+
+    // Latency of opening `row` in `bank` for a column access, counting the
+    // outcome
+    uint64_t open_row(uint32_t bank, uint64_t row);
+
+    const DramConfig config;
+    const uint32_t row_shift;    // log2(row_bytes)
+    const uint32_t burst_shift;  // log2(burst_bytes)
+
+    // Row open in each bank, NO_ROW if the bank is closed
+    static constexpr uint64_t NO_ROW = UINT64_MAX;
+    std::vector<uint64_t> open_rows;
+
+    DramStats stats;
+};
+
+/**
+ * Parses a DRAM specification:
+ * `<open|closed>[:<banks>[:<row_bytes>[:<burst_bytes>[:<cas>[:<rcd>[:<rp>
+ * [:<burst_cycles>]]]]]]]`, parameters left out keeping the defaults of
+ * DramConfig. Problems are reported on standard error.
+ *
+ * @param spec The specification.
+ * @param config Filled with the parsed configuration on success.
+ * @return 0 on success, otherwise the csim exit code for the problem.
+ */
+int parse_dram_config(const std::string &spec, DramConfig &config);
+
+#endif  // DRAM_H
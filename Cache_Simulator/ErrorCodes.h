@@ -0,0 +1,15 @@
+#ifndef ERROR_CODES_H
+#define ERROR_CODES_H
+
+// Error codes for different types of invalid input
+#define INVALID_COMMAND_LINE 1
+#define INVALID_SET_NUM 2
+#define INVALID_BLOCK_NUM 3
+#define INVALID_BLOCK_SIZE 4
+#define INVALID_MISS_TYPE 5
+#define INVALID_HIT_TYPE 6
+#define INVALID_EVICTION 7
+#define INVALID_OPERATOR 8
+#define INVALID_ADDRESS 9
+
+#endif  // ERROR_CODES_H
@@ -0,0 +1,346 @@
+#include "Hierarchy.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Cache.h"
+#include "Dram.h"
+#include "ErrorCodes.h"
+#include "Prefetcher.h"
+#include "TraceReader.h"
+
+/**
+ * Prints one CSV row of level statistics, in the columns of LEVEL_HEADER.
+ *
+ * @param name Name of the level.
+ * @param stats Its counters.
+ */
+void print_level(const std::string& name, const CacheStats& stats) {
+    uint64_t accesses = uint64_t{stats.loads} + stats.stores;
+    uint64_t hits = uint64_t{stats.load_hits} + stats.store_hits;
+    double hit_rate = accesses ? static_cast<double>(hits) / accesses : 0;
+    double amat = accesses ? static_cast<double>(stats.cycles) / accesses : 0;
+
+    std::cout << name << "," << stats.loads << "," << stats.stores << ","
+              << stats.load_hits << "," << stats.load_misses << ","
+              << stats.store_hits << "," << stats.store_misses << ","
+              << stats.writebacks << "," << hit_rate << "," << stats.cycles
+              << "," << amat << "\n";
+}
+
+/**
+ * Builds and connects the levels.
+ *
+ * @param levels Configuration of every level, L1 first.
+ * @param inclusion Policy of every level below L1.
+ * @param instruction Configuration of the L1 instruction cache, or null.
+ * @param victim Configuration of the victim cache behind level 0, or null.
+ * @param memory Main memory behind the caches, or null for the flat cost.
+ */
+CacheHierarchy::CacheHierarchy(const std::vector<LevelConfig>& configs,
+                               Inclusion inclusion,
+                               const LevelConfig* instruction,
+                               const VictimConfig* victim,
+                               MemoryLevel* memory) {
+    for (const LevelConfig& config : configs) {
+        levels.push_back(make_cache(config.cache));
+        levels.back()->set_hit_latency(config.latency);
+    }
+
+    if (instruction != nullptr) {
+        instruction_cache = make_cache(instruction->cache);
+        instruction_cache->set_hit_latency(instruction->latency);
+        if (levels.size() > 1) {
+            instruction_cache->set_next_level(levels[1].get());
+            levels[1]->add_upper_level(instruction_cache.get());
+        }
+    }
+
+    for (size_t i = 1; i < levels.size(); ++i) {
+        levels[i - 1]->set_next_level(levels[i].get());
+        levels[i]->add_upper_level(levels[i - 1].get());
+        levels[i]->set_inclusion(inclusion);
+    }
+
+    if (victim != nullptr) {
+        // Splice the victim cache in below level 0. It becomes level 1's
+        // upper level, so inclusive evictions reach level 0 through it
+        victim_cache = make_victim_cache(*victim, configs[0].cache.bytes);
+        victim_cache->add_upper_level(levels[0].get());
+        if (levels.size() > 1) {
+            victim_cache->set_next_level(levels[1].get());
+            levels[1]->replace_upper_level(levels[0].get(),
+                                           victim_cache.get());
+        }
+        levels[0]->set_next_level(victim_cache.get());
+    }
+
+    // Memory goes behind the last level, or behind the victim cache and the
+    // instruction cache when there is no level 1 below them
+    if (levels.size() > 1) {
+        levels.back()->set_next_level(memory);
+    } else {
+        (victim_cache ? victim_cache : levels[0])->set_next_level(memory);
+        if (instruction_cache) {
+            instruction_cache->set_next_level(memory);
+        }
+    }
+}
+
+/**
+ * Parses one level of a hierarchy.
+ *
+ * @param spec The level specification.
+ * @param level Filled with the parsed level on success.
+ * @return 0 on success, otherwise the csim exit code for the problem.
+ */
+int parse_level_config(const std::string& spec, LevelConfig& level) {
+    std::vector<std::string> fields = split(spec, ':');
+    if (fields.size() != 7) {
+        std::cerr << "Error: Level specification '" << spec
+                  << "' must have 7 ':'-separated parameters." << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+
+    int latency;
+    try {
+        latency = std::stoi(fields[6]);
+    } catch (const std::exception& e) {
+        latency = -1;
+    }
+    if (latency <= 0) {
+        std::cerr << "Error: Level latency must be a positive integer."
+                  << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+    level.latency = static_cast<uint32_t>(latency);
+
+    fields.pop_back();
+    int error = parse_cache_config(fields, level.cache);
+    if (error == 0 && level.cache.eviction == Eviction::OPT) {
+        // Lower levels see a filtered stream the next-use index cannot follow
+        std::cerr << "Error: opt is only supported for a single cache."
+                  << std::endl;
+        return INVALID_EVICTION;
+    }
+    return error;
+}
+
+/**
+ * Simulates a multi-level cache hierarchy over a trace.
+ *
+ * @param argc Argument count, starting at the subcommand name.
+ * @param argv Arguments, starting at the subcommand name.
+ * @return csim exit code.
+ */
+int run_hierarchy(int argc, char** argv) {
+    std::string trace_file = "-";
+    Inclusion inclusion = Inclusion::NINE;
+    std::vector<LevelConfig> levels;
+    LevelConfig instruction;
+    bool split = false;
+    PrefetcherConfig prefetch;
+    bool prefetching = false;
+    VictimConfig victim;
+    bool victim_caching = false;
+    uint32_t mshrs = 0;
+    DramConfig dram_config;
+    bool dram_modeling = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+
+        if ((arg == "-t" || arg == "-p" || arg == "-i" || arg == "-f" ||
+             arg == "-v" || arg == "-m" || arg == "-d") &&
+            i + 1 == argc) {
+            std::cerr << "Error: " << arg << " needs a value." << std::endl;
+            return INVALID_COMMAND_LINE;
+        }
+
+        if (arg == "-t") {
+            trace_file = argv[++i];
+        } else if (arg == "-i") {
+            int error = parse_level_config(argv[++i], instruction);
+            if (error != 0) {
+                return error;
+            }
+            split = true;
+        } else if (arg == "-f") {
+            int error = parse_prefetcher_config(argv[++i], prefetch);
+            if (error != 0) {
+                return error;
+            }
+            prefetching = true;
+        } else if (arg == "-v") {
+            int error = parse_victim_config(argv[++i], victim);
+            if (error != 0) {
+                return error;
+            }
+            victim_caching = true;
+        } else if (arg == "-m") {
+            int value;
+            try {
+                value = std::stoi(argv[++i]);
+            } catch (const std::exception& e) {
+                value = 0;
+            }
+            if (value <= 0) {
+                std::cerr << "Error: -m must be a positive integer."
+                          << std::endl;
+                return INVALID_COMMAND_LINE;
+            }
+            mshrs = static_cast<uint32_t>(value);
+        } else if (arg == "-d") {
+            int error = parse_dram_config(argv[++i], dram_config);
+            if (error != 0) {
+                return error;
+            }
+            dram_modeling = true;
+        } else if (arg == "-p") {
+            std::string policy = to_lower(argv[++i]);
+            if (policy == "nine") {
+                inclusion = Inclusion::NINE;
+            } else if (policy == "inclusive") {
+                inclusion = Inclusion::INCLUSIVE;
+            } else if (policy == "exclusive") {
+                inclusion = Inclusion::EXCLUSIVE;
+            } else {
+                std::cerr << "Error: Inclusion policy must be 'nine', "
+                          << "'inclusive' or 'exclusive'." << std::endl;
+                return INVALID_COMMAND_LINE;
+            }
+        } else {
+            LevelConfig level;
+            int error = parse_level_config(arg, level);
+            if (error != 0) {
+                return error;
+            }
+            levels.push_back(level);
+        }
+    }
+
+    if (levels.empty()) {
+        std::cerr << "Command Line Argument Format: csim hierarchy "
+                  << "[-p nine|inclusive|exclusive] [-i l1i_level] "
+                  << "[-f prefetcher] [-v victim_blocks] [-m mshrs] "
+                  << "[-d dram] [-t trace_file] <level>...\n"
+                  << "  <level> = <sets>:<blocks>:<block_size>:<miss_type>:"
+                  << "<hit_type>:<eviction>:<latency>, L1 first" << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+
+    // A lower level must hold whole blocks of the level above, and an
+    // exclusive level swaps blocks with it one for one. A split L1's
+    // instruction cache sits above level 2 like the data cache does
+    std::vector<LevelConfig> uppers(levels.begin(), levels.end() - 1);
+    std::vector<size_t> lowers(levels.size() - 1);
+    for (size_t i = 0; i < lowers.size(); ++i) {
+        lowers[i] = i + 1;
+    }
+    if (split && levels.size() > 1) {
+        uppers.push_back(instruction);
+        lowers.push_back(1);
+    }
+    for (size_t i = 0; i < uppers.size(); ++i) {
+        uint32_t upper = uppers[i].cache.bytes;
+        uint32_t lower = levels[lowers[i]].cache.bytes;
+        if (lower < upper ||
+            (inclusion == Inclusion::EXCLUSIVE && lower != upper)) {
+            std::cerr << "Error: Level " << lowers[i] + 1
+                      << " block size must be "
+                      << (inclusion == Inclusion::EXCLUSIVE ? "equal to"
+                                                            : "at least")
+                      << " the block size of the level above it."
+                      << std::endl;
+            return INVALID_BLOCK_SIZE;
+        }
+    }
+
+    int trace_fd = open_trace(trace_file);
+    if (trace_fd < 0) {
+        return INVALID_COMMAND_LINE;
+    }
+    TraceReader reader(trace_fd);
+
+    std::unique_ptr<DramModel> dram;
+    if (dram_modeling) {
+        dram = std::make_unique<DramModel>(dram_config);
+    }
+    CacheHierarchy hierarchy(levels, inclusion, split ? &instruction : nullptr,
+                             victim_caching ? &victim : nullptr, dram.get());
+    if (prefetching) {
+        // The prefetcher feeds the (data) cache at level 0
+        hierarchy.get_level(0).set_prefetcher(
+            make_prefetcher(prefetch, levels[0].cache.bytes));
+    }
+    hierarchy.get_level(0).set_mshrs(mshrs);
+
+    TraceReader::Status status;
+    TraceRecord record;
+    uint64_t run = 0;
+    while ((status = reader.next(record)) == TraceReader::RECORD) {
+        if (record.op == 'l') {
+            hierarchy.load(record.address);
+        } else if (record.op == 's') {
+            hierarchy.store(record.address);
+        } else {
+            hierarchy.fetch(record.address);
+        }
+        ++run;
+    }
+
+    if (status != TraceReader::END) {
+        return report_trace_error(status, run);
+    }
+
+    // One summary row per cache, the instruction cache's fetches counted
+    // as its loads. A level's cycles include the time spent in the levels
+    // below it, so its AMAT is the average time of an access that reaches it
+    std::cout << LEVEL_HEADER;
+    if (split) {
+        print_level("L1I", hierarchy.get_instruction_cache()->get_stats());
+    }
+    for (size_t i = 0; i < hierarchy.get_level_count(); ++i) {
+        std::string name = "L" + std::to_string(i + 1);
+        if (i == 0 && split) {
+            name += "D";
+        }
+        print_level(name, hierarchy.get_level(i).get_stats());
+        if (i == 0 && victim_caching) {
+            // The victim cache's loads are the probes of level 0's misses
+            print_level("VC", hierarchy.get_victim_cache()->get_stats());
+        }
+    }
+
+    if (prefetching) {
+        PrefetchStats stats = hierarchy.get_level(0).get_prefetch_stats();
+        std::cout << "\nlevel,prefetches,useful,late,unused,pollution_misses\n"
+                  << (split ? "L1D" : "L1") << "," << stats.issued << ","
+                  << stats.useful << "," << stats.late << "," << stats.unused
+                  << "," << stats.pollution << "\n";
+    }
+    if (mshrs != 0) {
+        MshrStats stats = hierarchy.get_level(0).get_mshr_stats();
+        std::cout << "\nlevel,fills,merged,full_stalls,overlapped_cycles\n"
+                  << (split ? "L1D" : "L1") << "," << stats.fills << ","
+                  << stats.merged << "," << stats.full_stalls << ","
+                  << stats.overlapped << "\n";
+    }
+    if (dram) {
+        const DramStats& stats = dram->get_stats();
+        std::cout << "\nmemory,reads,writes,row_hits,row_misses,"
+                  << "row_conflicts,row_hit_rate,average_latency\n"
+                  << "DRAM," << stats.reads << "," << stats.writes << ","
+                  << stats.row_hits << "," << stats.row_misses << ","
+                  << stats.row_conflicts << "," << stats.row_hit_rate() << ","
+                  << stats.average_latency() << "\n";
+    }
+    std::cout.flush();
+
+    return EXIT_SUCCESS;
+}
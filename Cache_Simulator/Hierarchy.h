@@ -0,0 +1,150 @@
+#ifndef HIERARCHY_H
+#define HIERARCHY_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Cache.h"
+#include "CacheConfig.h"
+
+/**
+ * One level of a cache hierarchy: its geometry and policies, and the
+ * number of cycles an access that hits in it takes.
+ */
+struct LevelConfig {
+    CacheConfig cache;
+    uint32_t latency;
+};
+
+/**
+ * A chain of caches, level 0 (L1) first and main memory behind the last
+ * level. Accesses enter at level 0; misses, write-throughs and evictions
+ * travel down the chain.
+ *
+ * L1 may be split: instruction fetches then go to a separate instruction
+ * cache, which shares the next level with the level 0 (data) cache.
+ *
+ * A victim cache may sit behind the level 0 (data) cache, between it and
+ * level 1 (or main memory).
+ *
+ * Main memory is the flat memory cost of the caches unless a memory level
+ * (such as a DramModel) is given, which then sits behind whichever caches
+ * have no level below them.
+ */
+class CacheHierarchy {
+public:
+    /**
+     * Builds and connects the levels.
+     *
+     * @param levels Configuration of every level, L1 first.
+     * @param inclusion Policy of every level below L1 towards the levels
+     * above it.
+     * @param instruction Configuration of the L1 instruction cache, or null
+     * for a unified L1.
+     * @param victim Configuration of the victim cache behind level 0, or
+     * null for none.
+     * @param memory Main memory behind the caches, or null for the flat
+     * memory cost; must outlive the hierarchy.
+     */
+    CacheHierarchy(const std::vector<LevelConfig> &levels,
+                   Inclusion inclusion,
+                   const LevelConfig *instruction = nullptr,
+                   const VictimConfig *victim = nullptr,
+                   MemoryLevel *memory = nullptr);
+
+    /**
+     * Simulates a load at level 0.
+     *
+     * @param address Address being read.
+     */
+    void load(uint64_t address) { levels[0]->load(address); }
+
+    /**
+     * Simulates a store at level 0.
+     *
+     * @param address Address being written.
+     */
+    void store(uint64_t address) { levels[0]->store(address); }
+
+    /**
+     * Simulates an instruction fetch, in the instruction cache if L1 is
+     * split and as a load at level 0 otherwise.
+     *
+     * @param address Address being fetched.
+     */
+    void fetch(uint64_t address) {
+        (instruction_cache ? instruction_cache : levels[0])->load(address);
+    }
+
+    /**
+     * @return Number of levels
+     */
+    size_t get_level_count() { return levels.size(); }
+
+    /**
+     * @param level Level number, 0 for L1.
+     * @return The cache at that level
+     */
+    Cache &get_level(size_t level) { return *levels[level]; }
+
+    /**
+     * @return The L1 instruction cache, or null if L1 is unified
+     */
+    Cache *get_instruction_cache() { return instruction_cache.get(); }
+
+    /**
+     * @return The victim cache behind level 0, or null if there is none
+     */
+    Cache *get_victim_cache() { return victim_cache.get(); }
+
+private:
+    std::vector<std::unique_ptr<Cache>> levels;
+    std::unique_ptr<Cache> instruction_cache;
+    std::unique_ptr<Cache> victim_cache;
+};
+
+// CSV header of the level rows printed by print_level
+const char LEVEL_HEADER[] =
+    "level,loads,stores,load_hits,load_misses,store_hits,store_misses,"
+    "writebacks,hit_rate,cycles,amat\n";
+
+/**
+ * Prints one CSV row of level statistics, in the columns of LEVEL_HEADER:
+ * the counters, hit rate, cycles and AMAT (cycles per access).
+ *
+ * @param name Name of the level.
+ * @param stats Its counters.
+ */
+void print_level(const std::string &name, const CacheStats &stats);
+
+/**
+ * Parses one level of a hierarchy: the six cache parameters followed by the
+ * hit latency in cycles, all separated by ':', e.g.
+ *
+ *   64:4:64:write-allocate:write-back:lru:4
+ *
+ * @param spec The level specification.
+ * @param level Filled with the parsed level on success.
+ * @return 0 on success, otherwise the csim exit code for the problem.
+ */
+int parse_level_config(const std::string &spec, LevelConfig &level);
+
+/**
+ * `csim hierarchy [-p nine|inclusive|exclusive] [-i l1i_level]
+ * [-f prefetcher] [-v victim_blocks] [-m mshrs] [-d dram] [-t trace_file]
+ * <level>...`: simulates a multi-level cache hierarchy, L1 first, printing
+ * one CSV row per cache with its hit rate and average memory access time.
+ * With -i, instruction fetches go to a separate L1 instruction cache and the
+ * first level is the L1 data cache. -f, -v and -m give the L1 (data) cache a
+ * prefetcher, a victim cache and MSHRs. -d puts a DRAM model (see Dram.h)
+ * behind the last level.
+ *
+ * @param argc Argument count, starting at the subcommand name.
+ * @param argv Arguments, starting at the subcommand name.
+ * @return csim exit code.
+ */
+int run_hierarchy(int argc, char **argv);
+
+#endif  // HIERARCHY_H
@@ -0,0 +1,133 @@
+#include "IntervalStats.h"
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <thread>
+
+#include "Cache.h"
+
+namespace {
+
+// How long the writer sleeps when it finds the ring empty
+const std::chrono::microseconds IDLE_SLEEP(200);
+
+}  // namespace
+
+/**
+ * Writes the CSV header and starts the writer thread.
+ *
+ * @param out Stream the rows go to; must outlive the writer.
+ */
+IntervalWriter::IntervalWriter(std::ostream& out)
+    : out(out), ring(RING_SIZE) {
+    out << "accesses,loads,stores,load_misses,store_misses,hit_rate,"
+        << "writebacks,cycles\n";
+    writer = std::thread(&IntervalWriter::run, this);
+}
+
+// destructor
+IntervalWriter::~IntervalWriter() { finish(); }
+
+/**
+ * Hands a snapshot to the writer thread without waiting. If the ring is
+ * full the snapshot is held back (in order) until a later call finds room.
+ *
+ * @param snapshot Counters after the last access of a window.
+ */
+void IntervalWriter::publish(const IntervalSnapshot& snapshot) {
+    backlog.push_back(snapshot);
+    drain_backlog();
+}
+
+/**
+ * Moves held-back snapshots into the ring while there is room.
+ */
+void IntervalWriter::drain_backlog() {
+    uint64_t filled = tail.load(std::memory_order_relaxed);
+    uint64_t limit = head.load(std::memory_order_acquire) + RING_SIZE;
+
+    while (!backlog.empty() && filled < limit) {
+        ring[filled % RING_SIZE] = backlog.front();
+        backlog.pop_front();
+        ++filled;
+    }
+    tail.store(filled, std::memory_order_release);
+}
+
+/**
+ * Hands over every held-back snapshot, then waits for the writer thread to
+ * write them all and stop.
+ */
+void IntervalWriter::finish() {
+    if (!writer.joinable()) {
+        return;
+    }
+
+    // The simulation is over, so waiting for room is fine now
+    while (!backlog.empty()) {
+        drain_backlog();
+        if (!backlog.empty()) {
+            std::this_thread::sleep_for(IDLE_SLEEP);
+        }
+    }
+    done.store(true, std::memory_order_release);
+    writer.join();
+    out.flush();
+}
+
+/**
+ * Body of the writer thread: pops snapshots as they arrive and writes one
+ * row per window until finish() is called and the ring is empty.
+ */
+void IntervalWriter::run() {
+    IntervalSnapshot previous{0, CacheStats()};
+
+    for (;;) {
+        // Read `done` first: once it is set, every snapshot is in the ring
+        bool last = done.load(std::memory_order_acquire);
+        uint64_t popped = head.load(std::memory_order_relaxed);
+        uint64_t filled = tail.load(std::memory_order_acquire);
+
+        if (popped == filled) {
+            if (last) {
+                return;
+            }
+            std::this_thread::sleep_for(IDLE_SLEEP);
+            continue;
+        }
+
+        for (; popped < filled; ++popped) {
+            const IntervalSnapshot& snapshot = ring[popped % RING_SIZE];
+            write_row(previous, snapshot);
+            previous = snapshot;
+        }
+        head.store(popped, std::memory_order_release);
+    }
+}
+
+/**
+ * Formats the window between two snapshots as one CSV row.
+ *
+ * @param from Counters at the start of the window.
+ * @param to Counters at its end.
+ */
+void IntervalWriter::write_row(const IntervalSnapshot& from,
+                               const IntervalSnapshot& to) {
+    uint64_t loads = to.stats.loads - from.stats.loads;
+    uint64_t stores = to.stats.stores - from.stats.stores;
+    uint64_t load_misses = to.stats.load_misses - from.stats.load_misses;
+    uint64_t store_misses = to.stats.store_misses - from.stats.store_misses;
+
+    uint64_t accesses = loads + stores;
+    double hit_rate =
+        accesses == 0
+            ? 0.0
+            : static_cast<double>(accesses - load_misses - store_misses) /
+                  accesses;
+
+    out << to.accesses << "," << loads << "," << stores << "," << load_misses
+        << "," << store_misses << "," << hit_rate << ","
+        << to.stats.writebacks - from.stats.writebacks << ","
+        << to.stats.cycles - from.stats.cycles << "\n";
+}
@@ -0,0 +1,86 @@
+#ifndef INTERVAL_STATS_H
+#define INTERVAL_STATS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#include "Cache.h"
+
+/**
+ * Counters of a cache after a given number of accesses.
+ */
+struct IntervalSnapshot {
+    uint64_t accesses;  // Accesses simulated so far
+    CacheStats stats;   // Cumulative counters at that point
+};
+
+/**
+ * Writes per-interval statistics on a background thread.
+ *
+ * The simulation thread publishes cumulative snapshots into a
+ * single-producer single-consumer ring; the writer thread pops them, turns
+ * them into per-window deltas and formats one CSV row per window. Neither
+ * side ever takes a lock, and publishing never waits: snapshots that find
+ * the ring full are kept on the simulation side and moved into the ring on
+ * a later publish, so the simulation is never held up by slow output.
+ */
+class IntervalWriter {
+public:
+    /**
+     * Writes the CSV header and starts the writer thread.
+     *
+     * @param out Stream the rows go to; must outlive the writer.
+     */
+    explicit IntervalWriter(std::ostream &out);
+
+    // Finishes writing if finish() was not called
+    ~IntervalWriter();
+
+    IntervalWriter(const IntervalWriter &) = delete;
+    IntervalWriter &operator=(const IntervalWriter &) = delete;
+
+    /**
+     * Hands a snapshot to the writer thread without waiting.
+     *
+     * @param snapshot Counters after the last access of a window.
+     */
+    void publish(const IntervalSnapshot &snapshot);
+
+    /**
+     * Hands over every held-back snapshot, then waits for the writer thread
+     * to write them all and stop.
+     */
+    void finish();
+
+private:
+    // Snapshots the ring holds (a power of 2)
+    static const size_t RING_SIZE = 1024;
+
+    // Moves held-back snapshots into the ring while there is room
+    void drain_backlog();
+
+    // Body of the writer thread
+    void run();
+
+    // Formats the window between two snapshots
+    void write_row(const IntervalSnapshot &from, const IntervalSnapshot &to);
+
+    std::ostream &out;
+
+    std::vector<IntervalSnapshot> ring;
+    std::atomic<uint64_t> head{0};  // Next slot the writer pops
+    std::atomic<uint64_t> tail{0};  // Next slot the simulation fills
+    std::atomic<bool> done{false};  // No snapshots follow the ring's
+
+    // Snapshots published while the ring was full (simulation thread only)
+    std::deque<IntervalSnapshot> backlog;
+
+    std::thread writer;
+};
+
+#endif  // INTERVAL_STATS_H
@@ -0,0 +1,52 @@
+#ifndef MEMORY_LEVEL_H
+#define MEMORY_LEVEL_H
+
+#include <cstdint>
+
+/**
+ * Interface of whatever sits behind a cache: another cache level or main
+ * memory. A cache calls into the level below only when it misses, writes
+ * through, or evicts, so these calls stay off the hit path.
+ *
+ * Every call returns the number of cycles the request took, which the
+ * calling cache adds to its own total.
+ */
+class MemoryLevel {
+public:
+    virtual ~MemoryLevel() = default;
+
+    /**
+     * Reads a whole block for a miss in the level above.
+     *
+     * @param address Address of the first byte of the block.
+     * @param bytes Block size of the requesting level.
+     * @param dirty Set to true if the block is handed up modified (a level
+     * that keeps no copy of the block passes its dirty data along).
+     * @return Cycles taken.
+     */
+    virtual uint64_t read_block(uint64_t address, uint32_t bytes,
+                                bool &dirty) = 0;
+
+    /**
+     * Writes a single word through from the level above.
+     *
+     * @param address Address written.
+     * @return Cycles taken.
+     */
+    virtual uint64_t write_word(uint64_t address) = 0;
+
+    /**
+     * Receives a block evicted from the level above. Dirty blocks must be
+     * written back; clean ones may be kept (e.g. by an exclusive cache) or
+     * dropped.
+     *
+     * @param address Address of the first byte of the block.
+     * @param bytes Block size of the evicting level.
+     * @param dirty True if the block was modified.
+     * @return Cycles taken.
+     */
+    virtual uint64_t evict_block(uint64_t address, uint32_t bytes,
+                                 bool dirty) = 0;
+};
+
+#endif  // MEMORY_LEVEL_H
@@ -0,0 +1,507 @@
+#include "MissProfile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "CacheConfig.h"
+#include "ErrorCodes.h"
+
+namespace {
+
+// Slots a profile starts with (a power of 2)
+const size_t INITIAL_SLOTS = 1024;
+
+typedef std::pair<uint64_t, MissCounts> Entry;
+
+// Counts of a single load or store miss
+MissCounts one_miss(bool store) {
+    MissCounts counts;
+    ++(store ? counts.stores : counts.loads);
+    return counts;
+}
+
+// Orders entries by misses, most first, then by address
+bool most_misses(const Entry& a, const Entry& b) {
+    if (a.second.total() != b.second.total()) {
+        return a.second.total() > b.second.total();
+    }
+    return a.first < b.first;
+}
+
+/**
+ * Adds the misses of one block to the regions it overlaps, or to the last
+ * entry of `counts` if it overlaps none.
+ *
+ * @param regions The regions.
+ * @param first First address of the block.
+ * @param last Last address of the block.
+ * @param misses Misses of the block.
+ * @param counts One entry per region, then one for the rest.
+ */
+void add_to_regions(const std::vector<ProfileRegion>& regions, uint64_t first,
+                    uint64_t last, const MissCounts& misses,
+                    std::vector<MissCounts>& counts) {
+    bool in_region = false;
+    for (size_t r = 0; r < regions.size(); ++r) {
+        if (first < regions[r].end && last >= regions[r].start) {
+            counts[r] += misses;
+            in_region = true;
+        }
+    }
+    if (!in_region) {
+        counts.back() += misses;
+    }
+}
+
+// Keeps the `top` entries with the most misses, in order
+void keep_top(std::vector<Entry>& entries, uint32_t top) {
+    size_t keep = std::min(entries.size(), static_cast<size_t>(top));
+    std::partial_sort(entries.begin(), entries.begin() + keep, entries.end(),
+                      most_misses);
+    entries.resize(keep);
+}
+
+// Formats an address as 0x-prefixed hex
+std::string hex(uint64_t address) {
+    char text[19];
+    snprintf(text, sizeof(text), "0x%llx",
+             static_cast<unsigned long long>(address));
+    return text;
+}
+
+// Quotes a string for JSON
+std::string json_string(const std::string& s) {
+    std::string quoted = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+            quoted += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escape[7];
+            snprintf(escape, sizeof(escape), "\\u%04x", c);
+            quoted += escape;
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "\"";
+}
+
+// Fraction of all misses, 0 if there are none
+double share(const MissCounts& counts, uint64_t total) {
+    return total == 0 ? 0.0 : static_cast<double>(counts.total()) / total;
+}
+
+// Parses a hex number with an optional 0x prefix
+bool parse_hex(std::string text, uint64_t& value) {
+    if (text.size() > 2 && text[0] == '0' && (text[1] | 0x20) == 'x') {
+        text = text.substr(2);
+    }
+    if (text.empty() || text.size() > 16 ||
+        text.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos) {
+        return false;
+    }
+    value = std::stoull(text, nullptr, 16);
+    return true;
+}
+
+/**
+ * Writes one table of counts: a CSV table headed by `key`, or a JSON array
+ * of objects whose address member is `key`.
+ */
+void write_table(std::ostream& out, bool json, const char* key,
+                 const std::vector<Entry>& entries, uint64_t total) {
+    if (json) {
+        out << "  \"" << key << "s\": [";
+        for (size_t i = 0; i < entries.size(); ++i) {
+            const MissCounts& counts = entries[i].second;
+            out << (i == 0 ? "\n" : ",\n") << "    {\"" << key << "\": \""
+                << hex(entries[i].first)
+                << "\", \"load_misses\": " << counts.loads
+                << ", \"store_misses\": " << counts.stores
+                << ", \"misses\": " << counts.total()
+                << ", \"share\": " << share(counts, total) << "}";
+        }
+        out << (entries.empty() ? "],\n" : "\n  ],\n");
+        return;
+    }
+
+    out << key << ",load_misses,store_misses,misses,share\n";
+    for (const Entry& entry : entries) {
+        out << hex(entry.first) << "," << entry.second.loads << ","
+            << entry.second.stores << "," << entry.second.total() << ","
+            << share(entry.second, total) << "\n";
+    }
+}
+
+}  // namespace
+
+/**
+ * @param block_size Block size of the profiled cache, a power of 2.
+ * @param config Page size and regions of the report.
+ */
+MissProfile::MissProfile(uint32_t block_size, const ProfileConfig& config)
+    : offset_size(static_cast<uint32_t>(log2(block_size))),
+      page_shift(static_cast<uint32_t>(log2(config.page_size)) - offset_size),
+      regions(config.regions),
+      slots(INITIAL_SLOTS),
+      slot_mask(INITIAL_SLOTS - 1),
+      hash_shift(64 - static_cast<uint32_t>(log2(INITIAL_SLOTS))),
+      untracked_regions(config.regions.size() + 1) {}
+
+/**
+ * Creates an empty profile for one set shard of the cache `whole` profiles.
+ *
+ * @param whole Profile of the whole cache.
+ * @param shard Number of the shard.
+ * @param shard_size Number of shard bits taken out of the index.
+ */
+MissProfile::MissProfile(const MissProfile& whole, uint64_t shard,
+                         uint32_t shard_size)
+    : offset_size(whole.offset_size),
+      page_shift(whole.page_shift),
+      regions(whole.regions),
+      shard(shard),
+      shard_size(shard_size),
+      slots(INITIAL_SLOTS),
+      slot_mask(INITIAL_SLOTS - 1),
+      hash_shift(64 - static_cast<uint32_t>(log2(INITIAL_SLOTS))),
+      untracked_regions(whole.regions.size() + 1) {}
+
+/**
+ * Counts every queued miss. The slots of the whole batch are prefetched
+ * first, so their cache misses overlap.
+ */
+void MissProfile::flush() {
+    // Pages tracked when the batch was queued. A direct lookup may have
+    // left the table one block over
+    const uint64_t batch_limit = tracked_limit;
+    while (used > MAX_BLOCKS) {
+        thin();
+    }
+
+    uint64_t hashes[BATCH];
+    for (size_t i = 0; i < pending_count; ++i) {
+        hashes[i] = mix((pending[i] >> 1) + 1);
+        __builtin_prefetch(&slots[hashes[i] >> hash_shift], 1);
+    }
+    for (size_t i = 0; i < pending_count; ++i) {
+        uint64_t block = pending[i] >> 1;
+        MissCounts miss = one_miss(pending[i] & 1);
+        if (tracked_limit != batch_limit && !is_tracked(block)) {
+            // The table overflowed since the block was queued
+            add_untracked(block, miss);
+            continue;
+        }
+        find(block, hashes[i]) += miss;
+        while (used > MAX_BLOCKS) {
+            thin();
+        }
+    }
+    pending_count = 0;
+}
+
+/**
+ * Adds misses of a block outside the tracked pages to the untracked counts.
+ *
+ * @param block Block number.
+ * @param counts Misses of the block.
+ */
+void MissProfile::add_untracked(uint64_t block, const MissCounts& counts) {
+    untracked += counts;
+    if (!regions.empty()) {
+        uint64_t first = block << offset_size;
+        add_to_regions(regions, first, first + ((1ull << offset_size) - 1),
+                       counts, untracked_regions);
+    }
+}
+
+/**
+ * Adds one miss of a block outside the tracked pages to the untracked
+ * counts of its regions.
+ *
+ * @param block Block number.
+ * @param store True for a store miss.
+ */
+void MissProfile::add_untracked_regions(uint64_t block, bool store) {
+    uint64_t first = block << offset_size;
+    add_to_regions(regions, first, first + ((1ull << offset_size) - 1),
+                   one_miss(store), untracked_regions);
+}
+
+/**
+ * Adds a block to the table, growing it first if it would become more than
+ * half full.
+ *
+ * @param slot The empty slot find() stopped at.
+ * @param key Block number + 1.
+ * @return The block's (zero) counts.
+ */
+MissCounts& MissProfile::insert(size_t slot, uint64_t key) {
+    if ((used + 1) * 2 > slots.size()) {
+        grow();
+        slot = bucket(key);
+        while (slots[slot].key != 0) {
+            slot = (slot + 1) & slot_mask;
+        }
+    }
+    ++used;
+    slots[slot].key = key;
+    return slots[slot].counts;
+}
+
+/**
+ * Doubles the table and reinserts every block.
+ */
+void MissProfile::grow() {
+    std::vector<Slot> old_slots(slots.size() * 2);
+    old_slots.swap(slots);
+    slot_mask = slots.size() - 1;
+    --hash_shift;
+
+    for (const Slot& old : old_slots) {
+        if (old.key != 0) {
+            size_t slot = bucket(old.key);
+            while (slots[slot].key != 0) {
+                slot = (slot + 1) & slot_mask;
+            }
+            slots[slot] = old;
+        }
+    }
+}
+
+/**
+ * Stops tracking half of the tracked pages. Their blocks leave the table,
+ * and their misses become untracked.
+ */
+void MissProfile::thin() {
+    tracked_limit >>= 1;
+
+    std::vector<Slot> old_slots(slots.size());
+    old_slots.swap(slots);
+    used = 0;
+    for (const Slot& old : old_slots) {
+        if (old.key == 0) {
+            continue;
+        }
+        if (!is_tracked(old.key - 1)) {
+            add_untracked(old.key - 1, old.counts);
+            continue;
+        }
+
+        size_t slot = bucket(old.key);
+        while (slots[slot].key != 0) {
+            slot = (slot + 1) & slot_mask;
+        }
+        slots[slot] = old;
+        ++used;
+    }
+}
+
+/**
+ * Adds the profile of one set shard of the same cache. Both are brought to
+ * the smaller set of tracked pages first, which is the one the whole cache
+ * would have reached.
+ *
+ * @param other Profile of the shard.
+ */
+void MissProfile::merge(MissProfile& other) {
+    other.flush();
+    flush();
+    while (tracked_limit > other.tracked_limit) {
+        thin();
+    }
+    untracked += other.untracked;
+    for (size_t r = 0; r < untracked_regions.size(); ++r) {
+        untracked_regions[r] += other.untracked_regions[r];
+    }
+
+    for (const Slot& slot : other.slots) {
+        if (slot.key == 0) {
+            continue;
+        }
+        uint64_t block = slot.key - 1;
+        if (!is_tracked(block)) {
+            add_untracked(block, slot.counts);
+            continue;
+        }
+        find(block) += slot.counts;
+        while (used > MAX_BLOCKS) {
+            thin();
+        }
+    }
+}
+
+/**
+ * @return Address of every block of a tracked page that missed, with its
+ * counts
+ */
+std::vector<std::pair<uint64_t, MissCounts>> MissProfile::get_blocks() {
+    flush();
+
+    std::vector<Entry> blocks;
+    blocks.reserve(used);
+    for (const Slot& slot : slots) {
+        if (slot.key != 0) {
+            blocks.emplace_back((slot.key - 1) << offset_size, slot.counts);
+        }
+    }
+    return blocks;
+}
+
+/**
+ * Parses a profile specification, `<top>[:<page_size>]`.
+ *
+ * @param spec The specification.
+ * @param config Updated with the parsed values on success.
+ * @return 0 on success, otherwise the csim exit code for the problem.
+ */
+int parse_profile_config(const std::string& spec, ProfileConfig& config) {
+    std::vector<std::string> fields = split(spec, ':');
+    if (fields.empty() || fields.size() > 2) {
+        std::cerr << "Error: Profile must be '<top>[:<page_size>]'."
+                  << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+
+    int values[2] = {0, static_cast<int>(config.page_size)};
+    for (size_t i = 0; i < fields.size(); ++i) {
+        try {
+            values[i] = std::stoi(fields[i]);
+        } catch (const std::exception& e) {
+            values[i] = -1;
+        }
+    }
+    if (values[0] < 0) {
+        std::cerr << "Error: Profile top count must be a non-negative "
+                     "integer."
+                  << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+    if (values[1] <= 0 || !is_power_of_2(static_cast<uint32_t>(values[1]))) {
+        std::cerr << "Error: Page size must be a positive power of 2."
+                  << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+
+    config.top = static_cast<uint32_t>(values[0]);
+    config.page_size = static_cast<uint64_t>(values[1]);
+    return 0;
+}
+
+/**
+ * Parses a region, `<name>:<hex start>:<hex end>`.
+ *
+ * @param spec The specification.
+ * @param config Gains the region on success.
+ * @return 0 on success, otherwise the csim exit code for the problem.
+ */
+int parse_profile_region(const std::string& spec, ProfileConfig& config) {
+    std::vector<std::string> fields = split(spec, ':');
+    ProfileRegion region;
+    if (fields.size() != 3 || fields[0].empty() ||
+        !parse_hex(fields[1], region.start) ||
+        !parse_hex(fields[2], region.end)) {
+        std::cerr << "Error: Region must be '<name>:<hex start>:<hex end>'."
+                  << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+    if (region.end <= region.start) {
+        std::cerr << "Error: Region '" << fields[0]
+                  << "' must end after it starts." << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+
+    region.name = fields[0];
+    config.regions.push_back(region);
+    return 0;
+}
+
+/**
+ * Writes the report of a profile.
+ *
+ * @param profile The recorded misses.
+ * @param config What to report.
+ * @param out Stream written to.
+ */
+void write_profile(MissProfile& profile, const ProfileConfig& config,
+                   std::ostream& out) {
+    std::vector<Entry> blocks = profile.get_blocks();
+    const uint64_t block_size = profile.get_block_size();
+
+    // Sum the blocks into pages and regions, which already hold the
+    // misses of untracked pages
+    const MissCounts untracked = profile.get_untracked();
+    uint64_t total = untracked.total();
+    std::unordered_map<uint64_t, MissCounts> page_counts;
+    std::vector<MissCounts> region_counts = profile.get_untracked_regions();
+    for (const Entry& block : blocks) {
+        total += block.second.total();
+        page_counts[block.first & ~(config.page_size - 1)] += block.second;
+        add_to_regions(config.regions, block.first,
+                       block.first + (block_size - 1), block.second,
+                       region_counts);
+    }
+    const MissCounts& outside = region_counts.back();
+    std::vector<Entry> pages(page_counts.begin(), page_counts.end());
+
+    keep_top(blocks, config.top);
+    keep_top(pages, config.top);
+
+    if (config.json) {
+        out << "{\n  \"misses\": " << total << ",\n"
+            << "  \"untracked_misses\": " << untracked.total() << ",\n";
+        write_table(out, true, "block", blocks, total);
+        write_table(out, true, "page", pages, total);
+        out << "  \"regions\": [";
+        for (size_t r = 0; r <= config.regions.size(); ++r) {
+            if (r == config.regions.size() && config.regions.empty()) {
+                break;
+            }
+            bool other = (r == config.regions.size());
+            const MissCounts& counts = other ? outside : region_counts[r];
+            out << (r == 0 ? "\n" : ",\n") << "    {\"region\": "
+                << (other ? "null" : json_string(config.regions[r].name));
+            if (!other) {
+                out << ", \"start\": \"" << hex(config.regions[r].start)
+                    << "\", \"end\": \"" << hex(config.regions[r].end) << "\"";
+            }
+            out << ", \"load_misses\": " << counts.loads
+                << ", \"store_misses\": " << counts.stores
+                << ", \"misses\": " << counts.total()
+                << ", \"share\": " << share(counts, total) << "}";
+        }
+        out << (config.regions.empty() ? "]\n}\n" : "\n  ]\n}\n");
+        return;
+    }
+
+    write_table(out, false, "block", blocks, total);
+    out << "\n";
+    write_table(out, false, "page", pages, total);
+    if (!config.regions.empty()) {
+        // Misses outside every region make up the last row
+        out << "\nregion,start,end,load_misses,store_misses,misses,share\n";
+        for (size_t r = 0; r < config.regions.size(); ++r) {
+            const ProfileRegion& region = config.regions[r];
+            const MissCounts& counts = region_counts[r];
+            out << region.name << "," << hex(region.start) << ","
+                << hex(region.end) << "," << counts.loads << ","
+                << counts.stores << "," << counts.total() << ","
+                << share(counts, total) << "\n";
+        }
+        out << "(other),,," << outside.loads << "," << outside.stores << ","
+            << outside.total() << "," << share(outside, total) << "\n";
+    }
+    if (untracked.total() != 0) {
+        // Misses of pages the table had no room for
+        out << "\nuntracked_misses\n" << untracked.total() << "\n";
+    }
+}
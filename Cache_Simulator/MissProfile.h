@@ -0,0 +1,283 @@
+#ifndef MISS_PROFILE_H
+#define MISS_PROFILE_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Demand misses charged to one block, page or region.
+ */
+struct MissCounts {
+    uint64_t loads = 0;   // Load (and instruction fetch) misses
+    uint64_t stores = 0;  // Store misses
+
+    uint64_t total() const { return loads + stores; }
+
+    MissCounts &operator+=(const MissCounts &other) {
+        loads += other.loads;
+        stores += other.stores;
+        return *this;
+    }
+};
+
+/**
+ * A named address range misses are summed over, [start, end).
+ */
+struct ProfileRegion {
+    std::string name;
+    uint64_t start;
+    uint64_t end;
+};
+
+/**
+ * What a miss profile reports and where.
+ */
+struct ProfileConfig {
+    uint32_t top = 10;          // Blocks and pages listed
+    uint64_t page_size = 4096;  // Bytes per page, a power of 2
+    std::vector<ProfileRegion> regions;
+    std::string output = "-";   // "-" for standard output
+    bool json = false;          // JSON instead of CSV
+};
+
+/**
+ * Per-block miss counts of one cache, recorded on its miss path.
+ *
+ * Only blocks are counted while simulating; pages and regions are summed
+ * from the block counts when the profile is reported, so the per-miss cost
+ * is at most a single lookup in a flat open-addressed table. Lookups in a
+ * table larger than the host's L2 cache are batched and prefetched.
+ *
+ * The table holds at most MAX_BLOCKS blocks. A page is tracked if a hash
+ * of its number is at most tracked_limit: every page at first, and half as
+ * many each time the table overflows. The blocks of a page that
+ * stops being tracked leave the table, and its misses so far and from then
+ * on only add to the untracked counts. Every count is exact, since a
+ * tracked page has been tracked from the start. The level reached depends
+ * only on which blocks missed, not on the order of the misses, so the
+ * profile of a cache split into set shards is the same as that of the
+ * whole cache.
+ */
+class MissProfile {
+public:
+    /**
+     * @param block_size Block size of the profiled cache, a power of 2.
+     * @param config Page size and regions of the report.
+     */
+    MissProfile(uint32_t block_size, const ProfileConfig &config);
+
+    /**
+     * Creates an empty profile for one set shard (see simulate_set_shards)
+     * of the cache `whole` profiles. The shard's cache sees shard-local
+     * addresses, which are turned back into addresses of the whole cache.
+     *
+     * @param whole Profile of the whole cache.
+     * @param shard Number of the shard.
+     * @param shard_size Number of shard bits taken out of the index.
+     */
+    MissProfile(const MissProfile &whole, uint64_t shard, uint32_t shard_size);
+
+    /**
+     * Counts a demand miss. Once the table outgrows the host's caches,
+     * misses in tracked pages are queued and counted a batch at a time, so
+     * the table lookups of a batch overlap instead of each one stalling the
+     * simulation.
+     *
+     * @param address Address that missed.
+     * @param store True for a store miss.
+     */
+    void record(uint64_t address, bool store) {
+        // Block number in the whole cache
+        uint64_t block = (address >> offset_size << shard_size) | shard;
+        if (!is_tracked(block)) {
+            ++(store ? untracked.stores : untracked.loads);
+            if (!regions.empty()) {
+                add_untracked_regions(block, store);
+            }
+            return;
+        }
+        if (slots.size() <= DIRECT_SLOTS) {
+            MissCounts &counts = find(block);
+            ++(store ? counts.stores : counts.loads);
+            return;
+        }
+        pending[pending_count++] = block << 1 | store;
+        if (pending_count == BATCH) {
+            flush();
+        }
+    }
+
+    /**
+     * Adds the profile of one set shard of the same cache.
+     *
+     * @param other Profile of the shard.
+     */
+    void merge(MissProfile &other);
+
+    /**
+     * @return Address of every block of a tracked page that missed, with
+     * its counts
+     */
+    std::vector<std::pair<uint64_t, MissCounts>> get_blocks();
+
+    /**
+     * @return Misses in pages that are not tracked
+     */
+    const MissCounts &get_untracked() {
+        flush();
+        return untracked;
+    }
+
+    /**
+     * @return Misses in pages that are not tracked, summed over each region
+     * of the report, then over those outside every region
+     */
+    const std::vector<MissCounts> &get_untracked_regions() {
+        flush();
+        return untracked_regions;
+    }
+
+    /**
+     * @return Number of bytes per block
+     */
+    uint32_t get_block_size() const { return uint32_t{1} << offset_size; }
+
+private:
+    // Misses queued before they are counted
+    static const size_t BATCH = 32;
+
+    // Blocks the table holds at most: at most 4 * MAX_BLOCKS slots of 24
+    // bytes
+    static constexpr size_t MAX_BLOCKS = 1 << 15;
+
+    // Slots of a table small enough to stay in the host's L2 cache, where
+    // batching costs more than it saves
+    static constexpr size_t DIRECT_SLOTS = 1 << 16;
+
+    /**
+     * A table slot: a block and its counts, so a lookup touches one place.
+     */
+    struct Slot {
+        uint64_t key = 0;  // Block number + 1, 0 if empty
+        MissCounts counts;
+    };
+
+    // Returns the counts of a block number, adding it if needed
+    MissCounts &find(uint64_t block) { return find(block, mix(block + 1)); }
+
+    // The same, given the mix of the block number + 1
+    MissCounts &find(uint64_t block, uint64_t hash) {
+        uint64_t key = block + 1;
+        for (size_t slot = static_cast<size_t>(hash >> hash_shift);;
+             slot = (slot + 1) & slot_mask) {
+            if (slots[slot].key == key) {
+                return slots[slot].counts;
+            }
+            if (slots[slot].key == 0) {
+                return insert(slot, key);
+            }
+        }
+    }
+
+    // Counts every queued miss
+    void flush();
+
+    // Tracks half as many pages, moving the blocks of the others out of
+    // the table
+    void thin();
+
+    // True if a block number is in a tracked page. Page numbers are below
+    // 2^64 - 1, so the hash, a product with an odd number, is never 0 and
+    // no page stays tracked once the limit reaches 0
+    bool is_tracked(uint64_t block) const {
+        return ((block >> page_shift) + 1) * 0x9E3779B97F4A7C15ull <=
+               tracked_limit;
+    }
+
+    // Adds misses of an untracked block to the untracked counts
+    void add_untracked(uint64_t block, const MissCounts &counts);
+
+    // Adds one miss of an untracked block to the counts of its regions
+    void add_untracked_regions(uint64_t block, bool store);
+
+    // Adds a key in an empty slot found by find(), returning its counts
+    MissCounts &insert(size_t slot, uint64_t key);
+
+    // Spreads the bits of a key. Block numbers of one data structure are
+    // close together, so their bits are mixed before taking some of them
+    static uint64_t mix(uint64_t key) {
+        key ^= key >> 33;
+        key *= 0xFF51AFD7ED558CCDull;
+        key ^= key >> 33;
+        return key;
+    }
+
+    // Home slot of a key: the top bits of its mix
+    size_t bucket(uint64_t key) const {
+        return static_cast<size_t>(mix(key) >> hash_shift);
+    }
+
+    // Doubles the table, keeping it at most half full
+    void grow();
+
+    const uint32_t offset_size;  // Number of block offset bits
+    uint32_t page_shift;         // Number of block number bits in a page
+    std::vector<ProfileRegion> regions;
+
+    // Set shard profiled; a whole cache is shard 0 of 1
+    uint64_t shard = 0;
+    uint32_t shard_size = 0;
+
+    std::vector<Slot> slots;
+    size_t slot_mask;
+    uint32_t hash_shift;
+    size_t used = 0;  // Slots holding a block
+
+    // Queued misses: block number in the whole cache << 1, plus 1 for a
+    // store
+    uint64_t pending[BATCH];
+    size_t pending_count = 0;
+
+    // Pages tracked: those whose hashed number is at most this
+    uint64_t tracked_limit = UINT64_MAX;
+
+    MissCounts untracked;
+    std::vector<MissCounts> untracked_regions;  // Regions, then outside
+};
+
+/**
+ * Parses a profile specification, `<top>[:<page_size>]`, into `config`.
+ * Problems are reported on standard error.
+ *
+ * @param spec The specification.
+ * @param config Updated with the parsed values on success.
+ * @return 0 on success, otherwise the csim exit code for the problem.
+ */
+int parse_profile_config(const std::string &spec, ProfileConfig &config);
+
+/**
+ * Parses a region, `<name>:<hex start>:<hex end>` (end exclusive), and adds
+ * it to `config`. Problems are reported on standard error.
+ *
+ * @param spec The specification.
+ * @param config Gains the region on success.
+ * @return 0 on success, otherwise the csim exit code for the problem.
+ */
+int parse_profile_region(const std::string &spec, ProfileConfig &config);
+
+/**
+ * Writes the report of a profile: the blocks and pages with the most
+ * misses, and the misses of every region (a block counts toward every
+ * region it overlaps), as CSV tables or one JSON object.
+ *
+ * @param profile The recorded misses.
+ * @param config What to report.
+ * @param out Stream written to.
+ */
+void write_profile(MissProfile &profile, const ProfileConfig &config,
+                   std::ostream &out);
+
+#endif  // MISS_PROFILE_H
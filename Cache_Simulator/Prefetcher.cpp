@@ -0,0 +1,267 @@
+#include "Prefetcher.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "CacheConfig.h"
+#include "ErrorCodes.h"
+
+namespace {
+
+// Number of blocks in a 64-bit address space with the given offset bits
+uint64_t block_count(uint32_t offset_size) {
+    return uint64_t{1} << (64 - offset_size);
+}
+
+}  // namespace
+
+/**
+ * Parses a prefetcher specification.
+ *
+ * @param spec The specification.
+ * @param config Filled with the parsed configuration on success.
+ * @return 0 on success, otherwise the csim exit code for the problem.
+ */
+int parse_prefetcher_config(const std::string& spec,
+                            PrefetcherConfig& config) {
+    std::vector<std::string> fields = split(spec, ':');
+    std::string kind = fields.empty() ? "" : to_lower(fields[0]);
+
+    size_t max_fields;
+    if (kind == "nextline") {
+        config = {PrefetcherConfig::NEXT_LINE, 1, 0};
+        max_fields = 2;
+    } else if (kind == "stride") {
+        config = {PrefetcherConfig::STRIDE, 2, 0};
+        max_fields = 2;
+    } else if (kind == "stream") {
+        config = {PrefetcherConfig::STREAM, 4, 4};
+        max_fields = 3;
+    } else {
+        std::cerr << "Error: Prefetcher must be 'nextline[:<lines>]', "
+                     "'stride[:<degree>]' or "
+                     "'stream[:<streams>[:<depth>]]'."
+                  << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+
+    if (fields.size() > max_fields) {
+        std::cerr << "Error: Too many parameters in prefetcher '" << spec
+                  << "'." << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+
+    // Parameters in order: lines / degree, or streams then depth
+    std::vector<uint32_t*> values;
+    if (config.kind == PrefetcherConfig::STREAM) {
+        values = {&config.streams, &config.degree};
+    } else {
+        values = {&config.degree};
+    }
+    for (size_t i = 1; i < fields.size(); ++i) {
+        int value;
+        try {
+            value = std::stoi(fields[i]);
+        } catch (const std::exception& e) {
+            value = 0;
+        }
+        if (value <= 0) {
+            std::cerr << "Error: Prefetcher parameters must be positive "
+                         "integers."
+                      << std::endl;
+            return INVALID_COMMAND_LINE;
+        }
+        *values[i - 1] = static_cast<uint32_t>(value);
+    }
+    return 0;
+}
+
+/**
+ * Creates a prefetcher.
+ *
+ * @param config The prefetcher to create.
+ * @param block_size Block size of the cache it feeds, a power of 2.
+ * @return The prefetcher.
+ */
+std::unique_ptr<Prefetcher> make_prefetcher(const PrefetcherConfig& config,
+                                            uint32_t block_size) {
+    switch (config.kind) {
+        case PrefetcherConfig::NEXT_LINE:
+            return std::make_unique<NextLinePrefetcher>(config.degree,
+                                                        block_size);
+        case PrefetcherConfig::STRIDE:
+            return std::make_unique<StridePrefetcher>(config.degree,
+                                                      block_size);
+        case PrefetcherConfig::STREAM:
+            return std::make_unique<StreamPrefetcher>(
+                config.streams, config.degree, block_size);
+    }
+    return nullptr;
+}
+
+/**
+ * @param lines Number of following blocks to fetch.
+ * @param block_size Block size of the cache, a power of 2.
+ */
+NextLinePrefetcher::NextLinePrefetcher(uint32_t lines, uint32_t block_size)
+    : lines(lines), offset_size(log2(block_size)) {}
+
+/**
+ * Fetches the blocks after a missed or newly used prefetched block.
+ *
+ * @param address Address accessed.
+ * @param access What the access found.
+ * @param prefetches Addresses to prefetch are appended here.
+ */
+void NextLinePrefetcher::observe(uint64_t address, Access access,
+                                 std::vector<uint64_t>& prefetches) {
+    if (access == HIT) {
+        return;
+    }
+
+    uint64_t block = address >> offset_size;
+    uint64_t end = std::min(block + lines + 1, block_count(offset_size));
+    for (uint64_t next = block + 1; next < end; ++next) {
+        prefetches.push_back(next << offset_size);
+    }
+}
+
+/**
+ * @param degree Number of strides to fetch ahead.
+ * @param block_size Block size of the cache, a power of 2.
+ */
+StridePrefetcher::StridePrefetcher(uint32_t degree, uint32_t block_size)
+    : degree(degree),
+      offset_size(log2(block_size)),
+      // 4 KiB pages, or 16 blocks for very large blocks
+      region_size(std::max<uint32_t>(12, offset_size + 4)),
+      table(TABLE_SIZE) {}
+
+/**
+ * Trains the region's stride on every access to a new block and, once the
+ * stride has repeated, fetches the next `degree` blocks along it.
+ *
+ * @param address Address accessed.
+ * @param access What the access found (unused: every access trains).
+ * @param prefetches Addresses to prefetch are appended here.
+ */
+void StridePrefetcher::observe(uint64_t address, Access /* access */,
+                               std::vector<uint64_t>& prefetches) {
+    uint64_t block = address >> offset_size;
+    uint64_t region = address >> region_size;
+    Region& entry = table[region % TABLE_SIZE];
+
+    if (!entry.valid || entry.region != region) {
+        // Start tracking the region
+        entry.valid = true;
+        entry.region = region;
+        entry.last_block = block;
+        entry.stride = 0;
+        entry.confidence = 0;
+        return;
+    }
+
+    int64_t stride = static_cast<int64_t>(block - entry.last_block);
+    if (stride == 0) {
+        return;  // Same block again
+    }
+    if (stride == entry.stride) {
+        if (entry.confidence < MAX_CONFIDENCE) {
+            ++entry.confidence;
+        }
+    } else {
+        entry.stride = stride;
+        entry.confidence = 0;
+    }
+    entry.last_block = block;
+
+    if (entry.confidence == 0) {
+        return;
+    }
+    // Blocks stay below 2^59 and strides within a region, so stepping
+    // never overflows
+    const int64_t blocks = static_cast<int64_t>(block_count(offset_size));
+    int64_t next = static_cast<int64_t>(block);
+    for (uint32_t k = 1; k <= degree; ++k) {
+        next += stride;
+        if (next < 0 || next >= blocks) {
+            break;
+        }
+        prefetches.push_back(static_cast<uint64_t>(next) << offset_size);
+    }
+}
+
+/**
+ * @param streams Number of streams tracked at once.
+ * @param depth Number of blocks kept fetched ahead of a stream.
+ * @param block_size Block size of the cache, a power of 2.
+ */
+StreamPrefetcher::StreamPrefetcher(uint32_t streams, uint32_t depth,
+                                   uint32_t block_size)
+    : depth(depth), offset_size(log2(block_size)), streams(streams) {}
+
+/**
+ * Advances the stream an access falls into, or starts a new stream on a
+ * miss outside every stream. Plain hits outside a stream are ignored.
+ *
+ * @param address Address accessed.
+ * @param access What the access found.
+ * @param prefetches Addresses to prefetch are appended here.
+ */
+void StreamPrefetcher::observe(uint64_t address, Access access,
+                               std::vector<uint64_t>& prefetches) {
+    ++accesses;
+    uint64_t block = address >> offset_size;
+
+    for (Stream& stream : streams) {
+        if (stream.valid && block >= stream.next && block < stream.end) {
+            stream.next = block + 1;
+            stream.last_use = accesses;
+            fetch(stream.end, block + depth + 1, prefetches);
+            stream.end = std::max(stream.end, block + depth + 1);
+            return;
+        }
+    }
+
+    if (access != MISS) {
+        return;
+    }
+
+    // Replace an unused or the least recently used stream
+    Stream* victim = &streams[0];
+    for (Stream& stream : streams) {
+        if (!stream.valid) {
+            victim = &stream;
+            break;
+        }
+        if (stream.last_use < victim->last_use) {
+            victim = &stream;
+        }
+    }
+    victim->valid = true;
+    victim->next = block + 1;
+    victim->end = block + depth + 1;
+    victim->last_use = accesses;
+    fetch(block + 1, victim->end, prefetches);
+}
+
+/**
+ * Appends the addresses of blocks [from, to) to the prefetch list.
+ *
+ * @param from First block.
+ * @param to Block after the last one.
+ * @param prefetches Addresses to prefetch are appended here.
+ */
+void StreamPrefetcher::fetch(uint64_t from, uint64_t to,
+                             std::vector<uint64_t>& prefetches) {
+    to = std::min(to, block_count(offset_size));
+    for (uint64_t block = from; block < to; ++block) {
+        prefetches.push_back(block << offset_size);
+    }
+}
@@ -0,0 +1,183 @@
+#ifndef PREFETCHER_H
+#define PREFETCHER_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Counters reported for a cache with a prefetcher.
+ */
+struct PrefetchStats {
+    uint64_t issued = 0;     // Blocks fetched from below by the prefetcher
+    uint64_t useful = 0;     // Prefetched blocks later used by a demand access
+    uint64_t late = 0;       // Useful prefetches still in flight when used
+    uint64_t unused = 0;     // Prefetched blocks evicted without being used
+    uint64_t pollution = 0;  // Demand misses on blocks a prefetch evicted
+};
+
+/**
+ * Interface of a hardware prefetcher sitting in front of a cache. The cache
+ * shows it every demand access, and it answers with the blocks to fetch
+ * ahead of time. The cache drops candidates it already holds and fills the
+ * rest through its normal allocation and eviction path.
+ */
+class Prefetcher {
+public:
+    /**
+     * What a demand access found in the cache.
+     */
+    enum Access {
+        MISS,
+        HIT,
+        PREFETCH_HIT  // First use of a prefetched block
+    };
+
+    virtual ~Prefetcher() = default;
+
+    /**
+     * Observes a demand access.
+     *
+     * @param address Address accessed.
+     * @param access What the access found.
+     * @param prefetches Addresses of the blocks to prefetch are appended
+     * here.
+     */
+    virtual void observe(uint64_t address, Access access,
+                         std::vector<uint64_t> &prefetches) = 0;
+};
+
+/**
+ * A parsed prefetcher specification.
+ */
+struct PrefetcherConfig {
+    enum Kind { NEXT_LINE, STRIDE, STREAM } kind;
+    uint32_t degree;   // Blocks fetched ahead of an access
+    uint32_t streams;  // Streams tracked at once (stream prefetcher only)
+};
+
+/**
+ * Parses a prefetcher specification: `nextline[:<lines>]`,
+ * `stride[:<degree>]` or `stream[:<streams>[:<depth>]]`.
+ * Problems are reported on standard error.
+ *
+ * @param spec The specification.
+ * @param config Filled with the parsed configuration on success.
+ * @return 0 on success, otherwise the csim exit code for the problem.
+ */
+int parse_prefetcher_config(const std::string &spec,
+                            PrefetcherConfig &config);
+
+/**
+ * Creates a prefetcher.
+ *
+ * @param config The prefetcher to create.
+ * @param block_size Block size of the cache it feeds, a power of 2.
+ * @return The prefetcher.
+ */
+std::unique_ptr<Prefetcher> make_prefetcher(const PrefetcherConfig &config,
+                                            uint32_t block_size);
+
+/**
+ * Next-N-line prefetcher: a miss, or the first use of a prefetched block,
+ * fetches the N blocks that follow it (tagged sequential prefetching).
+ */
+class NextLinePrefetcher : public Prefetcher {
+public:
+    /**
+     * @param lines Number of following blocks to fetch.
+     * @param block_size Block size of the cache, a power of 2.
+     */
+    NextLinePrefetcher(uint32_t lines, uint32_t block_size);
+
+    void observe(uint64_t address, Access access,
+                 std::vector<uint64_t> &prefetches) override;
+
+private:
+    const uint32_t lines;
+    const uint32_t offset_size;  // Number of block offset bits
+};
+
+/**
+ * PC-less stride prefetcher. Memory is cut into regions, and a small table
+ * remembers the last block and stride seen in recently used regions. Once
+ * the same non-zero stride repeats within a region, each access fetches the
+ * next `degree` blocks along it.
+ */
+class StridePrefetcher : public Prefetcher {
+public:
+    /**
+     * @param degree Number of strides to fetch ahead.
+     * @param block_size Block size of the cache, a power of 2.
+     */
+    StridePrefetcher(uint32_t degree, uint32_t block_size);
+
+    void observe(uint64_t address, Access access,
+                 std::vector<uint64_t> &prefetches) override;
+
+private:
+    /**
+     * Stride history of one region.
+     */
+    struct Region {
+        bool valid = false;
+        uint64_t region = 0;      // Region number
+        uint64_t last_block = 0;  // Block of the last access to it
+        int64_t stride = 0;       // Last stride, in blocks
+        uint32_t confidence = 0;  // Times in a row the stride repeated
+    };
+
+    // Regions tracked at once (direct mapped)
+    static const uint32_t TABLE_SIZE = 64;
+
+    // Saturation point of a region's confidence
+    static const uint32_t MAX_CONFIDENCE = 3;
+
+    const uint32_t degree;
+    const uint32_t offset_size;  // Number of block offset bits
+    const uint32_t region_size;  // Number of region offset bits
+    std::vector<Region> table;
+};
+
+/**
+ * Stream prefetcher modelled on stream buffers. A miss that belongs to no
+ * tracked stream starts a new one (replacing the least recently used) and
+ * fetches the `depth` blocks after it; a demand access inside a stream's
+ * window slides the stream forward, keeping `depth` blocks fetched ahead
+ * of the access.
+ */
+class StreamPrefetcher : public Prefetcher {
+public:
+    /**
+     * @param streams Number of streams tracked at once.
+     * @param depth Number of blocks kept fetched ahead of a stream.
+     * @param block_size Block size of the cache, a power of 2.
+     */
+    StreamPrefetcher(uint32_t streams, uint32_t depth, uint32_t block_size);
+
+    void observe(uint64_t address, Access access,
+                 std::vector<uint64_t> &prefetches) override;
+
+private:
+    /**
+     * One tracked stream. Blocks [next, end) have been prefetched.
+     */
+    struct Stream {
+        bool valid = false;
+        uint64_t next = 0;      // Next block the stream expects
+        uint64_t end = 0;       // First block not yet prefetched
+        uint64_t last_use = 0;  // Access count at the stream's last use
+    };
+
+    // Appends blocks [from, to) to `prefetches`, stopping at the top of
+    // the address space
+    void fetch(uint64_t from, uint64_t to, std::vector<uint64_t> &prefetches);
+
+    const uint32_t depth;
+    const uint32_t offset_size;  // Number of block offset bits
+    std::vector<Stream> streams;
+    uint64_t accesses = 0;
+};
+
+#endif  // PREFETCHER_H
@@ -0,0 +1,30 @@
+#include "ReplacementPolicy.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Builds the next-use index of a trace for a given block size. The trace is
+ * walked backwards, remembering the position of the next access to every
+ * block seen so far.
+ *
+ * @param records The whole trace.
+ * @param block_size Block size of the cache, a power of 2.
+ * @return The next-use index.
+ */
+std::vector<uint32_t> build_next_use(const std::vector<TraceRecord>& records,
+                                     uint32_t block_size) {
+    std::vector<uint32_t> next_use(records.size());
+    std::unordered_map<uint64_t, uint32_t> next_access;
+    const uint64_t block_mask = ~uint64_t{block_size - 1};
+
+    for (size_t i = records.size(); i-- > 0;) {
+        uint64_t block = records[i].address & block_mask;
+
+        auto found = next_access.find(block);
+        next_use[i] = found == next_access.end() ? NEVER_USED : found->second;
+        next_access[block] = static_cast<uint32_t>(i);
+    }
+    return next_use;
+}
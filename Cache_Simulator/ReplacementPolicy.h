@@ -0,0 +1,458 @@
+#ifndef REPLACEMENT_POLICY_H
+#define REPLACEMENT_POLICY_H
+
+#include <cstdint>
+#include <vector>
+
+#include "TraceReader.h"
+
+/**
+ * Replacement policies, plugged into PolicyCache as a template parameter so
+ * every hook is inlined into the cache's access path.
+ *
+ * A policy keeps its per-set state in `state_words(ways)` words that the
+ * cache stores next to each set's tags, and gets a pointer to them (`state`)
+ * on every call. The cache fills the ways of a set front to back, so ways
+ * [0, used) always hold blocks. Hooks:
+ *
+ *   begin_access()                   Called once per load and store.
+ *   on_hit(state, ways, way)         A filled way was accessed.
+ *   on_insert(state, ways, used, way) A free way was filled; `used` counts
+ *                                    it.
+ *   victim(state, ways)              Picks the way to evict from a full set.
+ *   on_replace(state, ways, way)     The victim now holds the new block.
+ *   on_remove(state, ways, way, last) A way was emptied, and the set's last
+ *                                    filled way (if different) moved into
+ *                                    it.
+ *   valid_state(state, ways, used)   True if state read from a checkpoint
+ *                                    is one the hooks can work on.
+ */
+
+/**
+ * LRU (PROMOTE = true) or FIFO (PROMOTE = false). The filled ways of a set
+ * are threaded into an intrusive doubly linked list ordered from newest
+ * (head) to oldest (tail): by last access for LRU and by load time for FIFO.
+ * The victim is always the tail, so every hook is O(1).
+ *
+ * State: [prev: ways][next: ways][head][tail], where prev/next hold `ways`
+ * at the ends of the list.
+ */
+template <bool PROMOTE>
+class RecencyPolicy {
+public:
+    static uint32_t state_words(uint32_t ways) { return 2 * ways + 2; }
+
+    void begin_access() {}
+
+    void on_hit(uint32_t *state, uint32_t ways, uint32_t way) {
+        if (PROMOTE && head(state, ways) != way) {
+            unlink(state, ways, way);
+            push_front(state, ways, way, 2);
+        }
+    }
+
+    void on_insert(uint32_t *state, uint32_t ways, uint32_t used,
+                   uint32_t way) {
+        push_front(state, ways, way, used);
+    }
+
+    uint32_t victim(uint32_t *state, uint32_t ways) {
+        return tail(state, ways);
+    }
+
+    void on_replace(uint32_t *state, uint32_t ways, uint32_t way) {
+        // The victim was the oldest way and is now the newest
+        if (head(state, ways) != way) {
+            unlink(state, ways, way);
+            push_front(state, ways, way, 2);
+        }
+    }
+
+    void on_remove(uint32_t *state, uint32_t ways, uint32_t way,
+                   uint32_t last) {
+        uint32_t *prev = state;
+        uint32_t *next = state + ways;
+
+        unlink(state, ways, way);
+        if (way == last) {
+            return;
+        }
+
+        // Give the moved way its old place in the list
+        prev[way] = prev[last];
+        next[way] = next[last];
+        if (prev[way] == ways) {
+            head(state, ways) = way;
+        } else {
+            next[prev[way]] = way;
+        }
+        if (next[way] == ways) {
+            tail(state, ways) = way;
+        } else {
+            prev[next[way]] = way;
+        }
+    }
+
+    // The list must thread every filled way exactly once. A way seen twice
+    // would need two different predecessors, so checking the links as it
+    // is walked is enough
+    static bool valid_state(const uint32_t *state, uint32_t ways,
+                            uint32_t used) {
+        const uint32_t *prev = state;
+        const uint32_t *next = state + ways;
+
+        if (used == 0) {
+            return true;
+        }
+        uint32_t before = ways;
+        uint32_t way = state[2 * ways];
+        for (uint32_t count = 0; count < used; ++count) {
+            if (way >= used || prev[way] != before) {
+                return false;
+            }
+            before = way;
+            way = next[way];
+        }
+        return way == ways && state[2 * ways + 1] == before;
+    }
+
+private:
+    static uint32_t &head(uint32_t *state, uint32_t ways) {
+        return state[2 * ways];
+    }
+
+    static uint32_t &tail(uint32_t *state, uint32_t ways) {
+        return state[2 * ways + 1];
+    }
+
+    // Links a way in at the head; `used` counts the linked ways including it
+    static void push_front(uint32_t *state, uint32_t ways, uint32_t way,
+                           uint32_t used) {
+        uint32_t *prev = state;
+        uint32_t *next = state + ways;
+
+        prev[way] = ways;
+        if (used == 1) {
+            // First way of the set: it is both the head and the tail
+            next[way] = ways;
+            tail(state, ways) = way;
+        } else {
+            next[way] = head(state, ways);
+            prev[head(state, ways)] = way;
+        }
+        head(state, ways) = way;
+    }
+
+    static void unlink(uint32_t *state, uint32_t ways, uint32_t way) {
+        uint32_t *prev = state;
+        uint32_t *next = state + ways;
+
+        if (prev[way] == ways) {
+            head(state, ways) = next[way];
+        } else {
+            next[prev[way]] = next[way];
+        }
+        if (next[way] == ways) {
+            tail(state, ways) = prev[way];
+        } else {
+            prev[next[way]] = prev[way];
+        }
+    }
+};
+
+using LruPolicy = RecencyPolicy<true>;
+using FifoPolicy = RecencyPolicy<false>;
+
+/**
+ * Tree pseudo-LRU. A binary tree over the ways (a power of 2) has one bit
+ * per inner node pointing towards the half that was used less recently;
+ * every access flips the bits on its path to point away from it, and the
+ * victim is found by following the bits from the root.
+ *
+ * State: one word per inner node, heap ordered (node n has children 2n + 1
+ * and 2n + 2, and way w is leaf w + ways - 1).
+ */
+class PlruPolicy {
+public:
+    static uint32_t state_words(uint32_t ways) { return ways - 1; }
+
+    void begin_access() {}
+
+    void on_hit(uint32_t *state, uint32_t ways, uint32_t way) {
+        for (uint32_t node = way + ways - 1; node != 0;) {
+            uint32_t parent = (node - 1) / 2;
+            state[parent] = (node == 2 * parent + 1);  // Point at the other
+            node = parent;
+        }
+    }
+
+    void on_insert(uint32_t *state, uint32_t ways, uint32_t /* used */,
+                   uint32_t way) {
+        on_hit(state, ways, way);
+    }
+
+    uint32_t victim(uint32_t *state, uint32_t ways) {
+        uint32_t node = 0;
+        while (node < ways - 1) {
+            node = 2 * node + 1 + state[node];
+        }
+        return node - (ways - 1);
+    }
+
+    void on_replace(uint32_t *state, uint32_t ways, uint32_t way) {
+        on_hit(state, ways, way);
+    }
+
+    // The tree describes positions, not blocks, so a moved way simply
+    // inherits the recency of the position it moves into
+    void on_remove(uint32_t * /* state */, uint32_t /* ways */,
+                   uint32_t /* way */, uint32_t /* last */) {}
+
+    // Every bit must pick one of two children
+    static bool valid_state(const uint32_t *state, uint32_t ways,
+                            uint32_t /* used */) {
+        for (uint32_t node = 0; node < ways - 1; ++node) {
+            if (state[node] > 1) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+/**
+ * Next step of a per-set xorshift generator. Sets start with a zero state,
+ * which is replaced by a fixed seed, so every set draws the same sequence
+ * for the same history however the sets are split across caches.
+ */
+inline uint32_t next_random(uint32_t &seed) {
+    uint32_t x = seed ? seed : 2463534242u;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    seed = x;
+    return x;
+}
+
+/**
+ * Re-reference interval prediction with 2-bit RRPVs. Hits predict a near
+ * re-reference (0); the victim is a way predicted distant (3), ageing every
+ * way until one is. SRRIP (BIMODAL = false) inserts blocks as long (2);
+ * BRRIP (BIMODAL = true) inserts them as distant except for one in 32,
+ * which resists thrashing.
+ *
+ * State: [rrpv: ways][random seed].
+ */
+template <bool BIMODAL>
+class RripPolicy {
+public:
+    static const uint32_t DISTANT = 3;
+
+    static uint32_t state_words(uint32_t ways) { return ways + 1; }
+
+    void begin_access() {}
+
+    void on_hit(uint32_t *state, uint32_t /* ways */, uint32_t way) {
+        state[way] = 0;
+    }
+
+    void on_insert(uint32_t *state, uint32_t ways, uint32_t /* used */,
+                   uint32_t way) {
+        on_replace(state, ways, way);
+    }
+
+    uint32_t victim(uint32_t *state, uint32_t ways) {
+        // Age every way at once by as much as the oldest needs
+        uint32_t oldest = 0;
+        for (uint32_t way = 1; way < ways; ++way) {
+            if (state[way] > state[oldest]) {
+                oldest = way;
+            }
+        }
+        uint32_t age = DISTANT - state[oldest];
+        if (age != 0) {
+            for (uint32_t way = 0; way < ways; ++way) {
+                state[way] += age;
+            }
+        }
+        return oldest;
+    }
+
+    void on_replace(uint32_t *state, uint32_t ways, uint32_t way) {
+        if (BIMODAL && next_random(state[ways]) % 32 != 0) {
+            state[way] = DISTANT;
+        } else {
+            state[way] = DISTANT - 1;
+        }
+    }
+
+    void on_remove(uint32_t *state, uint32_t /* ways */, uint32_t way,
+                   uint32_t last) {
+        state[way] = state[last];
+    }
+
+    // Ageing assumes no RRPV is above DISTANT
+    static bool valid_state(const uint32_t *state, uint32_t /* ways */,
+                            uint32_t used) {
+        for (uint32_t way = 0; way < used; ++way) {
+            if (state[way] > DISTANT) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+using SrripPolicy = RripPolicy<false>;
+using BrripPolicy = RripPolicy<true>;
+
+/**
+ * Least frequently used: each block counts its accesses since it was
+ * loaded, and the victim is the way with the lowest count (the lowest way
+ * on ties).
+ *
+ * State: one access count per way.
+ */
+class LfuPolicy {
+public:
+    static uint32_t state_words(uint32_t ways) { return ways; }
+
+    void begin_access() {}
+
+    void on_hit(uint32_t *state, uint32_t /* ways */, uint32_t way) {
+        if (state[way] != UINT32_MAX) {
+            ++state[way];
+        }
+    }
+
+    void on_insert(uint32_t *state, uint32_t /* ways */, uint32_t /* used */,
+                   uint32_t way) {
+        state[way] = 1;
+    }
+
+    uint32_t victim(uint32_t *state, uint32_t ways) {
+        uint32_t victim = 0;
+        for (uint32_t way = 1; way < ways; ++way) {
+            if (state[way] < state[victim]) {
+                victim = way;
+            }
+        }
+        return victim;
+    }
+
+    void on_replace(uint32_t *state, uint32_t /* ways */, uint32_t way) {
+        state[way] = 1;
+    }
+
+    void on_remove(uint32_t *state, uint32_t /* ways */, uint32_t way,
+                   uint32_t last) {
+        state[way] = state[last];
+    }
+
+    // Any counts will do
+    static bool valid_state(const uint32_t *, uint32_t, uint32_t) {
+        return true;
+    }
+};
+
+/**
+ * Evicts a uniformly random way (the ways are a power of 2).
+ *
+ * State: the set's random seed.
+ */
+class RandomPolicy {
+public:
+    static uint32_t state_words(uint32_t /* ways */) { return 1; }
+
+    void begin_access() {}
+    void on_hit(uint32_t *, uint32_t, uint32_t) {}
+    void on_insert(uint32_t *, uint32_t, uint32_t, uint32_t) {}
+
+    uint32_t victim(uint32_t *state, uint32_t ways) {
+        return next_random(state[0]) & (ways - 1);
+    }
+
+    void on_replace(uint32_t *, uint32_t, uint32_t) {}
+    void on_remove(uint32_t *, uint32_t, uint32_t, uint32_t) {}
+
+    // Any seed will do
+    static bool valid_state(const uint32_t *, uint32_t, uint32_t) {
+        return true;
+    }
+};
+
+// Next-use position of a block that is never accessed again
+const uint32_t NEVER_USED = UINT32_MAX;
+
+/**
+ * Belady's optimal replacement (OPT/MIN): evicts the block whose next use
+ * lies furthest in the future. It needs the whole trace in advance, as a
+ * next-use index (see build_next_use) whose entries line up with the loads
+ * and stores made on the cache.
+ *
+ * State: the next-use position of the block in each way.
+ */
+class OptPolicy {
+public:
+    /**
+     * @param next_use The next-use index of the trace being simulated.
+     */
+    explicit OptPolicy(const std::vector<uint32_t> *next_use = nullptr)
+        : next_use(next_use) {}
+
+    static uint32_t state_words(uint32_t ways) { return ways; }
+
+    void begin_access() { current = (*next_use)[position++]; }
+
+    void on_hit(uint32_t *state, uint32_t /* ways */, uint32_t way) {
+        state[way] = current;
+    }
+
+    void on_insert(uint32_t *state, uint32_t /* ways */, uint32_t /* used */,
+                   uint32_t way) {
+        state[way] = current;
+    }
+
+    uint32_t victim(uint32_t *state, uint32_t ways) {
+        uint32_t victim = 0;
+        for (uint32_t way = 1; way < ways; ++way) {
+            if (state[way] > state[victim]) {
+                victim = way;
+            }
+        }
+        return victim;
+    }
+
+    void on_replace(uint32_t *state, uint32_t /* ways */, uint32_t way) {
+        state[way] = current;
+    }
+
+    void on_remove(uint32_t *state, uint32_t /* ways */, uint32_t way,
+                   uint32_t last) {
+        state[way] = state[last];
+    }
+
+    // Never called: opt caches are not checkpointed
+    static bool valid_state(const uint32_t *, uint32_t, uint32_t) {
+        return true;
+    }
+
+private:
+    const std::vector<uint32_t> *next_use;
+    uint32_t position = 0;  // Index of the access being simulated
+    uint32_t current = 0;   // Next use of the block it accesses
+};
+
+/**
+ * Builds the next-use index of a trace for a given block size: entry i is
+ * the position of the next record that accesses the same block as record
+ * i, or NEVER_USED.
+ *
+ * @param records The whole trace, shorter than NEVER_USED records.
+ * @param block_size Block size of the cache, a power of 2.
+ * @return The next-use index.
+ */
+std::vector<uint32_t> build_next_use(const std::vector<TraceRecord> &records,
+                                     uint32_t block_size);
+
+#endif  // REPLACEMENT_POLICY_H
@@ -0,0 +1,748 @@
+#include "Sampling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Cache.h"
+#include "CacheConfig.h"
+#include "ErrorCodes.h"
+#include "TraceReader.h"
+
+namespace {
+
+// Trace records read at a time
+const size_t BATCH = 4096;
+
+// Buckets of an interval's address signature
+const size_t SIGNATURE_SIZE = 64;
+
+// Page size the signature is taken over, as a shift
+const uint32_t SIGNATURE_PAGE_BITS = 12;
+
+// Rounds of k-means before giving up on convergence
+const int MAX_ROUNDS = 100;
+
+// Two-sided 95% critical values of Student's t for 1 to 30 degrees of
+// freedom; the normal value is used beyond
+const double T_95[30] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365,
+                         2.306,  2.262, 2.228, 2.201, 2.179, 2.160, 2.145,
+                         2.131,  2.120, 2.110, 2.101, 2.093, 2.086, 2.080,
+                         2.074,  2.069, 2.064, 2.060, 2.056, 2.052, 2.048,
+                         2.045,  2.042};
+const double Z_95 = 1.960;
+
+// Seed of the draw of the intervals measured in each phase, fixed so that
+// runs repeat
+const uint64_t PHASE_SEED = 0x9E3779B97F4A7C15;
+
+/**
+ * What is done with an access.
+ */
+enum Mode {
+    SKIP,     // Read but not simulated
+    WARM,     // Simulated, but not measured
+    MEASURE,  // Simulated and measured
+};
+
+/**
+ * A run of accesses handled alike.
+ */
+struct Segment {
+    Mode mode;
+    uint64_t length;  // Accesses left in the run
+    uint64_t window;  // Window measured, for MEASURE
+};
+
+/**
+ * Counters of one detailed window.
+ */
+struct Window {
+    uint64_t index;    // Period or interval it was taken from
+    CacheStats stats;  // Counters of the window alone
+};
+
+// Next value of a splitmix64 generator
+uint64_t splitmix(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+    return z ^ (z >> 31);
+}
+
+// Counters accumulated between two snapshots of the same cache
+CacheStats difference(const CacheStats& to, const CacheStats& from) {
+    CacheStats stats;
+    stats.loads = to.loads - from.loads;
+    stats.stores = to.stores - from.stores;
+    stats.load_hits = to.load_hits - from.load_hits;
+    stats.load_misses = to.load_misses - from.load_misses;
+    stats.store_hits = to.store_hits - from.store_hits;
+    stats.store_misses = to.store_misses - from.store_misses;
+    stats.cycles = to.cycles - from.cycles;
+    stats.writebacks = to.writebacks - from.writebacks;
+    return stats;
+}
+
+// Fraction of the accesses of some counters that hit
+double hit_rate(const CacheStats& stats) {
+    uint64_t accesses = stats.loads + stats.stores;
+    return accesses == 0 ? 0.0
+                         : static_cast<double>(stats.load_hits +
+                                               stats.store_hits) /
+                               accesses;
+}
+
+// Parses a non-negative count, returning false if it is not one
+bool parse_count(const std::string& field, uint64_t& value) {
+    try {
+        long long parsed = std::stoll(field);
+        if (parsed < 0) {
+            return false;
+        }
+        value = static_cast<uint64_t>(parsed);
+        return true;
+    } catch (const std::exception& e) {
+        return false;
+    }
+}
+
+/**
+ * Runs a trace through a cache, measuring the windows a plan picks.
+ *
+ * Warm-up accesses update the cache's blocks and replacement state like
+ * any other; only the counters of measured windows are kept, taken as the
+ * difference between snapshots at the window's ends. A window the trace
+ * ends in is dropped.
+ *
+ * @param reader The trace.
+ * @param cache The sampled cache.
+ * @param check Cache simulated over every access, or null.
+ * @param plan Gives the Segment starting at an access number.
+ * @param windows Gains the measured windows.
+ * @param totals Gains the loads and stores of the whole trace.
+ * @param run Number of records read; advanced as they are.
+ * @return END, or the status of the failed read.
+ */
+template <typename Plan>
+TraceReader::Status simulate_plan(TraceReader& reader, Cache& cache,
+                                  Cache* check, const Plan& plan,
+                                  std::vector<Window>& windows,
+                                  CacheStats& totals, uint64_t& run) {
+    std::vector<TraceRecord> batch;
+    batch.reserve(BATCH);
+    CacheStats start;
+    bool measuring = false;  // A window is open
+
+    TraceReader::Status status;
+    TraceRecord record;
+    do {
+        batch.clear();
+        while (batch.size() < BATCH &&
+               (status = reader.next(record)) == TraceReader::RECORD) {
+            batch.push_back(record);
+            if (record.op == 's') {
+                ++totals.stores;
+            } else {
+                ++totals.loads;
+            }
+        }
+
+        uint64_t first = run;
+        for (size_t done = 0; done < batch.size();) {
+            Segment segment = plan(first + done);
+            size_t step = static_cast<size_t>(
+                std::min<uint64_t>(batch.size() - done, segment.length));
+            if (segment.mode == SKIP) {
+                done += step;
+                continue;
+            }
+
+            if (segment.mode == MEASURE && !measuring) {
+                start = cache.get_stats();
+                measuring = true;
+            }
+            cache.simulate(batch.data() + done, step);
+            done += step;
+            if (segment.mode == MEASURE && step == segment.length) {
+                windows.push_back(
+                    {segment.window, difference(cache.get_stats(), start)});
+                measuring = false;
+            }
+        }
+        if (check) {
+            check->simulate(batch.data(), batch.size());
+        }
+        run += batch.size();
+    } while (status == TraceReader::RECORD);
+    return status;
+}
+
+/**
+ * Windows of one stratum: a group of periods or intervals assumed alike,
+ * of which some were measured.
+ */
+struct Stratum {
+    uint64_t accesses = 0;  // Accesses of the whole group
+    uint64_t members = 0;   // Periods or intervals in the group
+    std::vector<CacheStats> windows;
+};
+
+/**
+ * An estimate of the counters of a whole trace from its strata.
+ */
+struct Estimate {
+    double load_misses = 0.0;
+    double store_misses = 0.0;
+    double cycles = 0.0;
+    double hit_rate = 0.0;
+    double half_width = 0.0;  // Of the hit rate's 95% interval, or NaN
+};
+
+/**
+ * Estimates the counters of a trace from measured windows, scaling each
+ * stratum's per-access rates up to its accesses. The confidence interval
+ * is that of a stratified sample of window hit rates (with a finite
+ * population correction, so measuring every window gives an exact
+ * answer); it is unknown if a stratum has fewer than two windows.
+ *
+ * @param strata The strata, each with at least one window.
+ * @param accesses Accesses of the whole trace.
+ * @return The estimate.
+ */
+Estimate estimate(const std::vector<Stratum>& strata, uint64_t accesses) {
+    Estimate result;
+    double variance = 0.0;
+    uint64_t freedom = 0;
+    bool known = true;
+
+    for (const Stratum& stratum : strata) {
+        CacheStats sum;
+        for (const CacheStats& window : stratum.windows) {
+            sum += window;
+        }
+        double scale = static_cast<double>(stratum.accesses) /
+                       static_cast<double>(sum.loads + sum.stores);
+        result.load_misses += sum.load_misses * scale;
+        result.store_misses += sum.store_misses * scale;
+        result.cycles += sum.cycles * scale;
+
+        size_t n = stratum.windows.size();
+        if (n < 2) {
+            known = false;
+            continue;
+        }
+        double mean = hit_rate(sum);
+        double squares = 0.0;
+        for (const CacheStats& window : stratum.windows) {
+            double deviation = hit_rate(window) - mean;
+            squares += deviation * deviation;
+        }
+        double weight = static_cast<double>(stratum.accesses) / accesses;
+        double correction = 1.0 - static_cast<double>(n) / stratum.members;
+        variance += weight * weight * squares / (n - 1) / n *
+                    std::max(correction, 0.0);
+        freedom += n - 1;
+    }
+
+    result.hit_rate =
+        accesses == 0
+            ? 0.0
+            : 1.0 - (result.load_misses + result.store_misses) / accesses;
+    if (!known) {
+        result.half_width = std::numeric_limits<double>::quiet_NaN();
+    } else {
+        double critical = freedom <= 30 ? T_95[freedom - 1] : Z_95;
+        result.half_width = critical * std::sqrt(variance);
+    }
+    return result;
+}
+
+/**
+ * Prints an estimate, and how it compares with the exact counters.
+ *
+ * @param result The estimate.
+ * @param totals Loads and stores of the whole trace.
+ * @param check Counters of a full simulation, or null.
+ */
+void print_estimate(const Estimate& result, const CacheStats& totals,
+                    const CacheStats* check) {
+    std::cout << "Total loads: " << totals.loads << "\n"
+              << "Total stores: " << totals.stores << "\n"
+              << "Estimated load misses: " << std::llround(result.load_misses)
+              << "\n"
+              << "Estimated store misses: "
+              << std::llround(result.store_misses) << "\n"
+              << "Estimated total cycles: " << std::llround(result.cycles)
+              << "\n"
+              << std::fixed << std::setprecision(5)
+              << "Estimated hit rate: " << result.hit_rate;
+    if (std::isnan(result.half_width)) {
+        std::cout << " (confidence interval needs two windows per stratum)\n";
+    } else {
+        std::cout << " +/- " << result.half_width << " (95% confidence)\n";
+    }
+
+    if (check) {
+        double exact = hit_rate(*check);
+        double error = result.hit_rate - exact;
+        std::cout << "Full-run hit rate: " << exact << " (error "
+                  << std::showpos << error << std::noshowpos;
+        if (!std::isnan(result.half_width)) {
+            std::cout << (std::fabs(error) <= result.half_width + 1e-9
+                              ? ", inside the interval"
+                              : ", outside the interval");
+        }
+        std::cout << ")\n";
+    }
+    std::cout << std::defaultfloat << std::flush;
+}
+
+/**
+ * Address signatures of the intervals of a trace: the fraction of each
+ * interval's accesses falling in each of a few buckets of pages.
+ */
+struct Signatures {
+    std::vector<double> values;  // SIGNATURE_SIZE per full interval
+    std::vector<double> tail;    // Signature of a last, partial interval
+    uint64_t tail_accesses = 0;
+    size_t count() const { return values.size() / SIGNATURE_SIZE; }
+};
+
+// Bucket of an address's page in a signature
+size_t signature_bucket(uint64_t address) {
+    uint64_t page = address >> SIGNATURE_PAGE_BITS;
+    return static_cast<size_t>((page * 0x9E3779B97F4A7C15ull) >> 58);
+}
+
+/**
+ * Reads a trace and takes the signature of each of its intervals.
+ *
+ * @param reader The trace.
+ * @param interval Accesses per interval.
+ * @param signatures Filled with the signatures.
+ * @param run Number of records read; advanced as they are.
+ * @return END, or the status of the failed read.
+ */
+TraceReader::Status sign_intervals(TraceReader& reader, uint64_t interval,
+                                   Signatures& signatures, uint64_t& run) {
+    std::vector<uint64_t> counts(SIGNATURE_SIZE);
+    uint64_t filled = 0;
+
+    // Appends the signature of the counts so far to `out`
+    auto sign = [&](std::vector<double>& out) {
+        for (uint64_t count : counts) {
+            out.push_back(static_cast<double>(count) / filled);
+        }
+        std::fill(counts.begin(), counts.end(), 0);
+    };
+
+    TraceReader::Status status;
+    TraceRecord record;
+    while ((status = reader.next(record)) == TraceReader::RECORD) {
+        ++counts[signature_bucket(record.address)];
+        ++run;
+        if (++filled == interval) {
+            sign(signatures.values);
+            filled = 0;
+        }
+    }
+    if (filled != 0) {
+        signatures.tail_accesses = filled;
+        sign(signatures.tail);
+    }
+    return status;
+}
+
+// Squared distance between two signatures
+double distance(const double* a, const double* b) {
+    double sum = 0.0;
+    for (size_t i = 0; i < SIGNATURE_SIZE; ++i) {
+        sum += (a[i] - b[i]) * (a[i] - b[i]);
+    }
+    return sum;
+}
+
+// Centre nearest a signature
+size_t nearest(const double* signature, const std::vector<double>& centres) {
+    size_t best = 0;
+    double best_distance = std::numeric_limits<double>::infinity();
+    for (size_t c = 0; c * SIGNATURE_SIZE < centres.size(); ++c) {
+        double d = distance(signature, &centres[c * SIGNATURE_SIZE]);
+        if (d < best_distance) {
+            best = c;
+            best_distance = d;
+        }
+    }
+    return best;
+}
+
+/**
+ * Clusters signatures with k-means. The first centre is the first interval
+ * and each further one the interval farthest from the centres so far, so
+ * the result does not depend on a random seed.
+ *
+ * @param signatures The signatures.
+ * @param clusters Number of clusters, at most the number of intervals.
+ * @param centres Filled with the centre of each cluster.
+ * @return Cluster of each interval.
+ */
+std::vector<size_t> cluster(const Signatures& signatures, size_t clusters,
+                            std::vector<double>& centres) {
+    size_t count = signatures.count();
+    const double* values = signatures.values.data();
+
+    centres.assign(values, values + SIGNATURE_SIZE);
+    std::vector<double> gap(count, std::numeric_limits<double>::infinity());
+    while (centres.size() < clusters * SIGNATURE_SIZE) {
+        const double* last = &centres[centres.size() - SIGNATURE_SIZE];
+        size_t farthest = 0;
+        for (size_t i = 0; i < count; ++i) {
+            gap[i] = std::min(gap[i], distance(&values[i * SIGNATURE_SIZE],
+                                               last));
+            if (gap[i] > gap[farthest]) {
+                farthest = i;
+            }
+        }
+        const double* pick = &values[farthest * SIGNATURE_SIZE];
+        centres.insert(centres.end(), pick, pick + SIGNATURE_SIZE);
+    }
+
+    std::vector<size_t> assignment(count, clusters);
+    for (int round = 0; round < MAX_ROUNDS; ++round) {
+        bool moved = false;
+        for (size_t i = 0; i < count; ++i) {
+            size_t c = nearest(&values[i * SIGNATURE_SIZE], centres);
+            moved |= c != assignment[i];
+            assignment[i] = c;
+        }
+        if (!moved) {
+            break;
+        }
+
+        // An emptied cluster keeps its old centre
+        std::vector<double> sums(centres.size());
+        std::vector<uint64_t> sizes(clusters);
+        for (size_t i = 0; i < count; ++i) {
+            ++sizes[assignment[i]];
+            for (size_t b = 0; b < SIGNATURE_SIZE; ++b) {
+                sums[assignment[i] * SIGNATURE_SIZE + b] +=
+                    values[i * SIGNATURE_SIZE + b];
+            }
+        }
+        for (size_t c = 0; c < clusters; ++c) {
+            for (size_t b = 0; sizes[c] != 0 && b < SIGNATURE_SIZE; ++b) {
+                centres[c * SIGNATURE_SIZE + b] =
+                    sums[c * SIGNATURE_SIZE + b] / sizes[c];
+            }
+        }
+    }
+    return assignment;
+}
+
+/**
+ * Periodic sampling of a trace.
+ *
+ * @return csim exit code.
+ */
+int sample_periodic(const CacheConfig& config, const std::string& trace_file,
+                    const SampleConfig& sample, bool check) {
+    int trace_fd = open_trace(trace_file);
+    if (trace_fd < 0) {
+        return INVALID_COMMAND_LINE;
+    }
+    TraceReader reader(trace_fd);
+
+    std::unique_ptr<Cache> cache = make_cache(config);
+    std::unique_ptr<Cache> full;
+    if (check) {
+        full = make_cache(config);
+    }
+
+    // Each period skips, then warms up, then measures a window
+    uint64_t skipped = sample.period - sample.window - sample.warmup;
+    auto plan = [&](uint64_t access) {
+        uint64_t offset = access % sample.period;
+        uint64_t window = access / sample.period;
+        if (offset < skipped) {
+            return Segment{SKIP, skipped - offset, window};
+        }
+        if (offset < skipped + sample.warmup) {
+            return Segment{WARM, skipped + sample.warmup - offset, window};
+        }
+        return Segment{MEASURE, sample.period - offset, window};
+    };
+
+    std::vector<Window> windows;
+    CacheStats totals;
+    uint64_t run = 0;
+    TraceReader::Status status = simulate_plan(reader, *cache, full.get(),
+                                               plan, windows, totals, run);
+    if (status != TraceReader::END) {
+        return report_trace_error(status, run);
+    }
+    if (windows.empty()) {
+        std::cerr << "Error: Trace too short for a whole sampling period."
+                  << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+
+    // The windows are a sample of all the window-sized runs of the trace
+    std::vector<Stratum> strata(1);
+    strata[0].accesses = run;
+    strata[0].members = run / sample.window;
+    for (const Window& window : windows) {
+        strata[0].windows.push_back(window.stats);
+    }
+
+    std::cout << "Sampled windows: " << windows.size() << " of "
+              << run / sample.period << " periods ("
+              << windows.size() * sample.window << " of " << run
+              << " accesses measured)" << std::endl;
+    CacheStats exact;
+    if (full) {
+        exact = full->get_stats();
+    }
+    print_estimate(estimate(strata, run), totals, full ? &exact : nullptr);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Phase-based sampling of a trace file.
+ *
+ * @return csim exit code.
+ */
+int sample_phases(const CacheConfig& config, const std::string& trace_file,
+                  const PhaseConfig& phases, bool check) {
+    if (trace_file == "-") {
+        std::cerr << "Error: Phase sampling reads the trace twice, so it "
+                  << "needs a trace file." << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+
+    // First pass: the signature of each interval
+    Signatures signatures;
+    uint64_t run = 0;
+    {
+        int trace_fd = open_trace(trace_file);
+        if (trace_fd < 0) {
+            return INVALID_COMMAND_LINE;
+        }
+        TraceReader reader(trace_fd);
+        TraceReader::Status status =
+            sign_intervals(reader, phases.interval, signatures, run);
+        if (status != TraceReader::END) {
+            return report_trace_error(status, run);
+        }
+    }
+    size_t count = signatures.count();
+    if (count == 0) {
+        std::cerr << "Error: Trace too short for a whole phase interval."
+                  << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+
+    std::vector<double> centres;
+    std::vector<size_t> assignment = cluster(
+        signatures, std::min<size_t>(phases.clusters, count), centres);
+
+    // Drop clusters k-means emptied, numbering the rest in order
+    std::vector<size_t> number(centres.size() / SIGNATURE_SIZE, count);
+    for (size_t c : assignment) {
+        number[c] = 0;
+    }
+    size_t clusters = 0;
+    for (size_t c = 0; c < number.size(); ++c) {
+        if (number[c] == 0) {
+            std::copy_n(&centres[c * SIGNATURE_SIZE], SIGNATURE_SIZE,
+                        &centres[clusters * SIGNATURE_SIZE]);
+            number[c] = clusters++;
+        }
+    }
+    centres.resize(clusters * SIGNATURE_SIZE);
+    for (size_t& c : assignment) {
+        c = number[c];
+    }
+
+    // Each cluster is a stratum: a random sample of its intervals is
+    // measured, and the partial last interval only adds to its weight
+    std::vector<Stratum> strata(clusters);
+    std::vector<std::vector<size_t>> members(clusters);
+    for (size_t i = 0; i < count; ++i) {
+        members[assignment[i]].push_back(i);
+        strata[assignment[i]].accesses += phases.interval;
+        ++strata[assignment[i]].members;
+    }
+    if (signatures.tail_accesses != 0) {
+        size_t c = nearest(signatures.tail.data(), centres);
+        strata[c].accesses += signatures.tail_accesses;
+    }
+
+    // The intervals are drawn rather than taken nearest the centre, which
+    // would favour the most typical ones and bias both the estimate and
+    // its interval
+    std::vector<bool> chosen(count + 1, false);
+    uint64_t state = PHASE_SEED;
+    for (size_t c = 0; c < clusters; ++c) {
+        std::vector<size_t>& list = members[c];
+        size_t take = std::min<size_t>(list.size(), phases.per_cluster);
+        for (size_t k = 0; k < take; ++k) {
+            std::swap(list[k], list[k + splitmix(state) % (list.size() - k)]);
+        }
+        list.resize(take);
+        std::sort(list.begin(), list.end());
+        for (size_t i : list) {
+            chosen[i] = true;
+        }
+    }
+
+    // Second pass: each chosen interval is warmed up by the one before it
+    int trace_fd = open_trace(trace_file);
+    if (trace_fd < 0) {
+        return INVALID_COMMAND_LINE;
+    }
+    TraceReader reader(trace_fd);
+    std::unique_ptr<Cache> cache = make_cache(config);
+    std::unique_ptr<Cache> full;
+    if (check) {
+        full = make_cache(config);
+    }
+
+    uint64_t interval = phases.interval;
+    auto plan = [&](uint64_t access) {
+        uint64_t index = access / interval;
+        uint64_t left = interval - access % interval;
+        if (index < count && chosen[index]) {
+            return Segment{MEASURE, left, index};
+        }
+        if (index < count && chosen[index + 1]) {
+            return Segment{WARM, left, index};
+        }
+        return Segment{SKIP, left, index};
+    };
+
+    std::vector<Window> windows;
+    CacheStats totals;
+    run = 0;
+    TraceReader::Status status = simulate_plan(reader, *cache, full.get(),
+                                               plan, windows, totals, run);
+    if (status != TraceReader::END) {
+        return report_trace_error(status, run);
+    }
+    for (const Window& window : windows) {
+        strata[assignment[window.index]].windows.push_back(window.stats);
+    }
+
+    std::cout << "Phases: " << clusters << " clusters of " << count
+              << " intervals (" << windows.size() * interval << " of " << run
+              << " accesses measured)\n"
+              << "phase,intervals,weight,measured\n";
+    for (size_t c = 0; c < clusters; ++c) {
+        std::cout << c << "," << strata[c].members << ","
+                  << std::setprecision(4)
+                  << static_cast<double>(strata[c].accesses) / run << ",";
+        for (size_t i = 0; i < members[c].size(); ++i) {
+            std::cout << (i == 0 ? "" : " ") << members[c][i];
+        }
+        std::cout << "\n";
+    }
+    std::cout << std::setprecision(6) << "\n";
+
+    CacheStats exact;
+    if (full) {
+        exact = full->get_stats();
+    }
+    print_estimate(estimate(strata, run), totals, full ? &exact : nullptr);
+    return EXIT_SUCCESS;
+}
+
+}  // namespace
+
+/**
+ * Parses `<period>:<window>[:<warmup>]`.
+ *
+ * @param spec The specification.
+ * @param config Filled with the parsed configuration on success.
+ * @return 0 on success, otherwise the csim exit code for the problem.
+ */
+int parse_sample_config(const std::string& spec, SampleConfig& config) {
+    std::vector<std::string> fields = split(spec, ':');
+    SampleConfig parsed;
+    if ((fields.size() != 2 && fields.size() != 3) ||
+        !parse_count(fields[0], parsed.period) ||
+        !parse_count(fields[1], parsed.window) ||
+        (fields.size() == 3 && !parse_count(fields[2], parsed.warmup))) {
+        std::cerr << "Error: Sampling must be "
+                  << "'<period>:<window>[:<warmup>]'." << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+    if (parsed.window == 0 || parsed.window > parsed.period) {
+        std::cerr << "Error: Sampling window must be positive and at most "
+                  << "the period." << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+    if (fields.size() == 2) {
+        parsed.warmup = parsed.period - parsed.window;
+    } else if (parsed.warmup > parsed.period - parsed.window) {
+        std::cerr << "Error: Sampling warm-up must fit in the period with "
+                  << "the window." << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+
+    config = parsed;
+    return 0;
+}
+
+/**
+ * Parses `<interval>:<clusters>[:<per_cluster>]`.
+ *
+ * @param spec The specification.
+ * @param config Filled with the parsed configuration on success.
+ * @return 0 on success, otherwise the csim exit code for the problem.
+ */
+int parse_phase_config(const std::string& spec, PhaseConfig& config) {
+    std::vector<std::string> fields = split(spec, ':');
+    uint64_t values[3] = {0, 0, 3};
+    bool valid = fields.size() == 2 || fields.size() == 3;
+    for (size_t i = 0; valid && i < fields.size(); ++i) {
+        valid = parse_count(fields[i], values[i]) && values[i] != 0;
+    }
+    if (!valid || values[1] > UINT32_MAX || values[2] > UINT32_MAX) {
+        std::cerr << "Error: Phases must be "
+                  << "'<interval>:<clusters>[:<per_cluster>]', all positive."
+                  << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+
+    config.interval = values[0];
+    config.clusters = static_cast<uint32_t>(values[1]);
+    config.per_cluster = static_cast<uint32_t>(values[2]);
+    return 0;
+}
+
+/**
+ * Simulates a cache over samples of a trace and prints the estimates.
+ *
+ * @param config The cache.
+ * @param trace_file Path of the trace, or "-" for standard input.
+ * @param sample Periodic sampling, or null.
+ * @param phases Phase-based sampling, or null.
+ * @param check Also simulate the whole trace and compare.
+ * @return csim exit code.
+ */
+int run_sampled(const CacheConfig& config, const std::string& trace_file,
+                const SampleConfig* sample, const PhaseConfig* phases,
+                bool check) {
+    std::cout << "Running the simulation." << std::endl;
+    if (phases) {
+        return sample_phases(config, trace_file, *phases, check);
+    }
+    return sample_periodic(config, trace_file, *sample, check);
+}
@@ -0,0 +1,71 @@
+#ifndef SAMPLING_H
+#define SAMPLING_H
+
+#include <cstdint>
+#include <string>
+
+#include "CacheConfig.h"
+
+/**
+ * Periodic sampling: every `period` accesses end with a detailed window of
+ * `window` accesses, preceded by `warmup` accesses that only warm the cache
+ * up; the accesses before those are skipped without being simulated.
+ */
+struct SampleConfig {
+    uint64_t period = 0;
+    uint64_t window = 0;
+    uint64_t warmup = 0;
+};
+
+/**
+ * Phase-based sampling: the trace is cut into intervals of `interval`
+ * accesses, the intervals are clustered by their address signatures, and
+ * `per_cluster` intervals drawn at random from each cluster are simulated
+ * in detail (each warmed up by the interval before it).
+ */
+struct PhaseConfig {
+    uint64_t interval = 0;
+    uint32_t clusters = 0;
+    uint32_t per_cluster = 3;
+};
+
+/**
+ * Parses `<period>:<window>[:<warmup>]`. The warm-up defaults to the whole
+ * rest of the period. Problems are reported on standard error.
+ *
+ * @param spec The specification.
+ * @param config Filled with the parsed configuration on success.
+ * @return 0 on success, otherwise the csim exit code for the problem.
+ */
+int parse_sample_config(const std::string &spec, SampleConfig &config);
+
+/**
+ * Parses `<interval>:<clusters>[:<per_cluster>]`; `per_cluster` defaults
+ * to 3, the fewest giving a confidence interval with room to spare.
+ * Problems are reported on standard error.
+ *
+ * @param spec The specification.
+ * @param config Filled with the parsed configuration on success.
+ * @return 0 on success, otherwise the csim exit code for the problem.
+ */
+int parse_phase_config(const std::string &spec, PhaseConfig &config);
+
+/**
+ * Simulates a cache over samples of a trace and prints estimates of its
+ * counters, with a 95% confidence interval for the hit rate. Exactly one
+ * of `sample` and `phases` must be given; phase sampling reads the trace
+ * twice, so it needs a file.
+ *
+ * @param config The cache.
+ * @param trace_file Path of the trace, or "-" for standard input.
+ * @param sample Periodic sampling, or null.
+ * @param phases Phase-based sampling, or null.
+ * @param check Also simulate the whole trace and compare the estimate
+ * against the exact hit rate.
+ * @return csim exit code.
+ */
+int run_sampled(const CacheConfig &config, const std::string &trace_file,
+                const SampleConfig *sample, const PhaseConfig *phases,
+                bool check);
+
+#endif  // SAMPLING_H
@@ -0,0 +1,201 @@
+#include "SetBuckets.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define CSIM_X86_SIMD
+#endif
+
+// The vector paths gather addresses at a 16-byte stride
+static_assert(sizeof(TraceRecord) == 16 &&
+                  offsetof(TraceRecord, address) == 0,
+              "The address must start each 16-byte trace record");
+
+namespace {
+
+/**
+ * One record at a time: what the vector paths do for the rest of a batch.
+ *
+ * @return All tags or-ed together.
+ */
+uint64_t decompose_scalar(const TraceRecord *records, size_t count,
+                          uint32_t offset_size, uint32_t index_size,
+                          uint32_t *index, uint64_t *tag) {
+    const uint64_t index_mask = (uint64_t{1} << index_size) - 1;
+    const uint32_t tag_shift = offset_size + index_size;
+    uint64_t tag_bits = 0;
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t address = records[i].address;
+        index[i] = static_cast<uint32_t>((address >> offset_size) & index_mask);
+        tag[i] = address >> tag_shift;
+        tag_bits |= tag[i];
+    }
+    return tag_bits;
+}
+
+#ifdef CSIM_X86_SIMD
+/**
+ * Four records per step: two loads bring in four records, whose addresses
+ * are the even quadwords.
+ */
+__attribute__((target("avx2"))) uint64_t decompose_avx2(
+    const TraceRecord *records, size_t count, uint32_t offset_size,
+    uint32_t index_size, uint32_t *index, uint64_t *tag) {
+    const __m128i offset_shift = _mm_cvtsi32_si128(offset_size);
+    const __m128i tag_shift = _mm_cvtsi32_si128(offset_size + index_size);
+    const __m256i index_mask =
+        _mm256_set1_epi64x((int64_t{1} << index_size) - 1);
+    const __m256i low_words = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+    __m256i tag_bits = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256i *in = reinterpret_cast<const __m256i *>(records + i);
+        __m256i first = _mm256_loadu_si256(in);       // a0 x a1 x
+        __m256i second = _mm256_loadu_si256(in + 1);  // a2 x a3 x
+        __m256i addresses = _mm256_permute4x64_epi64(
+            _mm256_unpacklo_epi64(first, second), 0xd8);  // a0 a1 a2 a3
+
+        __m256i tags = _mm256_srl_epi64(addresses, tag_shift);
+        __m256i indexes = _mm256_and_si256(
+            _mm256_srl_epi64(addresses, offset_shift), index_mask);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(tag + i), tags);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(index + i),
+                         _mm256_castsi256_si128(
+                             _mm256_permutevar8x32_epi32(indexes, low_words)));
+        tag_bits = _mm256_or_si256(tag_bits, tags);
+    }
+
+    uint64_t lanes[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes), tag_bits);
+    return lanes[0] | lanes[1] | lanes[2] | lanes[3] |
+           decompose_scalar(records + i, count - i, offset_size, index_size,
+                            index + i, tag + i);
+}
+
+/**
+ * Eight records per step, the addresses picked out of two loads by one
+ * permute and the indexes narrowed by a truncating move. The zero-masked
+ * forms of the intrinsics avoid GCC's spurious uninitialized warnings
+ * about the unmasked ones.
+ */
+__attribute__((target("avx512f"))) uint64_t decompose_avx512(
+    const TraceRecord *records, size_t count, uint32_t offset_size,
+    uint32_t index_size, uint32_t *index, uint64_t *tag) {
+    const __m128i offset_shift = _mm_cvtsi32_si128(offset_size);
+    const __m128i tag_shift = _mm_cvtsi32_si128(offset_size + index_size);
+    const __m512i index_mask =
+        _mm512_set1_epi64((int64_t{1} << index_size) - 1);
+    const __m512i even = _mm512_setr_epi64(0, 2, 4, 6, 8, 10, 12, 14);
+    const __mmask8 ALL = 0xff;
+    __m512i tag_bits = _mm512_setzero_si512();
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m512i *in = reinterpret_cast<const __m512i *>(records + i);
+        __m512i addresses = _mm512_permutex2var_epi64(
+            _mm512_loadu_si512(in), even, _mm512_loadu_si512(in + 1));
+
+        __m512i tags = _mm512_maskz_srl_epi64(ALL, addresses, tag_shift);
+        __m512i indexes = _mm512_and_si512(
+            _mm512_maskz_srl_epi64(ALL, addresses, offset_shift), index_mask);
+        _mm512_storeu_si512(tag + i, tags);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(index + i),
+                            _mm512_maskz_cvtepi64_epi32(ALL, indexes));
+        tag_bits = _mm512_or_si512(tag_bits, tags);
+    }
+
+    uint64_t lanes[8];
+    _mm512_storeu_si512(lanes, tag_bits);
+    return lanes[0] | lanes[1] | lanes[2] | lanes[3] | lanes[4] | lanes[5] |
+           lanes[6] | lanes[7] |
+           decompose_scalar(records + i, count - i, offset_size, index_size,
+                            index + i, tag + i);
+}
+#endif
+
+using Decompose = uint64_t (*)(const TraceRecord *, size_t, uint32_t,
+                               uint32_t, uint32_t *, uint64_t *);
+
+// The widest path the host supports, picked once
+Decompose pick_decompose() {
+#ifdef CSIM_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return decompose_avx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return decompose_avx2;
+    }
+#endif
+    return decompose_scalar;
+}
+
+}  // namespace
+
+/**
+ * Computes the set index and tag of every record.
+ *
+ * @param records The records.
+ * @param count Number of records.
+ * @param offset_size Bits of block offset.
+ * @param index_size Bits of set index (at most 31).
+ * @param index Receives the set index of every record.
+ * @param tag Receives the tag of every record.
+ * @return All tags or-ed together.
+ */
+uint64_t decompose_addresses(const TraceRecord *records, size_t count,
+                             uint32_t offset_size, uint32_t index_size,
+                             uint32_t *index, uint64_t *tag) {
+    static const Decompose decompose = pick_decompose();
+    return decompose(records, count, offset_size, index_size, index, tag);
+}
+
+/**
+ * Splits the records of a batch into index and tag and orders them by set.
+ *
+ * @param records The records.
+ * @param count Number of records (below 2^32).
+ * @param offset_size Bits of block offset.
+ * @param index_size Bits of set index.
+ * @param buckets Receives the decomposed and ordered batch.
+ */
+void bucket_by_set(const TraceRecord *records, size_t count,
+                   uint32_t offset_size, uint32_t index_size,
+                   SetBuckets &buckets) {
+    if (buckets.accesses.size() < count) {
+        buckets.accesses.resize(count);
+        buckets.index.resize(count);
+        buckets.tag.resize(count);
+    }
+    const uint32_t *index = buckets.index.data();
+    const uint64_t *tag = buckets.tag.data();
+    buckets.tag_bits =
+        decompose_addresses(records, count, offset_size, index_size,
+                            buckets.index.data(), buckets.tag.data());
+
+    // Counting sort on the top bits of the index, stable within a bucket
+    const uint32_t shift =
+        index_size > SET_BUCKET_BITS ? index_size - SET_BUCKET_BITS : 0;
+    std::vector<uint32_t> &starts = buckets.starts;
+    starts.assign(size_t{1} << (index_size - shift), 0);
+    for (size_t i = 0; i < count; ++i) {
+        ++starts[index[i] >> shift];
+    }
+    uint32_t start = 0;
+    for (uint32_t &bucket : starts) {
+        uint32_t size = bucket;
+        bucket = start;
+        start += size;
+    }
+
+    SetAccess *accesses = buckets.accesses.data();
+    for (size_t i = 0; i < count; ++i) {
+        accesses[starts[index[i] >> shift]++] = {
+            records[i].address, tag[i], index[i], records[i].op == 's'};
+    }
+}
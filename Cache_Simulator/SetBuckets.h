@@ -0,0 +1,73 @@
+#ifndef SET_BUCKETS_H
+#define SET_BUCKETS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "TraceReader.h"
+
+/**
+ * A trace record split into its set index and tag.
+ */
+struct SetAccess {
+    uint64_t address;
+    uint64_t tag;
+    uint32_t index;
+    bool store;  // Loads and fetches are false
+};
+
+/**
+ * A batch of trace records split into set index and tag, and grouped by
+ * set (see bucket_by_set). Reused from batch to batch, so its arrays only
+ * grow.
+ */
+struct SetBuckets {
+    std::vector<SetAccess> accesses;  // The batch grouped by set
+    uint64_t tag_bits = 0;            // All tags of the batch or-ed together
+
+    // Scratch: index and tag of every record in trace order, and the
+    // counts, then the next free slot, of each bucket
+    std::vector<uint32_t> index;
+    std::vector<uint64_t> tag;
+    std::vector<uint32_t> starts;
+};
+
+// Buckets at most: enough to give each set of a large cache a run of
+// accesses, few enough that counting them stays cheap next to a batch
+const uint32_t SET_BUCKET_BITS = 10;
+
+/**
+ * Computes the set index and tag of every record, several at a time with
+ * AVX-512 or AVX2 where the host has them.
+ *
+ * @param records The records.
+ * @param count Number of records.
+ * @param offset_size Bits of block offset.
+ * @param index_size Bits of set index (at most 31).
+ * @param index Receives the set index of every record.
+ * @param tag Receives the tag of every record.
+ * @return All tags or-ed together, to check their width once per batch.
+ */
+uint64_t decompose_addresses(const TraceRecord *records, size_t count,
+                             uint32_t offset_size, uint32_t index_size,
+                             uint32_t *index, uint64_t *tag);
+
+/**
+ * Splits the records of a batch into index and tag and orders them by set
+ * with a stable counting sort on the top SET_BUCKET_BITS of the index,
+ * so records of the same set keep their trace order. A cache of no more
+ * than 2^SET_BUCKET_BITS sets gets one bucket per set; a larger one
+ * buckets runs of neighbouring sets together.
+ *
+ * @param records The records.
+ * @param count Number of records (below 2^32).
+ * @param offset_size Bits of block offset.
+ * @param index_size Bits of set index.
+ * @param buckets Receives the decomposed and ordered batch.
+ */
+void bucket_by_set(const TraceRecord *records, size_t count,
+                   uint32_t offset_size, uint32_t index_size,
+                   SetBuckets &buckets);
+
+#endif  // SET_BUCKETS_H
@@ -0,0 +1,103 @@
+#include "SetShards.h"
+
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "ChunkPipeline.h"
+
+/**
+ * Largest number of set shards usable with `threads` threads.
+ *
+ * @param config The cache being simulated.
+ * @param threads Number of threads available.
+ * @return Number of shards (1 means a plain serial simulation).
+ */
+unsigned set_shard_count(const CacheConfig& config, unsigned threads) {
+    unsigned shards = 1;
+    if (config.eviction == Eviction::OPT) {
+        return shards;
+    }
+    while (shards * 2 <= threads && shards * 2 <= config.sets) {
+        shards *= 2;
+    }
+    return shards;
+}
+
+/**
+ * Simulates a single cache with its sets split across threads.
+ *
+ * @param reader The trace.
+ * @param config The cache to simulate.
+ * @param shards Number of shards, from set_shard_count().
+ * @param stats Set to the merged counters of all shards.
+ * @param run Incremented by the number of records simulated.
+ * @param profile If not null, gains the misses of every shard.
+ * @return END once the trace is exhausted, otherwise the read error.
+ */
+TraceReader::Status simulate_set_shards(TraceReader& reader,
+                                        const CacheConfig& config,
+                                        unsigned shards, CacheStats& stats,
+                                        uint64_t& run, MissProfile* profile) {
+    const uint32_t offset_size = log2(config.bytes);
+    const uint32_t shard_size = log2(shards);
+    const uint64_t offset_mask = (uint64_t{1} << offset_size) - 1;
+    const uint64_t shard_mask = shards - 1;
+
+    // Each shard holds every shards-th set of the full cache
+    CacheConfig shard_config = config;
+    shard_config.sets = config.sets / shards;
+
+    std::vector<std::unique_ptr<Cache>> caches(shards);
+    std::vector<std::vector<TraceRecord>> local_chunks(shards);
+    std::vector<std::unique_ptr<MissProfile>> profiles(shards);
+
+    TraceReader::Status status = run_chunk_pipeline(
+        reader, shards,
+        [&](unsigned shard) {
+            caches[shard] = make_cache(shard_config);
+            if (profile) {
+                profiles[shard] =
+                    std::make_unique<MissProfile>(*profile, shard, shard_size);
+                caches[shard]->set_miss_profile(profiles[shard].get());
+            }
+        },
+        [&](unsigned shard, const std::vector<TraceRecord>& chunk) {
+            // Records of this shard, rewritten to shard-local addresses
+            std::vector<TraceRecord>& local_chunk = local_chunks[shard];
+            local_chunk.clear();
+
+            for (const TraceRecord& record : chunk) {
+                uint64_t address = record.address;
+                if (((address >> offset_size) & shard_mask) != shard) {
+                    continue;
+                }
+
+                // Drop the shard bits from the index: the shard's cache then
+                // indexes with the remaining index bits and sees the
+                // original tag
+                uint64_t local =
+                    ((address >> (offset_size + shard_size)) << offset_size) |
+                    (address & offset_mask);
+
+                local_chunk.push_back(
+                    {local, record.size, record.op, record.core});
+            }
+            caches[shard]->simulate(local_chunk.data(), local_chunk.size());
+        },
+        run);
+
+    stats = CacheStats();
+    for (std::unique_ptr<Cache>& cache : caches) {
+        stats += cache->get_stats();
+    }
+    if (profile) {
+        for (std::unique_ptr<MissProfile>& shard_profile : profiles) {
+            if (shard_profile) {
+                profile->merge(*shard_profile);
+            }
+        }
+    }
+    return status;
+}
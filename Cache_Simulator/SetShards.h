@@ -0,0 +1,48 @@
+#ifndef SET_SHARDS_H
+#define SET_SHARDS_H
+
+#include <cstdint>
+
+#include "Cache.h"
+#include "CacheConfig.h"
+#include "MissProfile.h"
+#include "TraceReader.h"
+
+/**
+ * Largest number of set shards usable with `threads` threads: a power of 2
+ * no larger than the thread count or the number of sets. OPT caches are
+ * never sharded, since they need the whole trace up front.
+ *
+ * @param config The cache being simulated.
+ * @param threads Number of threads available.
+ * @return Number of shards (1 means a plain serial simulation).
+ */
+unsigned set_shard_count(const CacheConfig &config, unsigned threads);
+
+/**
+ * Simulates a single cache with its sets split across threads.
+ *
+ * Sets never interact, so the cache is cut into `shards` interleaved groups
+ * of sets by the low index bits, and each group is simulated by its own
+ * Cache on its own thread. Every thread walks the shared decoded trace and
+ * keeps only the accesses that map to its sets, rewriting each address so
+ * the shard's smaller Cache sees the same tag and the remaining index bits.
+ * The shards' counters are summed at the end, which reproduces a serial run
+ * exactly.
+ *
+ * @param reader The trace.
+ * @param config The cache to simulate.
+ * @param shards Number of shards, from set_shard_count().
+ * @param stats Set to the merged counters of all shards.
+ * @param run Incremented by the number of records simulated.
+ * @param profile If not null, gains the misses of every shard, at their
+ * original addresses.
+ * @return END once the trace is exhausted, otherwise the read error.
+ */
+TraceReader::Status simulate_set_shards(TraceReader &reader,
+                                        const CacheConfig &config,
+                                        unsigned shards, CacheStats &stats,
+                                        uint64_t &run,
+                                        MissProfile *profile = nullptr);
+
+#endif  // SET_SHARDS_H
@@ -0,0 +1,233 @@
+#include "StackDistance.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "CacheConfig.h"
+#include "ErrorCodes.h"
+#include "TraceReader.h"
+
+/**
+ * @param sets Number of sets, a power of 2.
+ * @param bytes Block size in bytes, a power of 2.
+ * @param max_ways Largest associativity to report.
+ */
+StackDistance::StackDistance(uint32_t sets, uint32_t bytes, uint32_t max_ways)
+    : offset_size(log2(bytes)),
+      set_mask(sets - 1),
+      max_ways(max_ways),
+      stacks(sets),
+      load_distances(max_ways + 1),
+      store_distances(max_ways + 1) {}
+
+/**
+ * Records one access: computes its stack distance and moves the block to
+ * the top of its set's stack.
+ *
+ * @param store True for a store, false for a load.
+ * @param address Address accessed.
+ */
+void StackDistance::access(bool store, uint64_t address) {
+    uint64_t block = address >> offset_size;
+    SetStack& set = stacks[block & set_mask];
+
+    if (set.next == set.owner.size()) {
+        compact(set);
+    }
+
+    // Cold accesses count as farther than any associativity
+    uint32_t distance = max_ways;
+
+    auto found = position.find(block);
+    if (found != position.end()) {
+        uint32_t old = found->second;
+        uint32_t newer = set.live - tree_prefix(set, old);
+        if (newer < max_ways) {
+            distance = newer;
+        }
+
+        tree_add(set, old, -1);
+        set.owner[old] = NO_BLOCK;
+        --set.live;
+        found->second = set.next;
+    } else {
+        position.emplace(block, set.next);
+    }
+
+    tree_add(set, set.next, 1);
+    set.owner[set.next] = block;
+    ++set.next;
+    ++set.live;
+
+    if (store) {
+        ++stores;
+        ++store_distances[distance];
+    } else {
+        ++loads;
+        ++load_distances[distance];
+    }
+}
+
+/**
+ * Misses of every associativity. An access misses in a w-way cache when its
+ * distance is at least w, so the counts are the histogram's running
+ * complement.
+ *
+ * @param store True for store misses, false for load misses.
+ * @return max_ways miss counts.
+ */
+std::vector<uint64_t> StackDistance::miss_curve(bool store) const {
+    const std::vector<uint64_t>& distances =
+        store ? store_distances : load_distances;
+
+    std::vector<uint64_t> misses(max_ways);
+    uint64_t remaining = store ? stores : loads;
+    for (uint32_t ways = 1; ways <= max_ways; ++ways) {
+        remaining -= distances[ways - 1];
+        misses[ways - 1] = remaining;
+    }
+    return misses;
+}
+
+// Adds `delta` at position `pos` of a set's tree
+void StackDistance::tree_add(SetStack& set, uint32_t pos, int32_t delta) {
+    const uint32_t size = set.tree.size();
+    for (uint32_t i = pos + 1; i < size; i += i & (~i + 1)) {
+        set.tree[i] += delta;
+    }
+}
+
+// Number of marks at positions [0, pos]
+uint32_t StackDistance::tree_prefix(const SetStack& set, uint32_t pos) {
+    uint32_t sum = 0;
+    for (uint32_t i = pos + 1; i > 0; i -= i & (~i + 1)) {
+        sum += set.tree[i];
+    }
+    return sum;
+}
+
+/**
+ * Renumbers a full set's marked positions to 0..live-1 (keeping their
+ * order), updates the blocks' recorded positions, and rebuilds the tree with
+ * room for at least as many new positions again.
+ *
+ * @param set The set whose positions ran out.
+ */
+void StackDistance::compact(SetStack& set) {
+    uint32_t capacity = MIN_CAPACITY;
+    while (capacity < 2 * set.live) {
+        capacity *= 2;
+    }
+
+    std::vector<uint64_t> owner(capacity, NO_BLOCK);
+    uint32_t next = 0;
+    for (uint32_t pos = 0; pos < set.next; ++pos) {
+        if (set.owner[pos] != NO_BLOCK) {
+            owner[next] = set.owner[pos];
+            position[owner[next]] = next;
+            ++next;
+        }
+    }
+
+    // Linear-time Fenwick build over the dense marks
+    std::vector<uint32_t> tree(capacity + 1, 0);
+    for (uint32_t i = 1; i <= capacity; ++i) {
+        if (i <= next) {
+            tree[i] += 1;
+        }
+        uint32_t parent = i + (i & (~i + 1));
+        if (parent <= capacity) {
+            tree[parent] += tree[i];
+        }
+    }
+
+    set.owner.swap(owner);
+    set.tree.swap(tree);
+    set.next = next;
+}
+
+/**
+ * Prints the LRU miss-ratio curve of a trace.
+ *
+ * @param argc Argument count, starting at the subcommand name.
+ * @param argv Arguments, starting at the subcommand name.
+ * @return csim exit code.
+ */
+int run_stackdist(int argc, char** argv) {
+    if (argc != 4 && argc != 5) {
+        std::cerr << "Command Line Argument Format: csim stackdist "
+                  << "<num_sets> <block_size> <max_ways> [trace_file]"
+                  << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+
+    int set_num, block_size, max_ways;
+    try {
+        set_num = std::stoi(argv[1]);
+        block_size = std::stoi(argv[2]);
+        max_ways = std::stoi(argv[3]);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: Arguments must be integers." << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+
+    if (set_num <= 0 || block_size <= 0 || max_ways <= 0) {
+        std::cerr << "Error: All numeric arguments must be positive integers."
+                  << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+    if (!is_power_of_2(static_cast<uint32_t>(set_num))) {
+        std::cerr << "Error: Number of sets (" << set_num
+                  << ") must be a power of 2." << std::endl;
+        return INVALID_SET_NUM;
+    }
+    if (block_size < 4 || !is_power_of_2(static_cast<uint32_t>(block_size))) {
+        std::cerr << "Error: Block size (" << block_size
+                  << ") must be at least 4 and a power of 2." << std::endl;
+        return INVALID_BLOCK_SIZE;
+    }
+
+    int trace_fd = open_trace(argc == 5 ? argv[4] : "-");
+    if (trace_fd < 0) {
+        return INVALID_COMMAND_LINE;
+    }
+    TraceReader reader(trace_fd);
+
+    StackDistance analysis(set_num, block_size, max_ways);
+
+    TraceRecord record;
+    TraceReader::Status status;
+    uint64_t run = 0;
+    while ((status = reader.next(record)) == TraceReader::RECORD) {
+        analysis.access(record.op == 's', record.address);
+        ++run;
+    }
+
+    if (status != TraceReader::END) {
+        return report_trace_error(status, run);
+    }
+
+    std::vector<uint64_t> load_curve = analysis.miss_curve(false);
+    std::vector<uint64_t> store_curve = analysis.miss_curve(true);
+
+    std::cout << "ways,loads,stores,load_misses,store_misses,miss_ratio\n";
+    uint64_t accesses = analysis.get_loads() + analysis.get_stores();
+    for (uint32_t ways = 1; ways <= static_cast<uint32_t>(max_ways); ++ways) {
+        uint64_t load_misses = load_curve[ways - 1];
+        uint64_t store_misses = store_curve[ways - 1];
+        double ratio =
+            accesses ? double(load_misses + store_misses) / accesses : 0.0;
+
+        std::cout << ways << "," << analysis.get_loads() << ","
+                  << analysis.get_stores() << "," << load_misses << ","
+                  << store_misses << "," << ratio << "\n";
+    }
+    std::cout.flush();
+
+    return EXIT_SUCCESS;
+}
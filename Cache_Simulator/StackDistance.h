@@ -0,0 +1,111 @@
+#ifndef STACK_DISTANCE_H
+#define STACK_DISTANCE_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * One-pass LRU stack-distance (Mattson) analysis.
+ *
+ * For every access the analyzer computes the block's reuse distance within
+ * its set: the number of distinct blocks of the same set touched since the
+ * block's previous access. Because LRU has the inclusion property, an access
+ * hits in a W-way LRU cache with the same set count and block size exactly
+ * when its distance is below W, so one pass yields the miss count of every
+ * associativity at once.
+ *
+ * The model is a write-allocate LRU cache: loads and stores both allocate
+ * and both count as uses.
+ */
+class StackDistance {
+public:
+    /**
+     * @param sets Number of sets, a power of 2.
+     * @param bytes Block size in bytes, a power of 2.
+     * @param max_ways Largest associativity to report.
+     */
+    StackDistance(uint32_t sets, uint32_t bytes, uint32_t max_ways);
+
+    /**
+     * Records one access.
+     *
+     * @param store True for a store, false for a load.
+     * @param address Address accessed.
+     */
+    void access(bool store, uint64_t address);
+
+    /**
+     * @return Total loads / stores recorded
+     */
+    uint64_t get_loads() const { return loads; }
+    uint64_t get_stores() const { return stores; }
+
+    /**
+     * Misses of every associativity: element w - 1 is the number of loads
+     * (or stores) a w-way LRU cache would have missed on.
+     *
+     * @param store True for store misses, false for load misses.
+     * @return max_ways miss counts.
+     */
+    std::vector<uint64_t> miss_curve(bool store) const;
+
+private:
+    /**
+     * Per-set recency state: a Fenwick tree over the set's access positions
+     * with a 1 at the latest position of every block. The distance of a block
+     * last used at position p is the number of marks after p. When the
+     * positions run out, the live marks are renumbered densely, so the tree
+     * only ever grows with the set's footprint, not the trace length.
+     */
+    struct SetStack {
+        std::vector<uint32_t> tree;   // Fenwick tree (1-based)
+        std::vector<uint64_t> owner;  // Block marked at each position
+        uint32_t next = 0;            // Next free position
+        uint32_t live = 0;            // Number of marked positions
+    };
+
+    // Adds `delta` at position `pos` of a set's tree
+    static void tree_add(SetStack &set, uint32_t pos, int32_t delta);
+
+    // Number of marks at positions [0, pos]
+    static uint32_t tree_prefix(const SetStack &set, uint32_t pos);
+
+    // Renumbers a full set's live positions densely and regrows its tree
+    void compact(SetStack &set);
+
+    // Marks in owner[] for a position whose block has moved on
+    static constexpr uint64_t NO_BLOCK = UINT64_MAX;
+
+    // Smallest tree a set is given
+    static const uint32_t MIN_CAPACITY = 64;
+
+    const uint32_t offset_size;
+    const uint32_t set_mask;
+    const uint32_t max_ways;
+
+    std::vector<SetStack> stacks;
+
+    // Latest position of every block seen so far
+    std::unordered_map<uint64_t, uint32_t> position;
+
+    // Accesses by distance: [0, max_ways) exact, max_ways = farther or cold
+    std::vector<uint64_t> load_distances;
+    std::vector<uint64_t> store_distances;
+
+    uint64_t loads = 0;
+    uint64_t stores = 0;
+};
+
+/**
+ * `csim stackdist <num_sets> <block_size> <max_ways> [trace_file]`: prints
+ * the LRU (write-allocate) miss counts and miss ratio of every associativity
+ * from 1 to max_ways, as CSV, from one pass over the trace.
+ *
+ * @param argc Argument count, starting at the subcommand name.
+ * @param argv Arguments, starting at the subcommand name.
+ * @return csim exit code.
+ */
+int run_stackdist(int argc, char **argv);
+
+#endif  // STACK_DISTANCE_H
@@ -0,0 +1,202 @@
+#include "Sweep.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Cache.h"
+#include "ChunkPipeline.h"
+#include "ErrorCodes.h"
+#include "TraceReader.h"
+
+/**
+ * Expands a sweep specification into cache configurations.
+ *
+ * @param spec The specification.
+ * @param configs The expanded configurations are appended here.
+ * @return 0 on success, otherwise the csim exit code for the problem.
+ */
+int expand_sweep_spec(const std::string& spec,
+                      std::vector<CacheConfig>& configs) {
+    std::vector<std::string> fields = split(spec, ':');
+    if (fields.size() != 6) {
+        std::cerr << "Error: Sweep specification '" << spec
+                  << "' must have 6 ':'-separated parameters." << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+
+    std::vector<std::vector<std::string>> values;
+    for (const std::string& field : fields) {
+        values.push_back(split(field, ','));
+    }
+    bool policy_grid = values[3].size() > 1 || values[4].size() > 1;
+
+    // Odometer over every combination of values, last parameter fastest
+    std::vector<size_t> position(values.size(), 0);
+    for (;;) {
+        std::vector<std::string> combination;
+        for (size_t i = 0; i < values.size(); ++i) {
+            combination.push_back(values[i][position[i]]);
+        }
+
+        bool skip = policy_grid && to_lower(combination[3]) ==
+                                       "no-write-allocate" &&
+                    to_lower(combination[4]) == "write-back";
+        if (!skip) {
+            CacheConfig config;
+            int error = parse_cache_config(combination, config);
+            if (error != 0) {
+                return error;
+            }
+            if (config.eviction == Eviction::OPT) {
+                // OPT needs the whole trace, which a sweep never holds
+                std::cerr << "Error: opt cannot be swept; run it as a "
+                             "single cache."
+                          << std::endl;
+                return INVALID_EVICTION;
+            }
+            configs.push_back(config);
+        }
+
+        size_t i = values.size();
+        while (i > 0 && ++position[i - 1] == values[i - 1].size()) {
+            position[--i] = 0;
+        }
+        if (i == 0) {
+            return 0;
+        }
+    }
+}
+
+/**
+ * Simulates many cache configurations over one pass of a trace.
+ *
+ * @param argc Argument count, starting at the subcommand name.
+ * @param argv Arguments, starting at the subcommand name.
+ * @return csim exit code.
+ */
+int run_sweep(int argc, char** argv) {
+    std::string trace_file = "-";
+    std::vector<CacheConfig> configs;
+    unsigned jobs = std::thread::hardware_concurrency();
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+
+        if ((arg == "-t" || arg == "-c" || arg == "-j") && i + 1 == argc) {
+            std::cerr << "Error: " << arg << " needs a value." << std::endl;
+            return INVALID_COMMAND_LINE;
+        }
+
+        int error = 0;
+        if (arg == "-j") {
+            try {
+                int value = std::stoi(argv[++i]);
+                if (value <= 0) {
+                    throw std::invalid_argument(argv[i]);
+                }
+                jobs = static_cast<unsigned>(value);
+            } catch (const std::exception& e) {
+                std::cerr << "Error: -j must be a positive integer."
+                          << std::endl;
+                return INVALID_COMMAND_LINE;
+            }
+        } else if (arg == "-t") {
+            trace_file = argv[++i];
+        } else if (arg == "-c") {
+            // One specification per line; blank lines and # comments ignored
+            std::ifstream config_file(argv[++i]);
+            if (!config_file) {
+                std::cerr << "Error: Unable to open config file '" << argv[i]
+                          << "'." << std::endl;
+                return INVALID_COMMAND_LINE;
+            }
+            std::string line;
+            while (error == 0 && std::getline(config_file, line)) {
+                std::istringstream words(line);
+                std::string spec;
+                if (words >> spec && spec[0] != '#') {
+                    error = expand_sweep_spec(spec, configs);
+                }
+            }
+        } else {
+            error = expand_sweep_spec(arg, configs);
+        }
+
+        if (error != 0) {
+            return error;
+        }
+    }
+
+    if (configs.empty()) {
+        std::cerr << "Command Line Argument Format: csim sweep "
+                  << "[-j jobs] [-t trace_file] [-c config_file] <spec>...\n"
+                  << "  <spec> = <sets>:<blocks>:<block_size>:<miss_type>:"
+                  << "<hit_type>:<eviction>, each a ','-separated list"
+                  << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+
+    int trace_fd = open_trace(trace_file);
+    if (trace_fd < 0) {
+        return INVALID_COMMAND_LINE;
+    }
+    TraceReader reader(trace_fd);
+
+    // Never start more workers than there are caches to give them
+    if (jobs == 0) {
+        jobs = 1;
+    }
+    if (jobs > configs.size()) {
+        jobs = static_cast<unsigned>(configs.size());
+    }
+
+    // Parse the trace once, handing each chunk to every cache. Worker w owns
+    // every jobs-th cache and builds it on its own thread, so its state is
+    // allocated apart from every other worker's
+    std::vector<std::unique_ptr<Cache>> caches(configs.size());
+    uint64_t run = 0;
+
+    TraceReader::Status status = run_chunk_pipeline(
+        reader, jobs,
+        [&](unsigned w) {
+            for (size_t i = w; i < configs.size(); i += jobs) {
+                caches[i] = make_cache(configs[i]);
+            }
+        },
+        [&](unsigned w, const std::vector<TraceRecord>& chunk) {
+            for (size_t i = w; i < configs.size(); i += jobs) {
+                caches[i]->simulate(chunk.data(), chunk.size());
+            }
+        },
+        run);
+
+    if (status != TraceReader::END) {
+        return report_trace_error(status, run);
+    }
+
+    // One summary row per configuration
+    std::cout << "sets,blocks,block_size,miss_type,hit_type,eviction,"
+              << "loads,stores,load_hits,load_misses,store_hits,store_misses,"
+              << "cycles\n";
+    for (size_t i = 0; i < caches.size(); ++i) {
+        Cache& cache = *caches[i];
+        std::cout << describe_config(configs[i], ",") << ","
+                  << cache.get_loads() << "," << cache.get_stores() << ","
+                  << cache.get_load_hits() << "," << cache.get_load_misses()
+                  << "," << cache.get_store_hits() << ","
+                  << cache.get_store_misses() << "," << cache.get_cycles()
+                  << "\n";
+    }
+    std::cout.flush();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,41 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <string>
+#include <vector>
+
+#include "CacheConfig.h"
+
+/**
+ * Expands a sweep specification into cache configurations.
+ *
+ * A specification has the six cache parameters separated by ':', and each
+ * parameter may be a ','-separated list of values. The specification stands
+ * for every combination of the listed values, e.g.
+ *
+ *   64,256:1,2,4:16:write-allocate:write-back:lru,fifo
+ *
+ * is 2 x 3 x 2 = 12 caches. Write-back/no-write-allocate combinations that
+ * only arise from expanding lists are skipped.
+ *
+ * @param spec The specification.
+ * @param configs The expanded configurations are appended here.
+ * @return 0 on success, otherwise the csim exit code for the problem.
+ */
+int expand_sweep_spec(const std::string &spec,
+                      std::vector<CacheConfig> &configs);
+
+/**
+ * `csim sweep [-j jobs] [-t trace_file] [-c config_file] <spec>...`:
+ * simulates every configuration named by the specifications (and the lines
+ * of the config file) over a single pass of the trace, printing one CSV row
+ * per cache. The caches are split across `jobs` threads (one per core by
+ * default) that share the decoded trace.
+ *
+ * @param argc Argument count, starting at the subcommand name.
+ * @param argv Arguments, starting at the subcommand name.
+ * @return csim exit code.
+ */
+int run_sweep(int argc, char **argv);
+
+#endif  // SWEEP_H
@@ -0,0 +1,124 @@
+#ifndef TRACE_FORMAT_H
+#define TRACE_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Packed binary trace format.
+ *
+ * A binary trace starts with a 16-byte header:
+ *
+ *   bytes 0-7    magic "\x89CSIMTR\n"
+ *   bytes 8-9    format version (little endian)
+ *   bytes 10-15  reserved, zero
+ *
+ * followed by one variable-length record per access. Each record is a
+ * LEB128 varint key
+ *
+ *   key = zigzag(address - previous address) << 3 | size_changed << 2 | op
+ *
+ * where op is 0 for a load, 1 for a store and 2 for an instruction fetch,
+ * optionally followed by a
+ * zigzag varint of the new access size when size_changed is set. The
+ * previous address starts at 0 and the previous size at 4, so a trace with
+ * local accesses and a constant size costs one or two bytes per access.
+ *
+ * Multi-core traces switch cores with a record of op 3, which is not an
+ * access: its key is `core << 3 | 3`, and the following records belong to
+ * that core. Records belong to core 0 until the first switch, so traces
+ * without cores never contain one.
+ *
+ * A jump of 2^60 or more does not fit in a key. It is written as an
+ * address record, key `1 << 2 | 3`, followed by a varint of the new
+ * previous address, and then the access with a delta of 0. Address records
+ * are new in version 2; version 1 traces are still read.
+ */
+namespace trace_format {
+
+// Magic number identifying a binary trace
+const unsigned char MAGIC[8] = {0x89, 'C', 'S', 'I', 'M', 'T', 'R', '\n'};
+
+const uint16_t VERSION = 2;
+const uint16_t MIN_VERSION = 1;  // Oldest version still read
+const size_t HEADER_SIZE = 16;
+
+// Operation codes stored in the low bits of a record key
+const uint64_t OP_LOAD = 0;
+const uint64_t OP_STORE = 1;
+const uint64_t OP_FETCH = 2;
+const uint64_t OP_CORE = 3;  // Core switch, not an access
+const uint64_t OP_MASK = 3;
+
+// Key of an address record: op 3 with the size-changed bit set
+const uint64_t ADDRESS_RECORD = 1 << 2 | OP_CORE;
+
+const uint64_t SIZE_CHANGED = 1 << 2;
+const unsigned KEY_SHIFT = 3;
+
+// Decoder state before the first record
+const uint64_t INITIAL_ADDRESS = 0;
+const int INITIAL_SIZE = 4;
+
+// Largest core id a trace may name
+const uint64_t MAX_CORE = UINT16_MAX;
+
+// Longest possible encoding of one record (two 64-bit varints)
+const size_t MAX_RECORD_SIZE = 20;
+
+// Maps a signed value onto an unsigned one so small magnitudes stay small
+inline uint64_t zigzag_encode(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^
+           static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t zigzag_decode(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+/**
+ * Writes a LEB128 varint.
+ *
+ * @param out Destination, with room for at least 10 bytes.
+ * @param value Value to encode.
+ * @return Pointer just past the encoded bytes.
+ */
+inline unsigned char *put_varint(unsigned char *out, uint64_t value) {
+    while (value >= 0x80) {
+        *out++ = static_cast<unsigned char>(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = static_cast<unsigned char>(value);
+    return out;
+}
+
+/**
+ * Reads a LEB128 varint.
+ *
+ * @param in Start of the encoded bytes.
+ * @param end End of the available input.
+ * @param value Set to the decoded value.
+ * @return Pointer just past the varint, or nullptr if it is truncated,
+ * longer than 10 bytes or larger than 64 bits.
+ */
+inline const unsigned char *get_varint(const unsigned char *in,
+                                       const unsigned char *end,
+                                       uint64_t &value) {
+    uint64_t result = 0;
+    for (unsigned shift = 0; shift < 64 && in < end; shift += 7) {
+        uint64_t byte = *in++;
+        if (shift == 63 && byte > 1) {
+            return nullptr;
+        }
+        result |= (byte & 0x7f) << shift;
+        if (byte < 0x80) {
+            value = result;
+            return in;
+        }
+    }
+    return nullptr;
+}
+
+}  // namespace trace_format
+
+#endif  // TRACE_FORMAT_H
@@ -0,0 +1,518 @@
+#include "TraceGenerator.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CacheConfig.h"
+#include "ChunkPipeline.h"
+#include "ErrorCodes.h"
+#include "TraceReader.h"
+#include "TraceWriter.h"
+
+namespace {
+
+const uint64_t GOLDEN = 0x9E3779B97F4A7C15ull;
+
+// Finalizer of splitmix64: a bijective mix of all 64 bits
+uint64_t mix(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+/**
+ * splitmix64: tiny, fast, and seedable with any value, which makes it easy
+ * to give every chunk its own independent stream.
+ */
+class Random {
+public:
+    Random(uint64_t seed, uint64_t stream) : state(mix(seed) ^ mix(~stream)) {}
+
+    uint64_t next() { return mix(state += GOLDEN); }
+
+    // Uniform in [0, 1)
+    double uniform() { return (next() >> 11) * 0x1.0p-53; }
+
+private:
+    uint64_t state;
+};
+
+/**
+ * A keyed pseudo-random bijection of [0, count), computed without tables:
+ * invertible mixing rounds over the smallest power of 2 holding `count`,
+ * repeated ("cycle walking") until the value falls inside the range.
+ */
+class Permutation {
+public:
+    Permutation(uint64_t count, uint64_t key) : count(count) {
+        while (bits < 64 && (uint64_t{1} << bits) < count) {
+            ++bits;
+        }
+        mask = bits == 64 ? ~uint64_t{0} : (uint64_t{1} << bits) - 1;
+        for (uint64_t& round_key : keys) {
+            round_key = mix(key += GOLDEN);
+        }
+    }
+
+    uint64_t operator()(uint64_t value) const {
+        if (bits == 0) {
+            return 0;
+        }
+        do {
+            for (uint64_t round_key : keys) {
+                value = (value + round_key) & mask;
+                value = (value * (round_key | 1)) & mask;
+                value ^= value >> ((bits + 1) / 2);
+            }
+        } while (value >= count);
+        return value;
+    }
+
+private:
+    uint64_t count;
+    uint32_t bits = 0;
+    uint64_t mask;
+    uint64_t keys[3];
+};
+
+/**
+ * Draws ranks in [1, count] with P(k) proportional to k^-exponent, by
+ * rejection-inversion (Hörmann and Derflinger), which needs no table and
+ * so works for any number of keys.
+ */
+class ZipfSampler {
+public:
+    ZipfSampler(uint64_t count, double exponent)
+        : count(count), exponent(exponent) {
+        h_integral_x1 = h_integral(1.5) - 1.0;
+        h_integral_count = h_integral(count + 0.5);
+        s = 2.0 - h_integral_inverse(h_integral(2.5) - h(2.0));
+    }
+
+    uint64_t operator()(Random& random) const {
+        for (;;) {
+            double u = h_integral_count +
+                       random.uniform() * (h_integral_x1 - h_integral_count);
+            double x = h_integral_inverse(u);
+            double k = std::floor(x + 0.5);
+            if (k < 1.0) {
+                k = 1.0;
+            } else if (k > count) {
+                k = static_cast<double>(count);
+            }
+            if (k - x <= s || u >= h_integral(k + 0.5) - h(k)) {
+                return static_cast<uint64_t>(k);
+            }
+        }
+    }
+
+private:
+    double h(double x) const { return std::exp(-exponent * std::log(x)); }
+
+    double h_integral(double x) const {
+        double log_x = std::log(x);
+        return helper2((1.0 - exponent) * log_x) * log_x;
+    }
+
+    double h_integral_inverse(double x) const {
+        double t = x * (1.0 - exponent);
+        if (t < -1.0) {
+            t = -1.0;
+        }
+        return std::exp(helper1(t) * x);
+    }
+
+    // log(1 + x) / x, accurate near 0
+    static double helper1(double x) {
+        return std::fabs(x) > 1e-8
+                   ? std::log1p(x) / x
+                   : 1.0 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x));
+    }
+
+    // (exp(x) - 1) / x, accurate near 0
+    static double helper2(double x) {
+        return std::fabs(x) > 1e-8
+                   ? std::expm1(x) / x
+                   : 1.0 + x * 0.5 * (1.0 + x / 3.0 * (1.0 + 0.25 * x));
+    }
+
+    uint64_t count;
+    double exponent;
+    double h_integral_x1;
+    double h_integral_count;
+    double s;
+};
+
+/**
+ * Generated chunks on their way from a generating thread to the writer:
+ * the first record as is, the rest already encoded as following it.
+ * Chunk n goes through slot n % slots, and is that slot's use n / slots.
+ */
+struct GeneratedSlot {
+    TraceRecord first;
+    TraceRecord last;
+    std::vector<unsigned char> encoded;
+    std::atomic<uint64_t> filled{0};   // Uses whose chunk is ready
+    std::atomic<uint64_t> drained{0};  // Uses whose chunk was written
+};
+
+// Parses a byte count with an optional K, M or G suffix
+bool parse_bytes(const std::string& text, uint64_t& bytes) {
+    try {
+        size_t end = 0;
+        long long value = std::stoll(text, &end);
+        uint64_t scale = 1;
+        std::string suffix = to_lower(text.substr(end));
+        if (suffix == "k") {
+            scale = uint64_t{1} << 10;
+        } else if (suffix == "m") {
+            scale = uint64_t{1} << 20;
+        } else if (suffix == "g") {
+            scale = uint64_t{1} << 30;
+        } else if (!suffix.empty()) {
+            return false;
+        }
+        if (value <= 0) {
+            return false;
+        }
+        bytes = static_cast<uint64_t>(value) * scale;
+        return true;
+    } catch (const std::exception& e) {
+        return false;
+    }
+}
+
+}  // namespace
+
+/**
+ * Generates one chunk of a trace.
+ *
+ * @param config The trace.
+ * @param chunk Number of the chunk.
+ * @param records Replaced with the chunk's records.
+ */
+void generate_chunk(const GeneratorConfig& config, uint64_t chunk,
+                    std::vector<TraceRecord>& records) {
+    uint64_t first = chunk * GENERATOR_CHUNK;
+    uint64_t count = first < config.accesses
+                         ? std::min<uint64_t>(GENERATOR_CHUNK,
+                                              config.accesses - first)
+                         : 0;
+    records.resize(count);
+
+    Random random(config.seed, chunk);
+    int size = static_cast<int>(config.size);
+    bool stores = config.store_ratio > 0.0;
+    auto op = [&]() {
+        return stores && random.uniform() < config.store_ratio ? 's' : 'l';
+    };
+
+    switch (config.pattern) {
+        case TracePattern::SEQUENTIAL:
+            for (uint64_t i = 0; i < count; ++i) {
+                uint64_t offset = (first + i) * config.size % config.footprint;
+                records[i] = {config.base + offset, size, op(), 0};
+            }
+            break;
+
+        case TracePattern::STRIDED:
+            for (uint64_t i = 0; i < count; ++i) {
+                uint64_t offset =
+                    (first + i) * config.stride % config.footprint;
+                records[i] = {config.base + offset, size, op(), 0};
+            }
+            break;
+
+        case TracePattern::MATMUL: {
+            // C[i][j] += A[i][k] * B[k][j]: load A, load B, load C, store C
+            uint64_t n = config.matrix;
+            uint64_t matrix_bytes = n * n * config.size;
+            uint64_t a = config.base;
+            uint64_t b = a + matrix_bytes;
+            uint64_t c = b + matrix_bytes;
+            for (uint64_t i = 0; i < count; ++i) {
+                uint64_t step = (first + i) / 4 % (n * n * n);
+                uint64_t row = step / (n * n);
+                uint64_t column = step / n % n;
+                uint64_t inner = step % n;
+                switch ((first + i) % 4) {
+                    case 0:
+                        records[i] = {a + (row * n + inner) * config.size,
+                                      size, 'l', 0};
+                        break;
+                    case 1:
+                        records[i] = {b + (inner * n + column) * config.size,
+                                      size, 'l', 0};
+                        break;
+                    default:
+                        records[i] = {c + (row * n + column) * config.size,
+                                      size, (first + i) % 4 == 3 ? 's' : 'l',
+                                      0};
+                        break;
+                }
+            }
+            break;
+        }
+
+        case TracePattern::ZIPF: {
+            // Each lookup reads the key's bucket pointer, then its entry;
+            // chunks hold whole lookups since GENERATOR_CHUNK is even
+            uint64_t entries = config.footprint / config.stride;
+            uint64_t buckets = config.base + entries * config.stride;
+            ZipfSampler zipf(entries, config.zipf_exponent);
+            Permutation hash(entries, config.seed);
+            uint64_t slot = 0;
+            for (uint64_t i = 0; i < count; ++i) {
+                if ((first + i) % 2 == 0) {
+                    slot = hash(zipf(random) - 1);
+                    records[i] = {buckets + slot * 8, 8, 'l', 0};
+                } else {
+                    records[i] = {config.base + slot * config.stride, size,
+                                  op(), 0};
+                }
+            }
+            break;
+        }
+
+        case TracePattern::CHASE: {
+            // The list visits the nodes in the order of a permutation, so
+            // the node at any step is known without walking to it
+            uint64_t nodes = config.footprint / config.stride;
+            Permutation order(nodes, ~config.seed);
+            for (uint64_t i = 0; i < count; ++i) {
+                uint64_t node = order((first + i) % nodes);
+                records[i] = {config.base + node * config.stride, size, op(),
+                              0};
+            }
+            break;
+        }
+    }
+}
+
+/**
+ * Generates a whole trace on `threads` threads and writes it in order.
+ * Chunks are dealt out round-robin, and each thread encodes its chunks as
+ * well, so the writing thread only copies bytes.
+ *
+ * @param config The trace.
+ * @param threads Number of generating threads.
+ * @param writer Receives the records.
+ */
+void generate_trace(const GeneratorConfig& config, unsigned threads,
+                    TraceWriter& writer) {
+    uint64_t chunks = (config.accesses + GENERATOR_CHUNK - 1) / GENERATOR_CHUNK;
+    if (threads <= 1 || chunks <= 1) {
+        std::vector<TraceRecord> records;
+        for (uint64_t chunk = 0; chunk < chunks; ++chunk) {
+            generate_chunk(config, chunk, records);
+            for (const TraceRecord& record : records) {
+                writer.write(record);
+            }
+        }
+        return;
+    }
+
+    // Two slots per thread, so a thread can fill one while the other waits
+    // to be written
+    size_t slot_count = 2 * static_cast<size_t>(threads);
+    std::vector<GeneratedSlot> slots(slot_count);
+    bool binary = writer.is_binary();
+
+    std::vector<std::thread> workers;
+    for (unsigned w = 0; w < threads; ++w) {
+        workers.emplace_back([&, w] {
+            std::vector<TraceRecord> records;
+            for (uint64_t chunk = w; chunk < chunks; chunk += threads) {
+                GeneratedSlot& slot = slots[chunk % slot_count];
+                uint64_t use = chunk / slot_count;
+                generate_chunk(config, chunk, records);
+
+                wait_for([&] {
+                    return slot.drained.load(std::memory_order_acquire) == use;
+                });
+                TraceEncoder encoder(binary);
+                encoder.resume(records.front());
+                slot.encoded.resize(records.size() *
+                                    TraceEncoder::MAX_RECORD_SIZE);
+                unsigned char* out = slot.encoded.data();
+                for (size_t i = 1; i < records.size(); ++i) {
+                    out = encoder.encode(out, records[i]);
+                }
+                slot.encoded.resize(
+                    static_cast<size_t>(out - slot.encoded.data()));
+                slot.first = records.front();
+                slot.last = records.back();
+                slot.filled.store(use + 1, std::memory_order_release);
+            }
+        });
+    }
+
+    for (uint64_t chunk = 0; chunk < chunks; ++chunk) {
+        GeneratedSlot& slot = slots[chunk % slot_count];
+        uint64_t use = chunk / slot_count;
+        wait_for([&] {
+            return slot.filled.load(std::memory_order_acquire) == use + 1;
+        });
+        writer.write(slot.first);
+        writer.write_encoded(slot.encoded.data(), slot.encoded.size(),
+                             slot.last);
+        slot.drained.store(use + 1, std::memory_order_release);
+    }
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+/**
+ * Writes a synthetic trace.
+ *
+ * @param argc Argument count, starting at the subcommand name.
+ * @param argv Arguments, starting at the subcommand name.
+ * @return csim exit code.
+ */
+int run_generate(int argc, char** argv) {
+    GeneratorConfig config;
+    unsigned threads = std::thread::hardware_concurrency();
+    bool binary = false;
+
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-' && argv[arg][1] != '\0'; ++arg) {
+        std::string option = argv[arg];
+        if (option == "-b") {
+            binary = true;
+            continue;
+        }
+        if (arg + 1 == argc) {
+            break;
+        }
+        std::string value = argv[++arg];
+
+        bool valid = true;
+        try {
+            if (option == "-s") {
+                config.seed = std::stoull(value);
+            } else if (option == "-j") {
+                int jobs = std::stoi(value);
+                valid = jobs > 0;
+                threads = static_cast<unsigned>(jobs);
+            } else if (option == "-f") {
+                valid = parse_bytes(value, config.footprint);
+            } else if (option == "-S") {
+                uint64_t stride = 0;
+                valid = parse_bytes(value, stride) && stride <= UINT32_MAX;
+                config.stride = static_cast<uint32_t>(stride);
+            } else if (option == "-z") {
+                int size = std::stoi(value);
+                valid = size > 0;
+                config.size = static_cast<uint32_t>(size);
+            } else if (option == "-n") {
+                int matrix = std::stoi(value);
+                valid = matrix > 0;
+                config.matrix = static_cast<uint32_t>(matrix);
+            } else if (option == "-e") {
+                config.zipf_exponent = std::stod(value);
+                valid = config.zipf_exponent > 0.0;
+            } else if (option == "-w") {
+                config.store_ratio = std::stod(value);
+                valid = config.store_ratio >= 0.0 && config.store_ratio <= 1.0;
+            } else if (option == "-a") {
+                config.base = std::stoull(value, nullptr, 16);
+            } else {
+                std::cerr << "Error: Unknown option '" << option << "'."
+                          << std::endl;
+                return INVALID_COMMAND_LINE;
+            }
+        } catch (const std::exception& e) {
+            valid = false;
+        }
+        if (!valid) {
+            std::cerr << "Error: Invalid value '" << value << "' for "
+                      << option << "." << std::endl;
+            return INVALID_COMMAND_LINE;
+        }
+    }
+
+    if (argc - arg != 3) {
+        std::cerr << "Command Line Argument Format: csim generate [-s seed] "
+                  << "[-j threads] [-b] [-f footprint] [-S stride] "
+                  << "[-z access_size] [-n matrix_size] [-e zipf_exponent] "
+                  << "[-w store_ratio] [-a hex_base] "
+                  << "<seq|stride|matmul|zipf|chase> <accesses> <output|->"
+                  << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+
+    std::string pattern = to_lower(argv[arg]);
+    if (pattern == "seq") {
+        config.pattern = TracePattern::SEQUENTIAL;
+    } else if (pattern == "stride") {
+        config.pattern = TracePattern::STRIDED;
+    } else if (pattern == "matmul") {
+        config.pattern = TracePattern::MATMUL;
+    } else if (pattern == "zipf") {
+        config.pattern = TracePattern::ZIPF;
+    } else if (pattern == "chase") {
+        config.pattern = TracePattern::CHASE;
+    } else {
+        std::cerr << "Error: Unknown pattern '" << argv[arg] << "'."
+                  << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+
+    try {
+        long long accesses = std::stoll(argv[arg + 1]);
+        if (accesses <= 0) {
+            throw std::invalid_argument(argv[arg + 1]);
+        }
+        config.accesses = static_cast<uint64_t>(accesses);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: Accesses must be a positive integer."
+                  << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+    if (config.stride == 0 || config.footprint < config.stride ||
+        config.footprint < config.size) {
+        std::cerr << "Error: Footprint must hold at least one stride and one "
+                  << "access." << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+
+    std::string output = argv[arg + 2];
+    int out_fd = STDOUT_FILENO;
+    if (output != "-") {
+        out_fd = open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (out_fd < 0) {
+            std::cerr << "Error: Unable to create trace file '" << output
+                      << "'." << std::endl;
+            return INVALID_COMMAND_LINE;
+        }
+    }
+
+    bool written;
+    {
+        TraceWriter writer(out_fd, binary);
+        generate_trace(config, threads == 0 ? 1 : threads, writer);
+        written = writer.flush();
+    }
+    if (out_fd != STDOUT_FILENO) {
+        written = close(out_fd) == 0 && written;
+    }
+    if (!written) {
+        std::cerr << "Error: Unable to write trace file '" << output << "'."
+                  << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+    return EXIT_SUCCESS;
+}
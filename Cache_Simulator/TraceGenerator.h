@@ -0,0 +1,78 @@
+#ifndef TRACE_GENERATOR_H
+#define TRACE_GENERATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "TraceReader.h"
+#include "TraceWriter.h"
+
+/**
+ * Access pattern models a trace can be generated from.
+ */
+enum class TracePattern {
+    SEQUENTIAL,  // Consecutive accesses through the footprint, wrapping
+    STRIDED,     // One access every `stride` bytes, wrapping
+    MATMUL,      // Naive ijk multiply of two `matrix` x `matrix` matrices
+    ZIPF,        // Hash table lookups of Zipf-distributed keys
+    CHASE        // A walk along a linked list shuffled over the footprint
+};
+
+/**
+ * Parameters of a generated trace. The trace is a pure function of them:
+ * the same configuration always gives the same trace, whatever the number
+ * of threads generating it.
+ */
+struct GeneratorConfig {
+    TracePattern pattern = TracePattern::SEQUENTIAL;
+    uint64_t accesses = 0;
+    uint64_t seed = 1;
+    uint64_t base = 0x10000000;           // Lowest address touched
+    uint64_t footprint = uint64_t{64} << 20;  // Bytes the pattern covers
+    uint32_t stride = 64;     // Stride, table entry or list node in bytes
+    uint32_t size = 4;        // Bytes per access (per matrix element)
+    uint32_t matrix = 256;    // Rows and columns of each matrix
+    double zipf_exponent = 0.99;
+    double store_ratio = 0.0;  // Share of stores, except in matmul
+};
+
+// Records generated per chunk; chunks are the unit of parallel work
+const size_t GENERATOR_CHUNK = 1 << 18;
+
+/**
+ * Generates one chunk of a trace: records [chunk * GENERATOR_CHUNK,
+ * (chunk + 1) * GENERATOR_CHUNK), cut short at the end of the trace. Every
+ * chunk draws from its own random stream seeded by the seed and its
+ * number, so chunks can be generated in any order and on any thread.
+ *
+ * @param config The trace.
+ * @param chunk Number of the chunk.
+ * @param records Replaced with the chunk's records.
+ */
+void generate_chunk(const GeneratorConfig &config, uint64_t chunk,
+                    std::vector<TraceRecord> &records);
+
+/**
+ * Generates a whole trace on `threads` threads (one chunk at a time each)
+ * and writes it, in order, from the calling thread.
+ *
+ * @param config The trace.
+ * @param threads Number of generating threads (at least 1).
+ * @param writer Receives the records.
+ */
+void generate_trace(const GeneratorConfig &config, unsigned threads,
+                    TraceWriter &writer);
+
+/**
+ * `csim generate [options] <pattern> <accesses> <output|->`: writes a
+ * synthetic trace, as a binary trace with -b and as text otherwise.
+ *
+ * @param argc Argument count, starting at the subcommand name.
+ * @param argv Arguments, starting at the subcommand name.
+ * @return csim exit code.
+ */
+int run_generate(int argc, char **argv);
+
+#endif  // TRACE_GENERATOR_H
@@ -0,0 +1,435 @@
+#include "TraceReader.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "Decompressor.h"
+#include "ErrorCodes.h"
+#include "TraceFormat.h"
+
+namespace {
+
+// Whitespace as skipped by formatted stream input
+inline bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Value of a hex digit, or -1 if c is not one
+inline int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Advances p past whitespace, stopping at end
+inline const char *skip_space(const char *p, const char *end) {
+    while (p < end && is_space(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+// Advances p to the end of the current field
+inline const char *skip_field(const char *p, const char *end) {
+    while (p < end && !is_space(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+}  // namespace
+
+/**
+ * Creates a reader over an open file descriptor. Regular files are mapped
+ * whole; anything else is streamed. Compression and the input format are
+ * detected from the first bytes.
+ *
+ * @param fd File descriptor to read the trace from.
+ */
+TraceReader::TraceReader(int fd)
+    : fd(fd),
+      prev_address(trace_format::INITIAL_ADDRESS),
+      prev_size(trace_format::INITIAL_SIZE) {
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        map_size = static_cast<size_t>(info.st_size);
+        map = mmap(nullptr, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (map != MAP_FAILED) {
+            madvise(map, map_size, MADV_SEQUENTIAL);
+            cur = static_cast<const char *>(map);
+            end = cur + map_size;
+            eof = true;  // The whole file is already in the window
+        } else {
+            map = nullptr;
+            map_size = 0;
+        }
+    }
+
+    if (map == nullptr) {
+        // Fall back to streaming through a buffer
+        buffer.resize(CHUNK_SIZE);
+        cur = end = buffer.data();
+    }
+
+    // Compressed input: stream what the decompression thread produces
+    fill(COMPRESSION_MAGIC_SIZE);
+    Compression compression =
+        detect_compression(cur, static_cast<size_t>(end - cur));
+    if (compression != Compression::NONE) {
+        decompressor = Decompressor::start(
+            compression, cur, static_cast<size_t>(end - cur),
+            map != nullptr ? -1 : fd);
+        buffer.resize(CHUNK_SIZE);
+        cur = end = buffer.data();
+        eof = (decompressor == nullptr);
+        io_failed = eof;
+    }
+
+    // Binary traces announce themselves with a magic number
+    fill(trace_format::HEADER_SIZE);
+    if (static_cast<size_t>(end - cur) >= trace_format::HEADER_SIZE &&
+        memcmp(cur, trace_format::MAGIC, sizeof(trace_format::MAGIC)) == 0) {
+        binary = true;
+        const unsigned char *version = reinterpret_cast<const unsigned char *>(
+            cur + sizeof(trace_format::MAGIC));
+        unsigned number = version[0] | version[1] << 8;
+        if (number >= trace_format::MIN_VERSION &&
+            number <= trace_format::VERSION) {
+            cur += trace_format::HEADER_SIZE;
+        } else {
+            // Nothing is decoded; the first read reports the bad format
+            bad_version = true;
+            cur = end;
+            eof = true;
+        }
+    }
+}
+
+// destructor
+TraceReader::~TraceReader() {
+    // The decompressor may still be reading the mapping
+    decompressor.reset();
+    if (map != nullptr) {
+        munmap(map, map_size);
+    }
+}
+
+/**
+ * Parses the next non-empty line of a text trace.
+ *
+ * @param record Filled with the parsed operation on success.
+ * @return RECORD on success, END at end of input, otherwise the error.
+ */
+TraceReader::Status TraceReader::next_text(TraceRecord &record) {
+    for (;;) {
+        const char *eol = static_cast<const char *>(
+            memchr(cur, '\n', static_cast<size_t>(end - cur)));
+
+        if (eol == nullptr) {
+            // Only a partial line is buffered: get more input, or treat the
+            // rest as the final line once the input is exhausted
+            if (!eof && refill()) {
+                continue;
+            }
+            if (io_failed) {
+                return IO_ERROR;
+            }
+            if (cur == end) {
+                return END;
+            }
+            eol = end;
+        }
+
+        const char *line = cur;
+        cur = (eol == end) ? end : eol + 1;
+
+        // Skip empty lines
+        if (line == eol) {
+            continue;
+        }
+        return parse_line(line, eol, record);
+    }
+}
+
+/**
+ * Decodes the next record of a binary trace.
+ *
+ * @param record Filled with the decoded operation on success.
+ * @return RECORD on success, END at end of input, otherwise the error.
+ */
+TraceReader::Status TraceReader::next_binary(TraceRecord &record) {
+    using namespace trace_format;
+
+    const unsigned char *in;
+    const unsigned char *limit;
+    uint64_t key;
+    for (;;) {
+        if (static_cast<size_t>(end - cur) < MAX_RECORD_SIZE) {
+            fill(MAX_RECORD_SIZE);
+            if (io_failed) {
+                return IO_ERROR;
+            }
+            if (cur == end) {
+                return bad_version ? BAD_FORMAT : END;
+            }
+        }
+
+        in = reinterpret_cast<const unsigned char *>(cur);
+        limit = reinterpret_cast<const unsigned char *>(end);
+        in = get_varint(in, limit, key);
+        if (in == nullptr) {
+            return BAD_FORMAT;
+        }
+        if ((key & OP_MASK) != OP_CORE) {
+            break;
+        }
+
+        if (key & SIZE_CHANGED) {
+            // Address record: the next delta starts from this address
+            if (key != ADDRESS_RECORD) {
+                return BAD_FORMAT;
+            }
+            in = get_varint(in, limit, prev_address);
+            if (in == nullptr) {
+                return BAD_FORMAT;
+            }
+        } else {
+            // Core switch: remember the core and decode the access after it
+            if ((key >> KEY_SHIFT) > MAX_CORE) {
+                return BAD_FORMAT;
+            }
+            prev_core = static_cast<uint16_t>(key >> KEY_SHIFT);
+        }
+        cur = reinterpret_cast<const char *>(in);
+    }
+
+    if (key & SIZE_CHANGED) {
+        uint64_t size;
+        in = get_varint(in, limit, size);
+        if (in == nullptr) {
+            return BAD_FORMAT;
+        }
+        prev_size = static_cast<int>(zigzag_decode(size));
+    }
+    cur = reinterpret_cast<const char *>(in);
+
+    switch (key & OP_MASK) {
+        case OP_LOAD:
+            record.op = 'l';
+            break;
+        case OP_STORE:
+            record.op = 's';
+            break;
+        case OP_FETCH:
+            record.op = 'i';
+            break;
+    }
+
+    prev_address += static_cast<uint64_t>(zigzag_decode(key >> KEY_SHIFT));
+    record.address = prev_address;
+    record.size = prev_size;
+    record.core = prev_core;
+    return RECORD;
+}
+
+/**
+ * Streams input until at least `bytes` bytes are buffered or the input ends.
+ * Does nothing for mapped files, which are always fully buffered.
+ *
+ * @param bytes Number of bytes wanted in the window.
+ */
+void TraceReader::fill(size_t bytes) {
+    while (!eof && static_cast<size_t>(end - cur) < bytes) {
+        refill();
+    }
+}
+
+/**
+ * Reads more input (or decompressed data) into the stream buffer, keeping
+ * the unparsed tail of the previous chunk at the front. The buffer grows if
+ * a single line fills it.
+ *
+ * @return True if more input was read, false at end of input or on error.
+ */
+bool TraceReader::refill() {
+    size_t pending = static_cast<size_t>(end - cur);
+    if (pending == buffer.size()) {
+        buffer.resize(buffer.size() * 2);
+    } else if (pending > 0) {
+        memmove(buffer.data(), cur, pending);
+    }
+
+    ssize_t got;
+    if (decompressor) {
+        got = static_cast<ssize_t>(decompressor->read(
+            buffer.data() + pending, buffer.size() - pending));
+        if (got == 0 && decompressor->failed()) {
+            got = -1;
+        }
+    } else {
+        do {
+            got = read(fd, buffer.data() + pending, buffer.size() - pending);
+        } while (got < 0 && errno == EINTR);
+    }
+
+    cur = buffer.data();
+    end = cur + pending;
+
+    if (got <= 0) {
+        eof = true;
+        io_failed = (got < 0);
+        return false;
+    }
+    end += got;
+    return true;
+}
+
+/**
+ * Parses one `<op> <hex address> <size> [<core>]` line. Fields may be
+ * separated by any whitespace. A fourth field must be the decimal core id;
+ * anything after it is ignored.
+ *
+ * @param p Start of the line.
+ * @param line_end End of the line (exclusive, newline not included).
+ * @param record Filled with the parsed operation on success.
+ * @return RECORD, BAD_FORMAT, BAD_OPERATOR or BAD_ADDRESS.
+ */
+TraceReader::Status TraceReader::parse_line(const char *p,
+                                            const char *line_end,
+                                            TraceRecord &record) {
+    // Split the line into its three fields first, like `iss >> a >> b >> c`
+    const char *op = skip_space(p, line_end);
+    const char *op_end = skip_field(op, line_end);
+    const char *addr = skip_space(op_end, line_end);
+    const char *addr_end = skip_field(addr, line_end);
+    const char *size = skip_space(addr_end, line_end);
+    const char *size_end = skip_field(size, line_end);
+
+    if (size == size_end) {
+        return BAD_FORMAT;
+    }
+
+    // Core: an optional unsigned decimal field after the size
+    const char *core = skip_space(size_end, line_end);
+    const char *core_end = skip_field(core, line_end);
+    uint32_t core_id = 0;
+    for (const char *d = core; d < core_end; ++d) {
+        if (*d < '0' || *d > '9') {
+            return BAD_FORMAT;
+        }
+        core_id = core_id * 10 + static_cast<uint32_t>(*d - '0');
+        if (core_id > trace_format::MAX_CORE) {
+            return BAD_FORMAT;
+        }
+    }
+    record.core = static_cast<uint16_t>(core_id);
+
+    // Size: an optionally signed decimal integer
+    const char *digit = size;
+    bool negative = false;
+    if (*digit == '-' || *digit == '+') {
+        negative = (*digit == '-');
+        ++digit;
+    }
+    if (digit == size_end || *digit < '0' || *digit > '9') {
+        return BAD_FORMAT;
+    }
+    // Built up in 64 bits and bounded every digit, so it cannot overflow
+    int64_t value = 0;
+    for (; digit < size_end && *digit >= '0' && *digit <= '9'; ++digit) {
+        value = value * 10 + (*digit - '0');
+        if (value > INT_MAX) {
+            return BAD_FORMAT;
+        }
+    }
+    record.size = static_cast<int>(negative ? -value : value);
+
+    // Operator: a single l, s or i, in either case
+    if (op_end - op != 1) {
+        return BAD_OPERATOR;
+    }
+    char c = *op | 0x20;  // ASCII lowercase
+    if (c != 'l' && c != 's' && c != 'i') {
+        return BAD_OPERATOR;
+    }
+    record.op = c;
+
+    // Address: hex digits with an optional 0x prefix, at most 64 bits
+    if (addr_end - addr > 2 && addr[0] == '0' && (addr[1] | 0x20) == 'x') {
+        addr += 2;
+    }
+    if (addr == addr_end || addr_end - addr > 16) {
+        return BAD_ADDRESS;
+    }
+    uint64_t address = 0;
+    for (; addr < addr_end; ++addr) {
+        int v = hex_value(*addr);
+        if (v < 0) {
+            return BAD_ADDRESS;
+        }
+        address = (address << 4) | static_cast<uint64_t>(v);
+    }
+    record.address = address;
+
+    return RECORD;
+}
+
+/**
+ * Opens a trace file for reading, reporting failures on standard error.
+ *
+ * @param path Path of the trace, or "-" for standard input.
+ * @return The open file descriptor, or -1 on failure.
+ */
+int open_trace(const std::string &path) {
+    if (path == "-") {
+        return STDIN_FILENO;
+    }
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Error: Unable to open trace file '" << path << "'."
+                  << std::endl;
+    }
+    return fd;
+}
+
+/**
+ * Reports a failed trace read on standard error.
+ *
+ * @param status The status returned by TraceReader::next (not RECORD/END).
+ * @param run Number of records processed before the failure.
+ * @return The csim exit code for the failure.
+ */
+int report_trace_error(TraceReader::Status status, uint64_t run) {
+    switch (status) {
+        case TraceReader::BAD_OPERATOR:
+            std::cerr << "operator must be of length 1. Either l for load, s "
+                         "for store or i for instruction fetch. Simulation run "
+                      << run << std::endl;
+            return INVALID_OPERATOR;
+        case TraceReader::BAD_ADDRESS:
+            std::cerr << "Invalid address: address must be a 64-bit hex "
+                         "representation. "
+                      << "Simulation run " << run << std::endl;
+            return INVALID_ADDRESS;
+        case TraceReader::IO_ERROR:
+            std::cerr << "Error reading trace. Simulation run " << run
+                      << std::endl;
+            return INVALID_COMMAND_LINE;
+        default:
+            std::cerr << "Invalid input format in line. Simulation run " << run
+                      << std::endl;
+            return INVALID_COMMAND_LINE;
+    }
+}
@@ -0,0 +1,145 @@
+#ifndef TRACE_READER_H
+#define TRACE_READER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Decompressor;
+
+/**
+ * One memory operation from a trace.
+ */
+struct TraceRecord {
+    uint64_t address;  // Address accessed
+    int size;          // Access size in bytes (informational)
+    char op;           // 'l' for load, 's' for store, 'i' for fetch
+    uint16_t core;     // Core that issued it (0 if the trace has no cores)
+};
+
+/**
+ * Reads `<op> <hex address> <size> [<core>]` trace lines without per-line
+ * allocation.
+ *
+ * Regular files (including stdin redirected from a file) are mapped into
+ * memory and parsed in place. Anything else, such as a pipe, is streamed
+ * through a large buffer that is refilled with read(2).
+ *
+ * Inputs that start with the binary trace magic number (see TraceFormat.h)
+ * are decoded as packed binary records instead of text.
+ *
+ * Compressed inputs (gzip, and zstd or lz4 when built in) are recognised by
+ * their own magic numbers and decompressed on a background thread (see
+ * Decompressor.h); the decompressed data is streamed through the buffer
+ * like a pipe, text or binary.
+ */
+class TraceReader {
+public:
+    /**
+     * Result of reading one trace line.
+     */
+    enum Status {
+        RECORD,      // A record was parsed
+        END,         // No more input
+        BAD_FORMAT,  // The line does not have three fields, or a binary
+                     // record is truncated or of an unknown version
+        BAD_OPERATOR,
+        BAD_ADDRESS,
+        IO_ERROR
+    };
+
+    /**
+     * Creates a reader over an open file descriptor. The descriptor is not
+     * closed by the reader.
+     *
+     * @param fd File descriptor to read the trace from.
+     */
+    explicit TraceReader(int fd);
+
+    // destructor, stops any decompression and unmaps the trace if it was
+    // mapped
+    ~TraceReader();
+
+    TraceReader(const TraceReader &) = delete;
+    TraceReader &operator=(const TraceReader &) = delete;
+
+    /**
+     * Parses the next non-empty line of the trace.
+     *
+     * @param record Filled with the parsed operation on success.
+     * @return RECORD on success, END at end of input, otherwise the error.
+     */
+    Status next(TraceRecord &record) {
+        return binary ? next_binary(record) : next_text(record);
+    }
+
+    /**
+     * @return True if the input is a binary trace
+     */
+    bool is_binary() const { return binary; }
+
+private:
+    // Size of each read(2) when streaming
+    static const size_t CHUNK_SIZE = 1 << 22;
+
+    // Makes more input available when streaming. Returns false at end of
+    // input or on error (see io_failed)
+    bool refill();
+
+    // Reads the next record of a text / binary trace
+    Status next_text(TraceRecord &record);
+    Status next_binary(TraceRecord &record);
+
+    // Buffers at least `bytes` bytes of input unless the input ends first
+    void fill(size_t bytes);
+
+    // Parses the line [begin, end) into a record
+    static Status parse_line(const char *p, const char *line_end,
+                             TraceRecord &record);
+
+    int fd;
+    bool binary = false;
+    bool bad_version = false;  // Binary trace of a version not understood
+    bool io_failed = false;
+    bool eof = false;
+
+    // Mapped file (nullptr when streaming)
+    void *map = nullptr;
+    size_t map_size = 0;
+
+    // Stream buffer (empty when mapped and not compressed)
+    std::vector<char> buffer;
+
+    // Source of the streamed data when the input is compressed
+    std::unique_ptr<Decompressor> decompressor;
+
+    // Unparsed input window
+    const char *cur = nullptr;
+    const char *end = nullptr;
+
+    // Binary decoder state: the previous record's address, size and core
+    uint64_t prev_address;
+    int prev_size;
+    uint16_t prev_core = 0;
+};
+
+/**
+ * Opens a trace file for reading, reporting failures on standard error.
+ *
+ * @param path Path of the trace, or "-" for standard input.
+ * @return The open file descriptor, or -1 on failure.
+ */
+int open_trace(const std::string &path);
+
+/**
+ * Reports a failed trace read on standard error.
+ *
+ * @param status The status returned by TraceReader::next (not RECORD/END).
+ * @param run Number of records processed before the failure.
+ * @return The csim exit code for the failure.
+ */
+int report_trace_error(TraceReader::Status status, uint64_t run);
+
+#endif  // TRACE_READER_H
@@ -0,0 +1,209 @@
+#include "TraceWriter.h"
+
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#include "TraceFormat.h"
+
+namespace {
+
+// Writes a decimal number, most significant digit first
+unsigned char *put_decimal(unsigned char *out, uint64_t value) {
+    char reversed[20];
+    int count = 0;
+    do {
+        reversed[count++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    while (count > 0) {
+        *out++ = reversed[--count];
+    }
+    return out;
+}
+
+}  // namespace
+
+/**
+ * Creates an encoder at the start of a trace.
+ *
+ * @param binary True for the binary format, false for text.
+ */
+TraceEncoder::TraceEncoder(bool binary)
+    : binary(binary),
+      prev_address(trace_format::INITIAL_ADDRESS),
+      prev_size(trace_format::INITIAL_SIZE) {}
+
+/**
+ * Encodes one record. Text records are written as
+ * `<op> 0x<hex address> <size>` with at least 8 hex digits, followed by the
+ * core id unless it is 0.
+ *
+ * @param out Destination, with room for MAX_RECORD_SIZE bytes.
+ * @param record The record.
+ * @return Pointer just past the encoded bytes.
+ */
+unsigned char *TraceEncoder::encode(unsigned char *out,
+                                    const TraceRecord &record) {
+    if (binary) {
+        using namespace trace_format;
+
+        if (record.core != prev_core) {
+            out = put_varint(out, uint64_t{record.core} << KEY_SHIFT | OP_CORE);
+            prev_core = record.core;
+        }
+
+        uint64_t address = record.address;
+        uint64_t delta =
+            zigzag_encode(static_cast<int64_t>(address - prev_address));
+        if (delta >> (64 - KEY_SHIFT) != 0) {
+            // Too far to fit in a key: restart from the address itself
+            out = put_varint(out, ADDRESS_RECORD);
+            out = put_varint(out, address);
+            delta = 0;
+        }
+        uint64_t op = record.op == 's'   ? OP_STORE
+                      : record.op == 'i' ? OP_FETCH
+                                         : OP_LOAD;
+        uint64_t key = (delta << KEY_SHIFT) | op;
+
+        if (record.size != prev_size) {
+            out = put_varint(out, key | SIZE_CHANGED);
+            out = put_varint(out, zigzag_encode(record.size));
+        } else {
+            out = put_varint(out, key);
+        }
+
+        prev_address = address;
+        prev_size = record.size;
+    } else {
+        static const char digits[] = "0123456789ABCDEF";
+
+        *out++ = record.op;
+        *out++ = ' ';
+        *out++ = '0';
+        *out++ = 'x';
+
+        uint64_t address = record.address;
+        int nibbles = 8;
+        while (nibbles < 16 && (address >> (4 * nibbles)) != 0) {
+            ++nibbles;
+        }
+        for (int i = nibbles - 1; i >= 0; --i) {
+            *out++ = digits[(address >> (4 * i)) & 0xf];
+        }
+        *out++ = ' ';
+
+        // Decimal size, most significant digit first
+        int64_t size = record.size;
+        if (size < 0) {
+            *out++ = '-';
+            size = -size;
+        }
+        out = put_decimal(out, static_cast<uint64_t>(size));
+        if (record.core != 0) {
+            *out++ = ' ';
+            out = put_decimal(out, record.core);
+        }
+        *out++ = '\n';
+    }
+    return out;
+}
+
+/**
+ * Continues as if `previous` had just been encoded.
+ *
+ * @param previous The record before the next one encoded.
+ */
+void TraceEncoder::resume(const TraceRecord &previous) {
+    prev_address = previous.address;
+    prev_size = previous.size;
+    prev_core = previous.core;
+}
+
+/**
+ * Creates a writer over an open file descriptor.
+ *
+ * @param fd File descriptor to write to.
+ * @param binary True for the binary format, false for text.
+ */
+TraceWriter::TraceWriter(int fd, bool binary)
+    : fd(fd), encoder(binary), buffer(BUFFER_SIZE) {
+    if (binary) {
+        unsigned char *header = buffer.data();
+        memset(header, 0, trace_format::HEADER_SIZE);
+        memcpy(header, trace_format::MAGIC, sizeof(trace_format::MAGIC));
+        header[8] = trace_format::VERSION & 0xff;
+        header[9] = trace_format::VERSION >> 8;
+        used = trace_format::HEADER_SIZE;
+    }
+}
+
+// destructor
+TraceWriter::~TraceWriter() { flush(); }
+
+/**
+ * Appends one record to the trace.
+ *
+ * @param record The record to write.
+ */
+void TraceWriter::write(const TraceRecord &record) {
+    if (BUFFER_SIZE - used < TraceEncoder::MAX_RECORD_SIZE) {
+        flush();
+    }
+    unsigned char *out = encoder.encode(buffer.data() + used, record);
+    used = static_cast<size_t>(out - buffer.data());
+}
+
+/**
+ * Appends records encoded elsewhere. Large pieces bypass the buffer.
+ *
+ * @param data The encoded records.
+ * @param size Number of bytes.
+ * @param last The last of the records, which the next one follows.
+ */
+void TraceWriter::write_encoded(const unsigned char *data, size_t size,
+                                const TraceRecord &last) {
+    if (size <= BUFFER_SIZE - used) {
+        memcpy(buffer.data() + used, data, size);
+        used += size;
+    } else {
+        flush();
+        write_out(data, size);
+    }
+    encoder.resume(last);
+}
+
+/**
+ * Writes out all buffered records.
+ *
+ * @return False if any write so far has failed.
+ */
+bool TraceWriter::flush() {
+    write_out(buffer.data(), used);
+    used = 0;
+    return !failed;
+}
+
+/**
+ * Writes bytes straight to the file, retrying short writes.
+ *
+ * @param data The bytes.
+ * @param size Number of bytes.
+ */
+void TraceWriter::write_out(const unsigned char *data, size_t size) {
+    while (size > 0 && !failed) {
+        ssize_t wrote = ::write(fd, data, size);
+        if (wrote < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            failed = true;
+            break;
+        }
+        data += wrote;
+        size -= static_cast<size_t>(wrote);
+    }
+}
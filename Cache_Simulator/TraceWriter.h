@@ -0,0 +1,122 @@
+#ifndef TRACE_WRITER_H
+#define TRACE_WRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "TraceReader.h"
+
+/**
+ * Encodes trace records as text lines or as binary trace records (see
+ * TraceFormat.h), without the binary header. Binary records depend on the
+ * record before them, which the encoder keeps track of.
+ */
+class TraceEncoder {
+public:
+    // Longest encoding of one record in either format
+    static const size_t MAX_RECORD_SIZE = 64;
+
+    /**
+     * @param binary True for the binary format, false for text.
+     */
+    explicit TraceEncoder(bool binary);
+
+    /**
+     * Encodes one record.
+     *
+     * @param out Destination, with room for MAX_RECORD_SIZE bytes.
+     * @param record The record.
+     * @return Pointer just past the encoded bytes.
+     */
+    unsigned char *encode(unsigned char *out, const TraceRecord &record);
+
+    /**
+     * Continues as if `previous` had just been encoded, e.g. to encode a
+     * piece of a trace separately from the records before it.
+     *
+     * @param previous The record before the next one encoded.
+     */
+    void resume(const TraceRecord &previous);
+
+    /**
+     * @return True for the binary format
+     */
+    bool is_binary() const { return binary; }
+
+private:
+    bool binary;
+
+    // Binary encoder state: the previous record's address, size and core
+    uint64_t prev_address;
+    int prev_size;
+    uint16_t prev_core = 0;
+};
+
+/**
+ * Writes trace records as text lines or as a packed binary trace (see
+ * TraceFormat.h), buffering output in large chunks.
+ */
+class TraceWriter {
+public:
+    /**
+     * Creates a writer over an open file descriptor. Binary writers emit the
+     * header immediately. The descriptor is not closed by the writer.
+     *
+     * @param fd File descriptor to write to.
+     * @param binary True for the binary format, false for text.
+     */
+    TraceWriter(int fd, bool binary);
+
+    // destructor, flushes any buffered output
+    ~TraceWriter();
+
+    TraceWriter(const TraceWriter &) = delete;
+    TraceWriter &operator=(const TraceWriter &) = delete;
+
+    /**
+     * Appends one record to the trace.
+     *
+     * @param record The record to write.
+     */
+    void write(const TraceRecord &record);
+
+    /**
+     * Appends records encoded elsewhere by a TraceEncoder that was resumed
+     * from the last record written here.
+     *
+     * @param data The encoded records.
+     * @param size Number of bytes.
+     * @param last The last of the records, which the next one follows.
+     */
+    void write_encoded(const unsigned char *data, size_t size,
+                       const TraceRecord &last);
+
+    /**
+     * Writes out all buffered records.
+     *
+     * @return False if any write so far has failed.
+     */
+    bool flush();
+
+    /**
+     * @return True if the trace is binary
+     */
+    bool is_binary() const { return encoder.is_binary(); }
+
+private:
+    // Size of the output buffer
+    static const size_t BUFFER_SIZE = 1 << 20;
+
+    // Writes bytes straight to the file
+    void write_out(const unsigned char *data, size_t size);
+
+    int fd;
+    TraceEncoder encoder;
+    bool failed = false;
+
+    std::vector<unsigned char> buffer;
+    size_t used = 0;
+};
+
+#endif  // TRACE_WRITER_H
@@ -0,0 +1,102 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "Cache.h"
+#include "ErrorCodes.h"
+
+// Benchmark: miss throughput of a single fully associative set as the
+// associativity grows. Every access misses, so each one pays for a lookup,
+// a victim selection and a fill; with O(1) replacement the rate should stay
+// flat from 1 to 16384 ways.
+
+#define MAX_WAYS 16384
+#define BLOCK_SIZE 64
+
+/**
+ * Times `accesses` loads against a 1-set cache with `ways` ways.
+ * The loads cycle over twice as many blocks as fit in the set, which makes
+ * every one of them a miss under both LRU and FIFO.
+ *
+ * @param ways Associativity of the set.
+ * @param lru True for LRU, false for FIFO.
+ * @param accesses Number of loads to time.
+ * @param misses Set to the number of misses the cache reported.
+ * @return Elapsed time in seconds.
+ */
+double time_misses(uint32_t ways, bool lru, uint32_t accesses,
+                   uint64_t& misses) {
+    CacheConfig config = {1,    ways, BLOCK_SIZE,
+                          true, true, lru ? Eviction::LRU : Eviction::FIFO};
+    std::unique_ptr<Cache> cache = make_cache(config);
+    const uint32_t blocks = 2 * ways;
+
+    // Fill the set first so the timed loop only sees evictions
+    for (uint32_t i = 0; i < ways; ++i) {
+        cache->load(i * BLOCK_SIZE);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint32_t block = ways;
+    for (uint32_t i = 0; i < accesses; ++i) {
+        cache->load(block * BLOCK_SIZE);
+        if (++block == blocks) {
+            block = 0;
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    misses = cache->get_load_misses() - ways;
+    return std::chrono::duration<double>(end - start).count();
+}
+
+int main(int argc, char** argv) {
+    if (argc > 2) {
+        std::cerr << "Usage: " << argv[0] << " [accesses_per_config]"
+                  << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+
+    uint32_t accesses = 4000000;
+    if (argc == 2) {
+        try {
+            // Counts that are negative, zero, too large for the timed loop
+            // or followed by anything else are all rejected
+            size_t end = 0;
+            long long value = std::stoll(argv[1], &end);
+            if (value <= 0 || value > UINT32_MAX || argv[1][end] != '\0') {
+                throw std::invalid_argument(argv[1]);
+            }
+            accesses = static_cast<uint32_t>(value);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: accesses must be a positive integer up to "
+                      << UINT32_MAX << "." << std::endl;
+            return INVALID_COMMAND_LINE;
+        }
+    }
+
+    std::cout << std::left << std::setw(8) << "ways" << std::setw(8)
+              << "policy" << std::setw(12) << "misses" << std::setw(14)
+              << "Mmisses/s"
+              << "ns/miss" << std::endl;
+
+    for (uint32_t ways = 1; ways <= MAX_WAYS; ways *= 2) {
+        for (bool lru : {true, false}) {
+            uint64_t misses = 0;
+            double seconds = time_misses(ways, lru, accesses, misses);
+
+            std::cout << std::left << std::setw(8) << ways << std::setw(8)
+                      << (lru ? "lru" : "fifo") << std::setw(12) << misses
+                      << std::setw(14) << std::fixed << std::setprecision(2)
+                      << misses / seconds / 1e6 << std::setprecision(1)
+                      << seconds * 1e9 / misses << std::endl;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,448 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "Cache.h"
+#include "CacheConfig.h"
+#include "ErrorCodes.h"
+
+// Benchmark suite: the simulator's own speed. Every benchmark drives one
+// cache with a synthetic address stream through Cache::load/store (or
+// Cache::simulate with --batch) and reports accesses per second and
+// nanoseconds per access, optionally with hardware counters, so changes to
+// the access path can be checked for regressions.
+
+#define BLOCK_SIZE 64
+
+// Bytes each stream spreads its accesses over: several times the largest
+// benchmarked cache, so every stream misses as well as hits
+#define FOOTPRINT (16u << 20)
+
+// Skew of the Zipfian stream
+#define ZIPF_EXPONENT 0.99
+
+namespace {
+
+/**
+ * A synthetic address stream.
+ */
+struct Stream {
+    const char* name;
+    // Fills `addresses` with the stream's accesses
+    void (*generate)(std::vector<uint64_t>& addresses, std::mt19937_64& rng);
+};
+
+// 4-byte accesses walking through memory
+void sequential(std::vector<uint64_t>& addresses, std::mt19937_64&) {
+    for (size_t i = 0; i < addresses.size(); ++i) {
+        addresses[i] = (i * 4) % FOOTPRINT;
+    }
+}
+
+// One access every 4 blocks
+void strided(std::vector<uint64_t>& addresses, std::mt19937_64&) {
+    for (size_t i = 0; i < addresses.size(); ++i) {
+        addresses[i] = (i * 4 * BLOCK_SIZE) % FOOTPRINT;
+    }
+}
+
+// Uniformly random words
+void uniform(std::vector<uint64_t>& addresses, std::mt19937_64& rng) {
+    for (uint64_t& address : addresses) {
+        address = (rng() % FOOTPRINT) & ~uint64_t{3};
+    }
+}
+
+// Blocks drawn from a Zipf distribution, the popular ones scattered over
+// the footprint
+void zipfian(std::vector<uint64_t>& addresses, std::mt19937_64& rng) {
+    const uint64_t blocks = FOOTPRINT / BLOCK_SIZE;
+    std::vector<double> cdf(blocks);
+    double sum = 0.0;
+    for (uint64_t rank = 0; rank < blocks; ++rank) {
+        sum += 1.0 / std::pow(static_cast<double>(rank + 1), ZIPF_EXPONENT);
+        cdf[rank] = sum;
+    }
+
+    std::uniform_real_distribution<double> draw(0.0, sum);
+    for (uint64_t& address : addresses) {
+        uint64_t rank =
+            std::lower_bound(cdf.begin(), cdf.end(), draw(rng)) - cdf.begin();
+        // An odd multiplier permutes the (power of 2) block numbers
+        uint64_t block = (std::min(rank, blocks - 1) * 0x9E3779B1u) % blocks;
+        address = block * BLOCK_SIZE;
+    }
+}
+
+// Every block once per lap, in the order of a random cycle, like
+// following the links of a shuffled list
+void pointer_chase(std::vector<uint64_t>& addresses, std::mt19937_64& rng) {
+    const uint64_t blocks = FOOTPRINT / BLOCK_SIZE;
+    std::vector<uint32_t> next(blocks);
+    for (uint32_t i = 0; i < blocks; ++i) {
+        next[i] = i;
+    }
+    // Sattolo's shuffle leaves a single cycle through every block
+    for (uint64_t i = blocks - 1; i > 0; --i) {
+        std::swap(next[i], next[rng() % i]);
+    }
+
+    uint32_t block = 0;
+    for (uint64_t& address : addresses) {
+        address = uint64_t{block} * BLOCK_SIZE;
+        block = next[block];
+    }
+}
+
+const Stream STREAMS[] = {
+    {"seq", sequential},  {"stride", strided}, {"random", uniform},
+    {"zipf", zipfian},    {"chase", pointer_chase},
+};
+
+/**
+ * A benchmarked cache shape.
+ */
+struct Geometry {
+    const char* name;
+    uint32_t sets;
+    uint32_t blocks;
+};
+
+const Geometry GEOMETRIES[] = {
+    {"32K-8way", 64, 8},       // L1-like
+    {"1M-16way", 1024, 16},    // L2-like
+    {"64K-full", 1, 1024},     // Fully associative, through the tag index
+};
+
+const Eviction POLICIES[] = {
+    Eviction::LRU,   Eviction::FIFO, Eviction::PLRU,   Eviction::SRRIP,
+    Eviction::BRRIP, Eviction::LFU,  Eviction::RANDOM,
+};
+
+/**
+ * Hardware counters of the benchmarking thread, through perf_event_open.
+ * Opening them fails on hosts without perf support (or without the
+ * permission), in which case they are simply not reported.
+ */
+class PerfCounters {
+public:
+    // Counters read, in report order
+    static const int COUNT = 4;
+
+    PerfCounters() {
+#ifdef __linux__
+        const uint64_t configs[COUNT] = {
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+        for (int i = 0; i < COUNT; ++i) {
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = configs[i];
+            attr.disabled = i == 0;  // The leader starts the group
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP;
+            fds[i] = static_cast<int>(
+                syscall(SYS_perf_event_open, &attr, 0, -1,
+                        i == 0 ? -1 : fds[0], 0));
+            if (fds[i] < 0) {
+                close_all();
+                return;
+            }
+        }
+#endif
+    }
+
+    ~PerfCounters() { close_all(); }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available() const { return fds[0] >= 0; }
+
+    void start() {
+#ifdef __linux__
+        ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+    }
+
+    // Stops counting and reads the counters into `values`
+    bool stop(uint64_t values[COUNT]) {
+#ifdef __linux__
+        ioctl(fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        uint64_t group[1 + COUNT];
+        if (read(fds[0], group, sizeof(group)) ==
+                static_cast<ssize_t>(sizeof(group)) &&
+            group[0] == COUNT) {
+            std::copy(group + 1, group + 1 + COUNT, values);
+            return true;
+        }
+#endif
+        (void)values;
+        return false;
+    }
+
+private:
+    void close_all() {
+#ifdef __linux__
+        for (int& fd : fds) {
+            if (fd >= 0) {
+                close(fd);
+            }
+            fd = -1;
+        }
+#endif
+    }
+
+    int fds[COUNT] = {-1, -1, -1, -1};
+};
+
+/**
+ * Options of a benchmark run.
+ */
+struct Options {
+    uint64_t accesses = 1000000;  // Per repetition
+    int repetitions = 3;
+    std::string filter;           // Benchmarks whose name contains it
+    bool batch = false;           // Cache::simulate instead of load/store
+    bool perf = false;            // Report hardware counters
+    bool csv = false;
+};
+
+/**
+ * Result of one benchmark: the median repetition.
+ */
+struct Result {
+    double seconds = 0.0;
+    double hit_rate = 0.0;
+    bool counted = false;  // Hardware counters were read
+    uint64_t counters[PerfCounters::COUNT] = {};
+};
+
+/**
+ * Times a stream through fresh caches of one configuration. One access in
+ * four is a store.
+ *
+ * @param config The cache.
+ * @param addresses The stream.
+ * @param records The stream as trace records (for --batch).
+ * @param options Repetitions and what to drive.
+ * @param perf Counters to read, or null.
+ * @return The repetition with the median time.
+ */
+Result run(const CacheConfig& config, const std::vector<uint64_t>& addresses,
+           const std::vector<TraceRecord>& records, const Options& options,
+           PerfCounters* perf) {
+    std::vector<Result> results(options.repetitions);
+    for (Result& result : results) {
+        std::unique_ptr<Cache> cache = make_cache(config);
+        Cache& target = *cache;
+
+        if (perf) {
+            perf->start();
+        }
+        auto start = std::chrono::steady_clock::now();
+        if (options.batch) {
+            target.simulate(records.data(), records.size());
+        } else {
+            for (size_t i = 0; i < addresses.size(); ++i) {
+                if ((i & 3) == 3) {
+                    target.store(addresses[i]);
+                } else {
+                    target.load(addresses[i]);
+                }
+            }
+        }
+        auto end = std::chrono::steady_clock::now();
+        if (perf) {
+            result.counted = perf->stop(result.counters);
+        }
+
+        result.seconds = std::chrono::duration<double>(end - start).count();
+        CacheStats stats = target.get_stats();
+        result.hit_rate = static_cast<double>(stats.load_hits +
+                                              stats.store_hits) /
+                          addresses.size();
+    }
+
+    std::nth_element(results.begin(), results.begin() + results.size() / 2,
+                     results.end(), [](const Result& a, const Result& b) {
+                         return a.seconds < b.seconds;
+                     });
+    return results[results.size() / 2];
+}
+
+// Column names of the hardware counters, per access
+const char* const PERF_COLUMNS[PerfCounters::COUNT] = {
+    "cycles/acc", "instr/acc", "llc_miss/acc", "br_miss/acc"};
+
+// Writes a table row without the padding of its last column
+void print_row(const std::ostringstream& row) {
+    std::string text = row.str();
+    text.erase(text.find_last_not_of(' ') + 1);
+    std::cout << text << std::endl;
+}
+
+// Prints the column headers
+void print_header(const Options& options) {
+    std::ostringstream row;
+    if (options.csv) {
+        row << "benchmark,hit_rate,maccesses_per_s,ns_per_access";
+    } else {
+        row << std::left << std::setw(28) << "benchmark" << std::setw(10)
+            << "hit_rate" << std::setw(12) << "Macc/s" << std::setw(10)
+            << "ns/acc";
+    }
+    for (int i = 0; options.perf && i < PerfCounters::COUNT; ++i) {
+        if (options.csv) {
+            row << "," << PERF_COLUMNS[i];
+        } else {
+            row << std::setw(14) << PERF_COLUMNS[i];
+        }
+    }
+    print_row(row);
+}
+
+// Prints one benchmark's row
+void print_result(const std::string& name, const Result& result,
+                  uint64_t accesses, const Options& options) {
+    double rate = accesses / result.seconds / 1e6;
+    double ns = result.seconds * 1e9 / accesses;
+
+    std::ostringstream row;
+    row << std::fixed;
+    if (options.csv) {
+        row << name << "," << std::setprecision(4) << result.hit_rate << ","
+            << std::setprecision(2) << rate << "," << ns;
+    } else {
+        row << std::left << std::setw(28) << name << std::setw(10)
+            << std::setprecision(4) << result.hit_rate << std::setw(12)
+            << std::setprecision(2) << rate << std::setw(10) << ns;
+    }
+    for (int i = 0; options.perf && i < PerfCounters::COUNT; ++i) {
+        double per_access = static_cast<double>(result.counters[i]) / accesses;
+        if (options.csv) {
+            row << ",";
+            if (result.counted) {
+                row << per_access;
+            }
+        } else if (result.counted) {
+            row << std::setw(14) << per_access;
+        } else {
+            row << std::setw(14) << "-";
+        }
+    }
+    print_row(row);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int arg = 1; arg < argc; ++arg) {
+        std::string option = argv[arg];
+        try {
+            if (option == "-n" && arg + 1 < argc) {
+                long long value = std::stoll(argv[++arg]);
+                if (value <= 0) {
+                    throw std::invalid_argument(argv[arg]);
+                }
+                options.accesses = static_cast<uint64_t>(value);
+            } else if (option == "-r" && arg + 1 < argc) {
+                options.repetitions = std::stoi(argv[++arg]);
+                if (options.repetitions <= 0) {
+                    throw std::invalid_argument(argv[arg]);
+                }
+            } else if (option == "--filter" && arg + 1 < argc) {
+                options.filter = argv[++arg];
+            } else if (option == "--batch") {
+                options.batch = true;
+            } else if (option == "--perf") {
+                options.perf = true;
+            } else if (option == "--csv") {
+                options.csv = true;
+            } else {
+                std::cerr << "Usage: " << argv[0]
+                          << " [-n accesses] [-r repetitions] "
+                          << "[--filter text] [--batch] [--perf] [--csv]"
+                          << std::endl;
+                return INVALID_COMMAND_LINE;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << option
+                      << " must be a positive integer." << std::endl;
+            return INVALID_COMMAND_LINE;
+        }
+    }
+
+    std::unique_ptr<PerfCounters> perf;
+    if (options.perf) {
+        perf = std::make_unique<PerfCounters>();
+        if (!perf->available()) {
+            std::cerr << "Warning: Hardware counters are unavailable "
+                      << "(perf_event_open failed)." << std::endl;
+            perf.reset();
+        }
+    }
+
+    print_header(options);
+    std::vector<uint64_t> addresses(options.accesses);
+    std::vector<TraceRecord> records;
+    for (const Stream& stream : STREAMS) {
+        bool generated = false;
+
+        for (const Geometry& geometry : GEOMETRIES) {
+            for (Eviction eviction : POLICIES) {
+                std::string name = std::string(stream.name) + "/" +
+                                   geometry.name + "/" +
+                                   eviction_name(eviction);
+                if (name.find(options.filter) == std::string::npos) {
+                    continue;
+                }
+
+                // Streams are generated once, outside the timed loops
+                if (!generated) {
+                    std::mt19937_64 rng(42);
+                    stream.generate(addresses, rng);
+                    records.clear();
+                    for (size_t i = 0; options.batch && i < addresses.size();
+                         ++i) {
+                        records.push_back(
+                            {addresses[i], 4, (i & 3) == 3 ? 's' : 'l', 0});
+                    }
+                    generated = true;
+                }
+
+                CacheConfig config = {geometry.sets, geometry.blocks,
+                                      BLOCK_SIZE,    true,
+                                      true,          eviction};
+                Result result =
+                    run(config, addresses, records, options, perf.get());
+                print_result(name, result, options.accesses, options);
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -1,192 +1,511 @@
 #include <algorithm>
-#include <cctype>
 #include <cstdint>
 #include <cstdlib>
+#include <fstream>
 #include <iostream>
-#include <iterator>
-#include <sstream>
+#include <memory>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 #include "Cache.h"
+#include "CacheConfig.h"
+#include "Coherence.h"
+#include "Convert.h"
+#include "Dram.h"
+#include "ErrorCodes.h"
+#include "Hierarchy.h"
+#include "IntervalStats.h"
+#include "MissProfile.h"
+#include "Prefetcher.h"
+#include "ReplacementPolicy.h"
+#include "Sampling.h"
+#include "SetShards.h"
+#include "StackDistance.h"
+#include "Sweep.h"
+#include "TraceGenerator.h"
+#include "TraceReader.h"
 
-// Error codes for different types of invalid input
-#define INVALID_COMMAND_LINE 1
-#define INVALID_SET_NUM 2
-#define INVALID_BLOCK_NUM 3
-#define INVALID_BLOCK_SIZE 4
-#define INVALID_MISS_TYPE 5
-#define INVALID_HIT_TYPE 6
-#define INVALID_EVICTION 7
-#define INVALID_OPERATOR 8
-#define INVALID_ADDRESS 9
-
-// Helper function to convert a string to lowercase
-std::string to_lower(const std::string& s) {
-    std::string result = s;
-    std::transform(result.begin(), result.end(), result.begin(),
-                   [](unsigned char c) { return std::tolower(c); });
-    return result;
-}
+// Trace records handed to the cache at a time
+#define SIMULATE_BATCH 4096
 
-// Helper function to check if a number is a power of 2
-bool is_power_of_2(uint32_t n) { return (n & (n - 1)) == 0; }
+namespace {
 
-int main(int argc, char** argv) {
-    // Expect exactly 7 arguments: program name + 6 user inputs
-    if (argc != 7) {
-        std::cerr << "Command Line Argument Format: " << argv[0]
-                  << " <num_sets> <num_blocks> <block_size> "
-                  << "<miss_type> <hit_type>  <eviction>" << std::endl;
-        return INVALID_COMMAND_LINE;
+/**
+ * Runs records through a cache, publishing a snapshot of its counters each
+ * time the number of accesses simulated reaches a multiple of `interval`.
+ *
+ * @param cache The cache.
+ * @param records The records.
+ * @param count Number of records.
+ * @param simulated Accesses simulated so far; advanced by `count`.
+ * @param interval Accesses per snapshot.
+ * @param intervals Receives the snapshots, or null for none.
+ */
+void simulate_intervals(Cache& cache, const TraceRecord* records, size_t count,
+                        uint64_t& simulated, uint64_t interval,
+                        IntervalWriter* intervals) {
+    if (!intervals) {
+        cache.simulate(records, count);
+        simulated += count;
+        return;
     }
 
-    int set_num, block_num, block_size;
-    std::string miss_type, hit_type, eviction;
+    while (count > 0) {
+        size_t step = static_cast<size_t>(
+            std::min<uint64_t>(count, interval - simulated % interval));
+        cache.simulate(records, step);
+        records += step;
+        count -= step;
+        simulated += step;
+        if (simulated % interval == 0) {
+            intervals->publish({simulated, cache.get_stats()});
+        }
+    }
+}
 
-    try {
-        // Parse integer arguments
-        set_num = std::stoi(argv[1]);
-        block_num = std::stoi(argv[2]);
-        block_size = std::stoi(argv[3]);
+}  // namespace
 
-        // Normalize string arguments to lowercase
-        miss_type = to_lower(argv[4]);
-        hit_type = to_lower(argv[5]);
-        eviction = to_lower(argv[6]);
-    } catch (const std::exception& e) {
-        std::cerr
-            << "Error: First three arguments must be integers (powers of 2)."
-            << std::endl;
-        return INVALID_COMMAND_LINE;
+int main(int argc, char** argv) {
+    // Subcommands
+    if (argc >= 2 && std::string(argv[1]) == "convert") {
+        return run_convert(argc - 1, argv + 1);
     }
-
-    // Validate that integers are positive
-    if (set_num <= 0 || block_num <= 0 || block_size <= 0) {
-        std::cerr << "Error: All numeric arguments must be positive integers."
-                  << std::endl;
-        return INVALID_COMMAND_LINE;
+    if (argc >= 2 && std::string(argv[1]) == "generate") {
+        return run_generate(argc - 1, argv + 1);
     }
-
-    // Convert to unsigned for power-of-2 check
-    uint32_t u_set_num = static_cast<uint32_t>(set_num);
-    uint32_t u_block_num = static_cast<uint32_t>(block_num);
-    uint32_t u_block_size = static_cast<uint32_t>(block_size);
-
-    // Check if number of sets is a power of 2
-    if (!is_power_of_2(u_set_num)) {
-        std::cerr << "Error: Number of sets (" << set_num
-                  << ") must be a power of 2." << std::endl;
-        return INVALID_SET_NUM;
+    if (argc >= 2 && std::string(argv[1]) == "sweep") {
+        return run_sweep(argc - 1, argv + 1);
+    }
+    if (argc >= 2 && std::string(argv[1]) == "stackdist") {
+        return run_stackdist(argc - 1, argv + 1);
+    }
+    if (argc >= 2 && std::string(argv[1]) == "hierarchy") {
+        return run_hierarchy(argc - 1, argv + 1);
+    }
+    if (argc >= 2 && std::string(argv[1]) == "coherence") {
+        return run_coherence(argc - 1, argv + 1);
     }
 
-    // Check if block size is at least 4 and a power of 2
-    if (block_size < 4 || !is_power_of_2(u_block_size)) {
-        std::cerr << "Error: Block size (" << block_size
-                  << ") must be at least 4 and a power of 2." << std::endl;
-        return INVALID_BLOCK_SIZE;
+    // Leading options
+    unsigned threads = 1;
+    PrefetcherConfig prefetch;
+    bool prefetching = false;
+    VictimConfig victim_config;
+    bool victim_caching = false;
+    uint32_t mshrs = 0;
+    DramConfig dram_config;
+    bool dram_modeling = false;
+    ProfileConfig profile_config;
+    bool profiling = false;
+    uint64_t interval = 0;
+    std::string interval_file = "-";
+    SampleConfig sample;
+    bool sampling = false;
+    PhaseConfig phases;
+    bool phasing = false;
+    bool check = false;
+    std::string save_file;
+    std::string restore_file;
+    bool reset_stats = false;
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-' && argv[arg][1] != '\0'; ++arg) {
+        std::string option = argv[arg];
+
+        if (option == "-j" && arg + 1 < argc) {
+            try {
+                int value = std::stoi(argv[++arg]);
+                if (value <= 0) {
+                    throw std::invalid_argument(argv[arg]);
+                }
+                threads = static_cast<unsigned>(value);
+            } catch (const std::exception& e) {
+                std::cerr << "Error: -j must be a positive integer."
+                          << std::endl;
+                return INVALID_COMMAND_LINE;
+            }
+        } else if (option == "-f" && arg + 1 < argc) {
+            int error = parse_prefetcher_config(argv[++arg], prefetch);
+            if (error != 0) {
+                return error;
+            }
+            prefetching = true;
+        } else if (option == "-v" && arg + 1 < argc) {
+            int error = parse_victim_config(argv[++arg], victim_config);
+            if (error != 0) {
+                return error;
+            }
+            victim_caching = true;
+        } else if (option == "-m" && arg + 1 < argc) {
+            try {
+                int value = std::stoi(argv[++arg]);
+                if (value <= 0) {
+                    throw std::invalid_argument(argv[arg]);
+                }
+                mshrs = static_cast<uint32_t>(value);
+            } catch (const std::exception& e) {
+                std::cerr << "Error: -m must be a positive integer."
+                          << std::endl;
+                return INVALID_COMMAND_LINE;
+            }
+        } else if (option == "-d" && arg + 1 < argc) {
+            int error = parse_dram_config(argv[++arg], dram_config);
+            if (error != 0) {
+                return error;
+            }
+            dram_modeling = true;
+        } else if (option == "-P" && arg + 1 < argc) {
+            int error = parse_profile_config(argv[++arg], profile_config);
+            if (error != 0) {
+                return error;
+            }
+            profiling = true;
+        } else if (option == "-r" && arg + 1 < argc) {
+            int error = parse_profile_region(argv[++arg], profile_config);
+            if (error != 0) {
+                return error;
+            }
+            profiling = true;
+        } else if (option == "--interval" && arg + 1 < argc) {
+            try {
+                long long value = std::stoll(argv[++arg]);
+                if (value <= 0) {
+                    throw std::invalid_argument(argv[arg]);
+                }
+                interval = static_cast<uint64_t>(value);
+            } catch (const std::exception& e) {
+                std::cerr << "Error: --interval must be a positive integer."
+                          << std::endl;
+                return INVALID_COMMAND_LINE;
+            }
+        } else if (option == "--interval-file" && arg + 1 < argc) {
+            interval_file = argv[++arg];
+        } else if (option == "--sample" && arg + 1 < argc) {
+            int error = parse_sample_config(argv[++arg], sample);
+            if (error != 0) {
+                return error;
+            }
+            sampling = true;
+        } else if (option == "--phases" && arg + 1 < argc) {
+            int error = parse_phase_config(argv[++arg], phases);
+            if (error != 0) {
+                return error;
+            }
+            phasing = true;
+        } else if (option == "--check") {
+            check = true;
+        } else if (option == "--save" && arg + 1 < argc) {
+            save_file = argv[++arg];
+        } else if (option == "--restore" && arg + 1 < argc) {
+            restore_file = argv[++arg];
+        } else if (option == "--reset-stats") {
+            reset_stats = true;
+        } else if (option == "-o" && arg + 1 < argc) {
+            profile_config.output = argv[++arg];
+            profile_config.json =
+                profile_config.output.size() >= 5 &&
+                to_lower(profile_config.output.substr(
+                    profile_config.output.size() - 5)) == ".json";
+            profiling = true;
+        } else {
+            std::cerr << "Error: Unknown option '" << option << "'."
+                      << std::endl;
+            return INVALID_COMMAND_LINE;
+        }
     }
 
-    // Validate hit type
-    if (hit_type != "write-through" && hit_type != "write-back") {
-        std::cerr << "Error: Hit type must be 'write-through' or 'write-back'."
+    // Expect 6 user inputs, plus an optional trace file (standard input is
+    // read otherwise)
+    int positional = argc - arg;
+    if (positional != 6 && positional != 7) {
+        std::cerr << "Command Line Argument Format: " << argv[0]
+                  << " [-j threads] [-f prefetcher] [-v victim_blocks] "
+                  << "[-m mshrs] [-d dram] [-P top[:page_size]] "
+                  << "[-r name:start:end] "
+                  << "[-o profile_file] [--interval accesses] "
+                  << "[--interval-file file] [--sample period:window[:warmup]] "
+                  << "[--phases interval:clusters[:per_cluster]] [--check] "
+                  << "[--save file] [--restore file] [--reset-stats] "
+                  << "<num_sets> <num_blocks> <block_size> "
+                  << "<miss_type> <hit_type>  <eviction> [trace_file]"
                   << std::endl;
-        return INVALID_HIT_TYPE;
+        return INVALID_COMMAND_LINE;
     }
 
-    // Validate miss type
-    if (miss_type != "write-allocate" && miss_type != "no-write-allocate") {
-        std::cerr << "Error: Miss type must be 'write-allocate' or "
-                     "'no-write-allocate'."
+    CacheConfig config;
+    int error = parse_cache_config(
+        std::vector<std::string>(argv + arg, argv + arg + 6), config);
+    if (error != 0) {
+        return error;
+    }
+    if (prefetching && config.eviction == Eviction::OPT) {
+        // Prefetched fills have no place in the next-use index
+        std::cerr << "Error: opt cannot be combined with a prefetcher."
                   << std::endl;
-        return INVALID_MISS_TYPE;
+        return INVALID_EVICTION;
     }
-
-    if (hit_type == "write-back" && miss_type == "no-write-allocate") {
-        std::cerr
-            << "Error: Can't have write-back and no-write-allocate together."
-            << std::endl;
-        return INVALID_MISS_TYPE;
+    bool checkpointing = !save_file.empty() || !restore_file.empty();
+    if (reset_stats && restore_file.empty()) {
+        std::cerr << "Error: --reset-stats needs --restore." << std::endl;
+        return INVALID_COMMAND_LINE;
     }
-
-    // Validate eviction policy
-    if (eviction != "lru" && eviction != "fifo") {
-        std::cerr << "Error: Eviction policy must be 'lru' or 'fifo'."
+    if (interval != 0 && !restore_file.empty() && !reset_stats) {
+        // Windows are cut from counters that start at zero
+        std::cerr << "Error: --interval with --restore needs --reset-stats."
                   << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
+    if (checkpointing && config.eviction == Eviction::OPT) {
+        // Its state is made of positions in one particular trace
+        std::cerr << "Error: opt caches cannot be checkpointed." << std::endl;
         return INVALID_EVICTION;
     }
+    if (profiling && profile_config.page_size < config.bytes) {
+        std::cerr << "Error: Profile page size must be at least the block "
+                  << "size." << std::endl;
+        return INVALID_COMMAND_LINE;
+    }
 
-    // Translate string options to boolean flags
-    bool miss_write_type = (miss_type == "write-allocate") ? true : false;
-    bool hit_write_type = (hit_type == "write-back") ? true : false;
-    bool eviction_type = (eviction == "lru") ? true : false;
-
-    // Initialize the cache simulation
-    Cache simulation = Cache(u_set_num, u_block_num, u_block_size,
-                             miss_write_type, hit_write_type, eviction_type);
+    // Sampled runs estimate the counters of the cache alone
+    if (sampling || phasing || check) {
+        if (sampling == phasing) {
+            std::cerr << "Error: Give exactly one of --sample and --phases."
+                      << std::endl;
+            return INVALID_COMMAND_LINE;
+        }
+        if (prefetching || victim_caching || mshrs != 0 || dram_modeling ||
+            profiling || interval != 0 || checkpointing) {
+            std::cerr << "Error: Sampling cannot be combined with -f, -v, -m, "
+                      << "-d, a miss profile, --interval or checkpoints."
+                      << std::endl;
+            return INVALID_COMMAND_LINE;
+        }
+        if (config.eviction == Eviction::OPT) {
+            // Skipped accesses would still be in the next-use index
+            std::cerr << "Error: opt cannot be combined with sampling."
+                      << std::endl;
+            return INVALID_EVICTION;
+        }
+        return run_sampled(config, positional == 7 ? argv[arg + 6] : "-",
+                           sampling ? &sample : nullptr,
+                           phasing ? &phases : nullptr, check);
+    }
 
     // Begin simulation
     std::cout << "Running the simulation." << std::endl;
 
-    std::string line;  // Input line buffer
+    // Read the trace from the named file, or from standard input
+    int trace_fd = open_trace(positional == 7 ? argv[arg + 6] : "-");
+    if (trace_fd < 0) {
+        return INVALID_COMMAND_LINE;
+    }
+    TraceReader reader(trace_fd);
 
-    uint32_t run = 0;
-    // Read lines from standard input
-    while (std::getline(std::cin, line)) {
-        // Skip empty lines
-        if (line.empty()) {
-            continue;
-        }
+    TraceReader::Status status;
+    CacheStats stats;
+    uint64_t run = 0;
 
-        std::istringstream iss(line);
+    // A prefetcher may fetch blocks of any set, and a victim cache, the
+    // MSHRs and the DRAM's row buffers are shared by all sets, so they need
+    // the whole cache. Interval snapshots and checkpoints need the state of
+    // all sets at the same point
+    bool whole_cache = prefetching || victim_caching || mshrs != 0 ||
+                       dram_modeling || interval != 0 || checkpointing;
+    unsigned shards = whole_cache ? 1 : set_shard_count(config, threads);
+    PrefetchStats prefetch_stats;
+    MshrStats mshr_stats;
+    CacheStats victim_stats;
+    std::unique_ptr<MissProfile> profile;
+    if (profiling) {
+        profile = std::make_unique<MissProfile>(config.bytes, profile_config);
+    }
+    std::unique_ptr<DramModel> dram;
+    if (dram_modeling) {
+        dram = std::make_unique<DramModel>(dram_config);
+    }
 
-        std::string op,
-            hex_address;  // Operation type and memory address
-        int value;
+    // Interval snapshots are written by a background thread
+    std::ofstream interval_out;
+    std::unique_ptr<IntervalWriter> intervals;
+    if (interval != 0) {
+        if (interval_file != "-") {
+            interval_out.open(interval_file);
+            if (!interval_out) {
+                std::cerr << "Error: Unable to write intervals '"
+                          << interval_file << "'." << std::endl;
+                return INVALID_COMMAND_LINE;
+            }
+        }
+        intervals = std::make_unique<IntervalWriter>(
+            interval_file == "-" ? std::cout : interval_out);
+    }
+    uint64_t simulated = 0;
+    if (shards > 1) {
+        // Split the sets of the cache across threads
+        status = simulate_set_shards(reader, config, shards, stats, run,
+                                     profile.get());
+    } else if (config.eviction == Eviction::OPT) {
+        // OPT looks ahead, so the whole trace is read before simulating
+        std::vector<TraceRecord> records;
+        TraceRecord record;
+        while ((status = reader.next(record)) == TraceReader::RECORD) {
+            if (records.size() == NEVER_USED) {
+                std::cerr << "Error: Trace too long for opt." << std::endl;
+                return INVALID_COMMAND_LINE;
+            }
+            records.push_back(record);
+            ++run;
+        }
 
-        if (!(iss >> op >> hex_address >> value)) {
-            std::cerr << "Invalid input format in line. Simulation run " << run
-                      << std::endl;
-            return INVALID_COMMAND_LINE;
+        std::vector<uint32_t> next_use = build_next_use(records, config.bytes);
+        std::unique_ptr<Cache> simulation = make_cache(config, &next_use);
+        std::unique_ptr<Cache> victim;
+        if (victim_caching) {
+            victim = make_victim_cache(victim_config, config.bytes);
+            simulation->set_next_level(victim.get());
+        }
+        (victim ? victim : simulation)->set_next_level(dram.get());
+        simulation->set_mshrs(mshrs);
+        simulation->set_miss_profile(profile.get());
+        simulate_intervals(*simulation, records.data(), records.size(),
+                           simulated, interval, intervals.get());
+        stats = simulation->get_stats();
+        mshr_stats = simulation->get_mshr_stats();
+        if (victim) {
+            victim_stats = victim->get_stats();
+        }
+    } else {
+        // Initialize the cache simulation
+        std::unique_ptr<Cache> simulation = make_cache(config);
+        if (prefetching) {
+            simulation->set_prefetcher(make_prefetcher(prefetch, config.bytes));
         }
 
-        op = to_lower(op);  // Normalize operator string
+        // A victim cache sits between the cache and memory, which is the
+        // DRAM model if there is one and the flat memory cost otherwise
+        std::unique_ptr<Cache> victim;
+        if (victim_caching) {
+            victim = make_victim_cache(victim_config, config.bytes);
+            simulation->set_next_level(victim.get());
+        }
+        (victim ? victim : simulation)->set_next_level(dram.get());
+        simulation->set_mshrs(mshrs);
+        simulation->set_miss_profile(profile.get());
 
-        if (op.size() != 1 && op != "l" && op != "s") {
-            std::cerr << "operator must be of length 1. Either l for load or s "
-                         "for store. Simulation run "
-                      << run << std::endl;
-            return INVALID_OPERATOR;
+        // Start from a warmed-up cache instead of a cold one
+        if (!restore_file.empty()) {
+            int error = simulation->restore_checkpoint(restore_file);
+            if (error != 0) {
+                return error;
+            }
+            if (reset_stats) {
+                simulation->reset_stats();
+            }
         }
 
-        // Convert address from hex string to unsigned int
-        uint32_t address;
-        try {
-            address = std::stoul(hex_address, nullptr, 16);
-        } catch (const std::invalid_argument& e) {
-            std::cerr << "Invalid address: address must be a 32-bit hex "
-                         "representation. "
-                      << "Simulation run " << run << std::endl;
-            return INVALID_ADDRESS;
+        // Hand the records over in batches so the cache's access path is
+        // inlined instead of called virtually for every record
+        std::vector<TraceRecord> batch;
+        batch.reserve(SIMULATE_BATCH);
+        TraceRecord record;
+        while ((status = reader.next(record)) == TraceReader::RECORD) {
+            batch.push_back(record);
+            ++run;
+            if (batch.size() == SIMULATE_BATCH) {
+                simulate_intervals(*simulation, batch.data(), batch.size(),
+                                   simulated, interval, intervals.get());
+                batch.clear();
+            }
         }
+        simulate_intervals(*simulation, batch.data(), batch.size(), simulated,
+                           interval, intervals.get());
+        if (!save_file.empty() && status == TraceReader::END) {
+            int error = simulation->save_checkpoint(save_file);
+            if (error != 0) {
+                return error;
+            }
+        }
+        stats = simulation->get_stats();
+        prefetch_stats = simulation->get_prefetch_stats();
+        mshr_stats = simulation->get_mshr_stats();
+        if (victim) {
+            victim_stats = victim->get_stats();
+        }
+    }
 
-        // Perform the cache operation
-        if (op == "l") {
-            simulation.load(address);
-        } else {
-            simulation.store(address);
+    if (intervals) {
+        // The last window may be shorter than the others
+        if (simulated % interval != 0) {
+            intervals->publish({simulated, stats});
+        }
+        intervals->finish();
+        if (interval_file == "-") {
+            std::cout << "\n";
         }
-        ++run;
+    }
+
+    if (status != TraceReader::END) {
+        return report_trace_error(status, run);
     }
 
     // Output simulation summary
-    std::cout << "Total loads: " << simulation.get_loads() << "\n"
-              << "Total stores: " << simulation.get_stores() << "\n"
-              << "Load hits: " << simulation.get_load_hits() << "\n"
-              << "Load misses: " << simulation.get_load_misses() << "\n"
-              << "Store hits: " << simulation.get_store_hits() << "\n"
-              << "Store misses: " << simulation.get_store_misses() << "\n"
-              << "Total cycles: " << simulation.get_cycles() << std::endl;
+    std::cout << "Total loads: " << stats.loads << "\n"
+              << "Total stores: " << stats.stores << "\n"
+              << "Load hits: " << stats.load_hits << "\n"
+              << "Load misses: " << stats.load_misses << "\n"
+              << "Store hits: " << stats.store_hits << "\n"
+              << "Store misses: " << stats.store_misses << "\n"
+              << "Total cycles: " << stats.cycles << std::endl;
+    if (prefetching) {
+        std::cout << "Prefetches issued: " << prefetch_stats.issued << "\n"
+                  << "Useful prefetches: " << prefetch_stats.useful << "\n"
+                  << "Late prefetches: " << prefetch_stats.late << "\n"
+                  << "Unused prefetches: " << prefetch_stats.unused << "\n"
+                  << "Pollution misses: " << prefetch_stats.pollution
+                  << std::endl;
+    }
+    if (victim_caching) {
+        std::cout << "Victim cache hits: " << victim_stats.load_hits << "\n"
+                  << "Victim cache misses: " << victim_stats.load_misses
+                  << std::endl;
+    }
+    if (mshrs != 0) {
+        std::cout << "Merged misses: " << mshr_stats.merged << "\n"
+                  << "MSHR full stalls: " << mshr_stats.full_stalls << "\n"
+                  << "Overlapped miss cycles: " << mshr_stats.overlapped
+                  << std::endl;
+    }
+    if (dram) {
+        const DramStats& dram_stats = dram->get_stats();
+        std::cout << "DRAM reads: " << dram_stats.reads << "\n"
+                  << "DRAM writes: " << dram_stats.writes << "\n"
+                  << "Row buffer hits: " << dram_stats.row_hits << "\n"
+                  << "Row buffer misses: " << dram_stats.row_misses << "\n"
+                  << "Row buffer conflicts: " << dram_stats.row_conflicts
+                  << "\n"
+                  << "Row buffer hit rate: " << dram_stats.row_hit_rate()
+                  << "\n"
+                  << "Average memory latency: "
+                  << dram_stats.average_latency() << std::endl;
+    }
+
+    if (profile) {
+        if (profile_config.output == "-") {
+            std::cout << "\n";
+            write_profile(*profile, profile_config, std::cout);
+            std::cout.flush();
+        } else {
+            std::ofstream out(profile_config.output);
+            if (out) {
+                write_profile(*profile, profile_config, out);
+            }
+            if (!out) {
+                std::cerr << "Error: Unable to write profile '"
+                          << profile_config.output << "'." << std::endl;
+                return INVALID_COMMAND_LINE;
+            }
+        }
+    }
 
     return EXIT_SUCCESS;
 }